@@ -0,0 +1,45 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#ifndef _GIT2PP_BENCH_ALLOCCOUNT_HPP_
+#define _GIT2PP_BENCH_ALLOCCOUNT_HPP_
+
+#include <cstddef>
+
+/*
+ * Counters of the allocations made through operator new, which
+ * alloccount.cpp replaces in the benchmarks it is linked in. The
+ * allocations libgit2 makes with malloc are not counted.
+ */
+
+namespace bench
+{
+
+/**
+ * Number of allocations made with operator new since the program started.
+ */
+size_t allocations();
+
+/**
+ * Number of bytes allocated with operator new since the program started.
+ */
+size_t allocatedBytes();
+
+} // namespace bench
+#endif // _GIT2PP_BENCH_ALLOCCOUNT_HPP_
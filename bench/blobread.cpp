@@ -0,0 +1,163 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+/*
+ * Compare the peak memory of BlobReader and Blob::content().
+ *
+ * Usage: bench-blobread <repository> <blob id>
+ *
+ * The blob is read in a child process per method: in chunks with a
+ * BlobReader, then as a whole with Blob::content(). The peak resident
+ * size of each child is printed along with its time; a child which only
+ * opens the repository gives the baseline.
+ */
+
+#include <git2.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "blob.hpp"
+#include "blobstream.hpp"
+#include "exception.hpp"
+#include "oid.hpp"
+#include "repository.hpp"
+
+using namespace git2;
+
+namespace
+{
+
+const size_t chunk_size = 64*1024;
+
+enum Method
+{
+	METHOD_NONE,
+	METHOD_READER,
+	METHOD_CONTENT
+};
+
+/**
+ * Read the blob with a method, in the calling process.
+ *
+ * @return Sum of the bytes of the blob, to check the methods agree.
+ */
+uint64_t read_blob(const char* path, const OId& oid, Method method)
+{
+	Repository repo = Repository::open(path);
+	uint64_t sum = 0;
+	if(method == METHOD_READER)
+	{
+		BlobReader reader(repo, oid);
+		std::vector<unsigned char> buffer(chunk_size);
+		for(size_t length; (length = reader.read(buffer.data(), buffer.size())) > 0; )
+		{
+			for(size_t n = 0; n < length; ++n)
+				sum += buffer[n];
+		}
+	}
+	else if(method == METHOD_CONTENT)
+	{
+		std::vector<unsigned char> content = repo.lookupBlob(oid).content();
+		for(unsigned char byte : content)
+			sum += byte;
+	}
+	return sum;
+}
+
+/**
+ * Read the blob in a child process.
+ *
+ * @return false if the child failed.
+ */
+bool run(const char* name, const char* path, const OId& oid, Method method)
+{
+	std::fflush(stdout);
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	pid_t pid = fork();
+	if(pid < 0)
+	{
+		std::perror("fork");
+		return false;
+	}
+	if(pid == 0)
+	{
+		try
+		{
+			uint64_t sum = read_blob(path, oid, method);
+			std::printf("%-8s sum %llu", name, (unsigned long long)sum);
+			std::fflush(stdout);
+			_exit(0);
+		}
+		catch(const Exception& e)
+		{
+			std::fprintf(stderr, "error: %s\n", e.what());
+			_exit(1);
+		}
+	}
+
+	int status;
+	struct rusage usage;
+	if(wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	{
+		std::printf("%s failed\n", name);
+		return false;
+	}
+	const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	// ru_maxrss is in kilobytes on Linux.
+	std::printf(", peak RSS %ldKB, %.3fs\n", usage.ru_maxrss, elapsed);
+	return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	if(argc != 3 || std::strlen(argv[2]) != GIT_OID_HEXSZ)
+	{
+		std::fprintf(stderr, "usage: %s <repository> <blob id>\n", argv[0]);
+		return 2;
+	}
+	git_libgit2_init();
+	OId oid;
+	try
+	{
+		OId::hexToOidMany(argv[2], 1, &oid);
+	}
+	catch(const Exception& e)
+	{
+		std::fprintf(stderr, "error: %s\n", e.what());
+		git_libgit2_shutdown();
+		return 2;
+	}
+
+	bool ok = run("baseline", argv[1], oid, METHOD_NONE)
+		&& run("reader", argv[1], oid, METHOD_READER)
+		&& run("content", argv[1], oid, METHOD_CONTENT);
+	git_libgit2_shutdown();
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+/*
+ * Check DiffList::stats() against the counts of the patches.
+ *
+ * Usage: bench-diffstats <repository> [<range>]
+ *
+ * Every commit of the range (HEAD and its history by default) is diffed
+ * with its first parent, and the line counts of each file computed by
+ * DiffList::stats() are compared with the ones of its patch. Unless the
+ * repository is bare, the index and the HEAD tree are also diffed with the
+ * working directory. Mismatches are printed, and make the program exit
+ * with 1.
+ */
+
+#include <git2.h>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "commit.hpp"
+#include "diff.hpp"
+#include "exception.hpp"
+#include "index.hpp"
+#include "ref.hpp"
+#include "repository.hpp"
+#include "revwalk.hpp"
+#include "tree.hpp"
+
+using namespace git2;
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+double seconds(Clock::duration duration)
+{
+	return std::chrono::duration<double>(duration).count();
+}
+
+/**
+ * Totals of the checks.
+ */
+struct Check
+{
+	size_t files = 0;
+	size_t mismatches = 0;
+	Clock::duration statsTime = Clock::duration(0);
+	Clock::duration patchTime = Clock::duration(0);
+};
+
+/**
+ * Compare the stats of a diff with the line counts of its patches.
+ * @param label Printed in front of the mismatching files.
+ */
+void check(const Repository& repo, const DiffList& diff, const std::string& label, Check& total)
+{
+	Clock::time_point start = Clock::now();
+	DiffStats stats = diff.stats(repo);
+	total.statsTime += Clock::now() - start;
+
+	start = Clock::now();
+	size_t file = 0;
+	for(size_t idx = 0; idx < diff.deltaCount(); ++idx)
+	{
+		const git_diff_delta *delta = git_diff_get_delta(diff.data(), idx);
+		if(delta->status==GIT_DELTA_UNMODIFIED || delta->status==GIT_DELTA_IGNORED)
+			continue;
+
+		const DiffFileStats& counted = stats.file(file++);
+		DiffPatch patch = diff.patch(idx);
+		size_t additions = 0, deletions = 0;
+		bool binary = !patch.ok() || (git_patch_get_delta(patch.data())->flags & GIT_DIFF_FLAG_BINARY);
+		if(!binary)
+			patch.lineStats(NULL, &additions, &deletions);
+		if(counted.binary!=binary || counted.additions!=additions || counted.deletions!=deletions)
+		{
+			std::printf("%s %s: stats +%zu -%zu%s, patch +%zu -%zu%s\n",
+				label.c_str(), counted.path.c_str(),
+				counted.additions, counted.deletions, counted.binary ? " binary" : "",
+				additions, deletions, binary ? " binary" : "");
+			++total.mismatches;
+		}
+	}
+	total.patchTime += Clock::now() - start;
+	total.files += file;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	if(argc < 2 || argc > 3)
+	{
+		std::fprintf(stderr, "usage: %s <repository> [<range>]\n", argv[0]);
+		return 2;
+	}
+	git_libgit2_init();
+
+	try
+	{
+		Repository repo = Repository::open(argv[1]);
+		RevWalk walk = repo.createRevWalk();
+		walk.setSorting(RevWalk::Topological | RevWalk::Time);
+		if(argc > 2)
+			walk.pushRange(argv[2]);
+		else
+			walk.pushHead();
+
+		size_t commits = 0;
+		Check total;
+		for(const Commit& commit : walk.commits())
+		{
+			Tree parentTree = commit.parentCount() > 0 ? commit.parent(0).tree() : Tree();
+			check(repo, repo.diffTreeToTree(parentTree, commit.tree()), commit.oid().format(), total);
+			++commits;
+		}
+		std::printf("%zu commits, %zu files, %zu mismatches\n", commits, total.files, total.mismatches);
+
+		if(!repo.isBare())
+		{
+			const size_t files = total.files, mismatches = total.mismatches;
+			check(repo, repo.diffIndexToWorkdir(repo.index()), "index..workdir", total);
+			if(commits > 0)
+			{
+				Tree head = repo.lookupCommit(repo.head().target()).tree();
+				check(repo, repo.diffTreeToWorkdir(head), "HEAD..workdir", total);
+			}
+			std::printf("working directory, %zu files, %zu mismatches\n",
+				total.files - files, total.mismatches - mismatches);
+		}
+
+		std::printf("stats %.3fs, patches %.3fs\n", seconds(total.statsTime), seconds(total.patchTime));
+		git_libgit2_shutdown();
+		return total.mismatches==0 ? 0 : 1;
+	}
+	catch(const Exception& e)
+	{
+		std::fprintf(stderr, "error: %s\n", e.what());
+		git_libgit2_shutdown();
+		return 2;
+	}
+}
@@ -0,0 +1,211 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+/*
+ * Count the allocations and reference count updates of a lookup loop.
+ *
+ * Usage: bench-lookup <repository> [<rounds>]
+ *
+ * The commits of HEAD are looked up, along with their tree, and kept in
+ * a vector: with the wrapper classes moved into the vectors, with the
+ * wrappers copied as they were before they could be moved, and with the
+ * libgit2 pointers held by std::shared_ptr, as the wrappers used to hold
+ * them.
+ *
+ * The allocations made through operator new are counted. The library is
+ * compiled with GIT2PP_COUNT_REF_UPDATES, which makes the wrappers count
+ * the reference count updates they make: their shared counts, and the
+ * libgit2 references they duplicate or release. The ones made by
+ * std::shared_ptr cannot be counted.
+ */
+
+#include <git2.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "alloccount.hpp"
+#include "commit.hpp"
+#include "exception.hpp"
+#include "oid.hpp"
+#include "repository.hpp"
+#include "revwalk.hpp"
+#include "tree.hpp"
+
+#ifndef GIT2PP_COUNT_REF_UPDATES
+#error "bench-lookup needs the library compiled with GIT2PP_COUNT_REF_UPDATES"
+#endif
+
+using namespace git2;
+
+namespace
+{
+
+const size_t max_commits = 10000;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Result
+{
+	size_t allocations;
+	size_t refcountUpdates;
+	bool counted;
+	double seconds;
+};
+
+void print(const char* name, const Result& result, size_t lookups)
+{
+	if(result.counted)
+		std::printf("%-10s %6.2f allocations, %6.2f refcount updates, %7.1fns per lookup\n", name,
+			(double)result.allocations / lookups, (double)result.refcountUpdates / lookups,
+			result.seconds * 1e9 / lookups);
+	else
+		std::printf("%-10s %6.2f allocations, %22s %7.1fns per lookup\n", name,
+			(double)result.allocations / lookups, "uncounted,", result.seconds * 1e9 / lookups);
+}
+
+template<class Keep>
+Result lookup_wrappers(const Repository& repo, const std::vector<OId>& ids, size_t rounds, Keep keep)
+{
+	std::vector<Commit> commits;
+	std::vector<Tree> trees;
+	commits.reserve(ids.size());
+	trees.reserve(ids.size());
+
+	const size_t allocations = bench::allocations();
+	const unsigned long updates = helper::ref_updates;
+	const Clock::time_point start = Clock::now();
+	for(size_t round = 0; round < rounds; ++round)
+	{
+		commits.clear();
+		trees.clear();
+		for(const OId& id : ids)
+			keep(repo.lookupCommit(id), commits, trees);
+	}
+	commits.clear();
+	trees.clear();
+	Result result;
+	result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	result.allocations = bench::allocations() - allocations;
+	result.refcountUpdates = helper::ref_updates - updates;
+	result.counted = true;
+	return result;
+}
+
+void move_wrappers(Commit commit, std::vector<Commit>& commits, std::vector<Tree>& trees)
+{
+	trees.push_back(commit.tree());
+	commits.push_back(std::move(commit));
+}
+
+void copy_wrappers(Commit commit, std::vector<Commit>& commits, std::vector<Tree>& trees)
+{
+	const Tree tree = commit.tree();
+	trees.push_back(tree);
+	commits.push_back(commit);
+}
+
+Result lookup_shared_ptrs(const Repository& repo, const std::vector<OId>& ids, size_t rounds)
+{
+	std::vector<std::shared_ptr<git_commit>> commits;
+	std::vector<std::shared_ptr<git_tree>> trees;
+	commits.reserve(ids.size());
+	trees.reserve(ids.size());
+
+	const size_t allocations = bench::allocations();
+	const Clock::time_point start = Clock::now();
+	for(size_t round = 0; round < rounds; ++round)
+	{
+		commits.clear();
+		trees.clear();
+		for(const OId& id : ids)
+		{
+			git_commit* rawCommit;
+			Exception::git2_assert(git_commit_lookup(&rawCommit, repo.data(), id.constData()));
+			std::shared_ptr<git_commit> commit(rawCommit, git_commit_free);
+			git_tree* rawTree;
+			Exception::git2_assert(git_commit_tree(&rawTree, commit.get()));
+			std::shared_ptr<git_tree> tree(rawTree, git_tree_free);
+
+			// Without move constructors, the wrappers were copied.
+			trees.push_back(tree);
+			commits.push_back(commit);
+		}
+	}
+	commits.clear();
+	trees.clear();
+	Result result;
+	result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	result.allocations = bench::allocations() - allocations;
+	result.refcountUpdates = 0;
+	result.counted = false;
+	return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	if(argc < 2 || argc > 3)
+	{
+		std::fprintf(stderr, "usage: %s <repository> [<rounds>]\n", argv[0]);
+		return 2;
+	}
+	const size_t rounds = argc > 2 ? std::strtoul(argv[2], NULL, 10) : 10;
+	git_libgit2_init();
+
+	try
+	{
+		Repository repo = Repository::open(argv[1]);
+		std::vector<OId> ids;
+		{
+			RevWalk walk = repo.createRevWalk();
+			walk.pushHead();
+			OId oid;
+			while(ids.size() < max_commits && walk.next(oid))
+				ids.push_back(oid);
+		}
+		if(ids.empty() || rounds == 0)
+		{
+			std::printf("nothing to look up\n");
+			git_libgit2_shutdown();
+			return 0;
+		}
+
+		// Warm the object cache of the repository for both runs.
+		lookup_wrappers(repo, ids, 1, move_wrappers);
+
+		const size_t lookups = ids.size() * rounds;
+		std::printf("%zu commits, %zu rounds\n", ids.size(), rounds);
+		print("moved", lookup_wrappers(repo, ids, rounds, move_wrappers), lookups);
+		print("copied", lookup_wrappers(repo, ids, rounds, copy_wrappers), lookups);
+		print("shared_ptr", lookup_shared_ptrs(repo, ids, rounds), lookups);
+		git_libgit2_shutdown();
+		return 0;
+	}
+	catch(const Exception& e)
+	{
+		std::fprintf(stderr, "error: %s\n", e.what());
+		git_libgit2_shutdown();
+		return 2;
+	}
+}
@@ -0,0 +1,180 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+/*
+ * Check the hex kernels of OId against libgit2.
+ *
+ * Usage: bench-oidhex [<count>]
+ *
+ * OId::formatMany() and OId::hexToOidMany() are run over random ids, in
+ * mixed case, and over ids with one invalid char, and compared with
+ * git_oid_fmt() and git_oid_fromstrn(). Mismatches are printed, and make
+ * the program exit with 1.
+ *
+ * The kernel depends on the build: bench-oidhex uses AVX2 when the CPU
+ * supports it and SSE2 otherwise, bench-oidhex-sse2 always uses SSE2 and
+ * bench-oidhex-scalar the portable code.
+ */
+
+#include <git2.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "exception.hpp"
+#include "oid.hpp"
+
+using namespace git2;
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+const size_t stride = GIT_OID_HEXSZ + 1;
+
+double nanoseconds_per_id(Clock::duration duration, size_t count)
+{
+	return std::chrono::duration<double, std::nano>(duration).count() / count;
+}
+
+/**
+ * Chars around the ranges of the hex digits, and outside ASCII.
+ */
+const char invalid_chars[] = {'\0', ' ', '/', ':', '@', 'G', '`', 'g', 'z', '\x7f', '\x80', '\xb0', '\xe6', '\xff'};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	const size_t count = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 100000;
+	if(count == 0)
+	{
+		std::fprintf(stderr, "usage: %s [<count>]\n", argv[0]);
+		return 2;
+	}
+	git_libgit2_init();
+
+	std::mt19937 random(42);
+	std::vector<OId> ids(count);
+	for(OId& id : ids)
+	{
+		git_oid raw;
+		for(unsigned char& byte : raw.id)
+			byte = random();
+		id = OId(&raw);
+	}
+
+	size_t mismatches = 0;
+
+	// Format, with separators the kernels must leave alone.
+	std::vector<char> hex(count * stride, '\n');
+	Clock::time_point start = Clock::now();
+	OId::formatMany(ids.data(), count, hex.data(), stride);
+	Clock::duration formatTime = Clock::now() - start;
+
+	std::vector<char> expected(count * stride, '\n');
+	start = Clock::now();
+	for(size_t n = 0; n < count; ++n)
+		git_oid_fmt(&expected[n * stride], ids[n].constData());
+	Clock::duration fmtTime = Clock::now() - start;
+
+	for(size_t n = 0; n < count; ++n)
+	{
+		if(std::memcmp(&hex[n * stride], &expected[n * stride], stride) != 0)
+		{
+			std::printf("format %.40s: got %.40s\n", &expected[n * stride], &hex[n * stride]);
+			++mismatches;
+		}
+	}
+
+	// Parse, in mixed case.
+	for(char& c : hex)
+	{
+		if(c >= 'a' && c <= 'f' && (random() & 1))
+			c -= 'a' - 'A';
+	}
+	std::vector<OId> parsed(count);
+	start = Clock::now();
+	OId::hexToOidMany(hex.data(), count, parsed.data(), stride);
+	Clock::duration parseTime = Clock::now() - start;
+
+	std::vector<git_oid> reference(count);
+	start = Clock::now();
+	for(size_t n = 0; n < count; ++n)
+		git_oid_fromstrn(&reference[n], &hex[n * stride], GIT_OID_HEXSZ);
+	Clock::duration fromstrnTime = Clock::now() - start;
+
+	for(size_t n = 0; n < count; ++n)
+	{
+		if(git_oid_cmp(parsed[n].constData(), &reference[n]) != 0 || !(parsed[n] == ids[n]))
+		{
+			std::printf("parse %.40s: got %s\n", &hex[n * stride], parsed[n].format().c_str());
+			++mismatches;
+		}
+	}
+
+	// Reject an invalid char at any position, as libgit2 does.
+	size_t rejected = 0;
+	for(size_t n = 0; n < std::min<size_t>(count, 64); ++n)
+	{
+		for(size_t position = 0; position < GIT_OID_HEXSZ; ++position)
+		{
+			for(char invalid : invalid_chars)
+			{
+				char buffer[GIT_OID_HEXSZ];
+				std::memcpy(buffer, &hex[n * stride], GIT_OID_HEXSZ);
+				buffer[position] = invalid;
+
+				git_oid oid;
+				const bool libgit2Fails = git_oid_fromstrn(&oid, buffer, GIT_OID_HEXSZ) < 0;
+				bool fails = false;
+				try
+				{
+					OId result;
+					OId::hexToOidMany(buffer, 1, &result);
+				}
+				catch(const Exception&)
+				{
+					fails = true;
+				}
+				if(fails != libgit2Fails)
+				{
+					std::printf("invalid char 0x%02x at %zu of %.40s: %s\n", (unsigned char)invalid, position,
+						&hex[n * stride], fails ? "rejected" : "accepted");
+					++mismatches;
+				}
+				rejected += fails;
+			}
+		}
+	}
+
+	std::printf("%zu ids, %zu invalid ids rejected, %zu mismatches\n", count, rejected, mismatches);
+	std::printf("formatMany %.1fns/id, git_oid_fmt %.1fns/id\n",
+		nanoseconds_per_id(formatTime, count), nanoseconds_per_id(fmtTime, count));
+	std::printf("hexToOidMany %.1fns/id, git_oid_fromstrn %.1fns/id\n",
+		nanoseconds_per_id(parseTime, count), nanoseconds_per_id(fromstrnTime, count));
+	git_libgit2_shutdown();
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+/*
+ * Count the allocations made per walked commit.
+ *
+ * Usage: bench-walk <repository> [<max commits>]
+ *
+ * The history of HEAD is walked by time; every commit is looked up, and
+ * its parent ids, tree and the ids of the entries of its tree are read,
+ * as history mining jobs do. The allocations made through operator new
+ * are counted.
+ *
+ * The walk is made twice: keeping the ids read in OId, and keeping them
+ * in a copy of the OId class of the previous versions, which stored its
+ * bytes in a std::vector.
+ */
+
+#include <git2.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "alloccount.hpp"
+#include "commit.hpp"
+#include "exception.hpp"
+#include "oid.hpp"
+#include "repository.hpp"
+#include "revwalk.hpp"
+#include "tree.hpp"
+
+using namespace git2;
+
+namespace
+{
+
+/**
+ * Object id as the OId class of the previous versions stored it.
+ */
+class VectorOId
+{
+public:
+	explicit VectorOId(const OId& oid):
+	_oid(oid.constData()->id, oid.constData()->id + GIT_OID_RAWSZ)
+	{
+	}
+
+	unsigned char firstByte() const {return _oid[0];}
+
+private:
+	std::vector<unsigned char> _oid;
+};
+
+unsigned char first_byte(const OId& oid)
+{
+	return oid.constData()->id[0];
+}
+
+unsigned char first_byte(const VectorOId& oid)
+{
+	return oid.firstByte();
+}
+
+struct Result
+{
+	size_t commits;
+	size_t ids;
+	size_t allocations;
+	unsigned char checksum;
+	double seconds;
+};
+
+/**
+ * Walk the history of HEAD, keeping every id read as an Id.
+ */
+template<class Id>
+Result walk_history(Repository& repo, size_t maxCommits)
+{
+	RevWalk walk = repo.createRevWalk();
+	walk.setSorting(RevWalk::Time);
+	walk.pushHead();
+
+	Result result = Result();
+	const size_t allocations = bench::allocations();
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	OId oid;
+	while(result.commits < maxCommits && walk.next(oid))
+	{
+		Commit commit = repo.lookupCommit(oid);
+		++result.ids;
+		for(unsigned int n = 0; n < commit.parentCount(); ++n, ++result.ids)
+		{
+			const Id parent(commit.parentId(n));
+			result.checksum ^= first_byte(parent);
+		}
+
+		Tree tree = commit.tree();
+		const Id treeId(tree.oid());
+		result.checksum ^= first_byte(treeId);
+		++result.ids;
+		const size_t entries = tree.entryCount();
+		for(size_t n = 0; n < entries; ++n, ++result.ids)
+		{
+			const Id entry(tree.entryByIndex(n).oid());
+			result.checksum ^= first_byte(entry);
+		}
+		++result.commits;
+	}
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	result.allocations = bench::allocations() - allocations;
+	return result;
+}
+
+void print(const char* name, const Result& result)
+{
+	std::printf("%-10s %.2f allocations per commit (checksum %02x), %.3fs\n", name,
+		(double)result.allocations / result.commits, result.checksum, result.seconds);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	if(argc < 2 || argc > 3)
+	{
+		std::fprintf(stderr, "usage: %s <repository> [<max commits>]\n", argv[0]);
+		return 2;
+	}
+	const size_t maxCommits = argc > 2 ? std::strtoul(argv[2], NULL, 10) : (size_t)-1;
+	git_libgit2_init();
+
+	try
+	{
+		Repository repo = Repository::open(argv[1]);
+
+		// Warm the object cache of the repository for both walks.
+		const Result warm = walk_history<OId>(repo, maxCommits);
+		if(warm.commits == 0)
+		{
+			std::printf("no commit walked\n");
+			git_libgit2_shutdown();
+			return 0;
+		}
+		std::printf("%zu commits, %.2f ids per commit\n", warm.commits, (double)warm.ids / warm.commits);
+		print("OId", walk_history<OId>(repo, maxCommits));
+		print("vector", walk_history<VectorOId>(repo, maxCommits));
+		git_libgit2_shutdown();
+		return 0;
+	}
+	catch(const Exception& e)
+	{
+		std::fprintf(stderr, "error: %s\n", e.what());
+		git_libgit2_shutdown();
+		return 2;
+	}
+}
@@ -19,10 +19,125 @@
 
 #include "blob.hpp"
 
+#include "blobstream.hpp"
+#include "exception.hpp"
+#include "oid.hpp"
+#include "repository.hpp"
+
+#include <cerrno>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace git2
 {
 
+namespace
+{
+
+const size_t copy_chunk_size = 1024*1024;
+
+void throw_mapping_error(const std::string& msg, int err = GIT_ERROR)
+{
+    giterr_set_str(GITERR_OS, msg.c_str());
+    throw Exception(err);
+}
+
+/**
+ * Map a file of the expected size.
+ *
+ * @return The mapping; MAP_FAILED if the file does not exist or has
+ * another size.
+ */
+void* map_file(const std::string& path, size_t size)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return MAP_FAILED;
+
+    struct stat st;
+    void* map = MAP_FAILED;
+    if(::fstat(fd, &st) == 0 && (uint64_t)st.st_size == size)
+        map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    return map;
+}
+
+/**
+ * Write a whole buffer to a file descriptor.
+ */
+bool write_all(int fd, const char* buffer, size_t size)
+{
+    while(size > 0)
+    {
+        ssize_t written = ::write(fd, buffer, size);
+        if(written < 0 && errno == EINTR)
+            continue;
+        if(written <= 0)
+            return false;
+        buffer += written;
+        size -= written;
+    }
+    return true;
+}
+
+/**
+ * Inflate a blob to a file, a chunk at a time, through a temporary file
+ * renamed at the end once its content matches the blob id.
+ */
+void write_blob_file(const std::string& path, const Repository& repo, const OId& oid, size_t size)
+{
+    std::string tmp = path + ".XXXXXX";
+    int fd = ::mkstemp(&tmp[0]);
+    if(fd < 0)
+        throw_mapping_error("cannot create '" + tmp + "'");
+
+    bool failed = ::fchmod(fd, 0644) != 0;
+    try
+    {
+        BlobReader reader(repo, oid);
+        std::vector<char> buffer(copy_chunk_size);
+        for(size_t count; !failed && (count = reader.read(buffer.data(), buffer.size())) > 0;)
+            failed = !write_all(fd, buffer.data(), count);
+    }
+    catch(...)
+    {
+        ::close(fd);
+        ::unlink(tmp.c_str());
+        throw;
+    }
+    failed = ::close(fd) != 0 || failed;
+
+    // Hash the mapped file, so the check does not need the content in
+    // memory either.
+    bool corrupted = false;
+    if(!failed)
+    {
+        void* map = map_file(tmp, size);
+        git_oid id;
+        failed = map == MAP_FAILED;
+        corrupted = !failed && (git_odb_hash(&id, map, size, GIT_OBJ_BLOB) != GIT_OK || git_oid_cmp(&id, oid.constData()) != 0);
+        if(!failed)
+            ::munmap(map, size);
+    }
+
+    if(failed || corrupted || ::rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        ::unlink(tmp.c_str());
+        if(corrupted)
+        {
+            giterr_set_str(GITERR_ODB, ("content of blob " + oid.format() + " does not match its id").c_str());
+            throw Exception(GIT_ERROR);
+        }
+        throw_mapping_error("cannot write '" + path + "'");
+    }
+}
+
+} // namespace
+
 Blob::Blob(git_blob *blob):
 Object(reinterpret_cast<git_object*>(blob))
 {
@@ -49,6 +164,11 @@ const void* Blob::rawContent() const
     return git_blob_rawcontent(data());
 }
 
+StringView Blob::contentView() const
+{
+    return StringView(static_cast<const char *>(rawContent()), rawSize());
+}
+
 std::vector<unsigned char> Blob::content() const
 {
     return std::vector<unsigned char>( static_cast<const char *>(rawContent()), static_cast<const char *>(rawContent())+rawSize() );
@@ -64,5 +184,82 @@ git_blob* Blob::data()const
 	return reinterpret_cast<git_blob*>(Object::data());
 }
 
+
+//
+// MappedBlob
+//
+struct MappedBlob::Storage
+{
+    Storage(void* m, size_t s):
+    map(m), size(s)
+    {
+    }
+
+    ~Storage()
+    {
+        if(map != nullptr)
+            ::munmap(map, size);
+    }
+
+    Storage(const Storage&) = delete;
+    Storage& operator=(const Storage&) = delete;
+
+    void* map;
+    size_t size;
+};
+
+MappedBlob::MappedBlob()
+{
+}
+
+MappedBlob::MappedBlob(std::shared_ptr<const Storage> storage):
+_storage(storage)
+{
+}
+
+MappedBlob MappedBlob::open(const Repository& repo, const OId& oid, const std::string& directory)
+{
+    helper::Git2PtrWrapper<git_odb, git_odb_free> odb;
+    {
+        git_odb *db;
+        Exception::git2_assert(git_repository_odb(&db, repo.data()));
+        odb = helper::Git2PtrWrapper<git_odb, git_odb_free>(db);
+    }
+
+    // The header gives the size without inflating the whole blob.
+    size_t size;
+    git_otype type;
+    Exception::git2_assert(git_odb_read_header(&size, &type, odb.data(), oid.constData()));
+    if(type != GIT_OBJ_BLOB)
+    {
+        giterr_set_str(GITERR_INVALID, ("object " + oid.format() + " is not a blob").c_str());
+        throw Exception(GIT_ENOTFOUND);
+    }
+    if(size == 0)
+        return MappedBlob(std::make_shared<Storage>(nullptr, 0));
+
+    const std::string path = directory + "/" + oid.format();
+    void* map = map_file(path, size);
+    if(map == MAP_FAILED)
+    {
+        write_blob_file(path, repo, oid, size);
+        map = map_file(path, size);
+        if(map == MAP_FAILED)
+            throw_mapping_error("cannot map '" + path + "'");
+    }
+    return MappedBlob(std::make_shared<Storage>(map, size));
+}
+
+StringView MappedBlob::content() const
+{
+    return _storage && _storage->map != nullptr
+        ? StringView(static_cast<const char*>(_storage->map), _storage->size) : StringView();
+}
+
+size_t MappedBlob::size() const
+{
+    return _storage ? _storage->size : 0;
+}
+
 } // namespace git2
 
@@ -23,10 +23,19 @@
 #include <git2.h>
 
 #include "object.hpp"
+#include "stringview.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace git2
 {
 
+class OId;
+class Repository;
+
 /**
  * Representation of a Git Blob object.
  */
@@ -50,6 +59,14 @@ public:
      */
     Blob(const Blob& other);
 
+    /**
+     * Move constructor; takes over the underlaying data structure.
+     */
+    Blob(Blob&& other) = default;
+
+    Blob& operator=(const Blob& other) = default;
+    Blob& operator=(Blob&& other) = default;
+
 
     /**
      * Determine if the blob content is most certainly binary or not.
@@ -70,7 +87,16 @@ public:
     const void* rawContent() const;
 
     /**
-      * @return The blob content as vector.
+     * View on the content of this blob, without copying it.
+     *
+     * The view borrows the buffer of the blob: it stays valid as long as
+     * a copy of this Blob exists.
+     */
+    StringView contentView() const;
+
+    /**
+      * @return A copy of the blob content as vector; use contentView()
+      * to read it in place.
       */
     std::vector<unsigned char> content() const;
 
@@ -84,6 +110,66 @@ public:
     git_blob* data() const;
 };
 
+/**
+ * Content of a blob mapped from a file, to serve large blobs without
+ * keeping them in the heap.
+ *
+ * Git stores blobs compressed, loose or packed, so the repository has no
+ * file to map a blob from. open() inflates the blob once into a file of
+ * a cache directory, named after the id of the blob, and maps this file.
+ * Later opens, from any process, map the file again without reading the
+ * object database, and the content is kept in the page cache.
+ *
+ * A MappedBlob is immutable. Copies share the same mapping.
+ */
+class MappedBlob
+{
+public:
+    /**
+     * Create an empty mapping.
+     */
+    MappedBlob();
+
+    /**
+     * Map the content of a blob, inflating it into the cache directory
+     * first if it is not there yet.
+     *
+     * The blob is inflated through a BlobReader, a chunk at a time, so
+     * only blobs stored as deltas are ever held in memory. The file is
+     * written next to its final path, checked against the blob id and then
+     * renamed, so readers never see a partial or corrupted file.
+     *
+     * An existing file is trusted as long as its size matches the blob:
+     * hashing it again would cost a full read at each open. Nothing is
+     * ever removed from the directory; its owner has to evict old files,
+     * e.g. by access time.
+     *
+     * @param repo Repository of the blob.
+     * @param oid Id of the blob.
+     * @param directory Existing directory to keep the inflated blobs in.
+     * @throws Exception GIT_ENOTFOUND if there is no such blob.
+     */
+    static MappedBlob open(const Repository& repo, const OId& oid, const std::string& directory);
+
+    /**
+     * View on the mapped content, valid as long as a copy of the mapping
+     * exists.
+     */
+    StringView content() const;
+
+    /**
+     * Size of the content in bytes.
+     */
+    size_t size() const;
+
+    struct Storage;
+
+private:
+    explicit MappedBlob(std::shared_ptr<const Storage> storage);
+
+    std::shared_ptr<const Storage> _storage;
+};
+
 } // namespace git2
 #endif // _GIT2PP_BLOB_HPP_
 
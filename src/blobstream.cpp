@@ -0,0 +1,429 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#include "blobstream.hpp"
+
+#include "database.hpp"
+#include "exception.hpp"
+#include "oid.hpp"
+#include "packindex.hpp"
+#include "repository.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+namespace git2
+{
+
+/**
+ * Where the content of a blob is read from.
+ */
+class BlobReader::Source
+{
+public:
+	virtual ~Source() {}
+
+	/**
+	 * Read at most length bytes, less only at the end of the content.
+	 */
+	virtual size_t read(char* buffer, size_t length) = 0;
+};
+
+namespace
+{
+
+const size_t   input_size           = 64*1024;
+const size_t   max_loose_header     = 64;
+const size_t   spool_chunk_size     = 64*1024;
+
+void throw_stream_error(const std::string& msg, int klass = GITERR_ODB)
+{
+	giterr_set_str(klass, msg.c_str());
+	throw Exception(GIT_ERROR);
+}
+
+git_odb* repository_odb(const Repository& repo)
+{
+	git_odb *odb;
+	Exception::git2_assert(git_repository_odb(&odb, repo.data()));
+	return odb;
+}
+
+/**
+ * Content read from a stream of the object database.
+ */
+class OdbStreamSource : public BlobReader::Source
+{
+public:
+	explicit OdbStreamSource(git_odb_stream* stream):
+	_stream(stream)
+	{
+	}
+
+	~OdbStreamSource()
+	{
+		git_odb_stream_free(_stream);
+	}
+
+	size_t read(char* buffer, size_t length) override
+	{
+		size_t done = 0;
+		while(done<length)
+		{
+			int res = Exception::git2_assert(git_odb_stream_read(_stream, buffer+done, length-done));
+			if(res==0)
+				break;
+			done += res;
+		}
+		return done;
+	}
+
+private:
+	git_odb_stream* _stream;
+};
+
+/**
+ * Content of an object read in memory at once.
+ */
+class MemorySource : public BlobReader::Source
+{
+public:
+	explicit MemorySource(DatabaseObject&& object):
+	_object(std::move(object)),
+	_offset(0)
+	{
+	}
+
+	size_t read(char* buffer, size_t length) override
+	{
+		length = std::min(length, _object.size()-_offset);
+		std::memcpy(buffer, static_cast<const char*>(_object.raw())+_offset, length);
+		_offset += length;
+		return length;
+	}
+
+private:
+	DatabaseObject _object;
+	size_t _offset;
+};
+
+/**
+ * Content inflated from a part of a file, a loose object or a pack entry,
+ * a buffer at a time.
+ */
+class InflateSource : public BlobReader::Source
+{
+public:
+	/**
+	 * @param fd File to read, closed by the source.
+	 * @param offset Position of the zlib stream in the file.
+	 * @param path Path of the file, for the error messages.
+	 */
+	InflateSource(int fd, uint64_t offset, const std::string& path):
+	_fd(fd),
+	_offset(offset),
+	_path(path),
+	_input(input_size),
+	_end(false)
+	{
+		std::memset(&_zs, 0, sizeof(_zs));
+		if(::inflateInit(&_zs)!=Z_OK)
+		{
+			::close(_fd);
+			throw_stream_error("cannot initialize zlib", GITERR_ZLIB);
+		}
+	}
+
+	~InflateSource()
+	{
+		::inflateEnd(&_zs);
+		::close(_fd);
+	}
+
+	size_t read(char* buffer, size_t length) override
+	{
+		size_t done = 0;
+		while(done<length && !_end)
+		{
+			if(_zs.avail_in==0)
+			{
+				ssize_t count = ::pread(_fd, _input.data(), _input.size(), _offset);
+				if(count<0 && errno==EINTR)
+					continue;
+				if(count<=0)
+					throw_stream_error("truncated object in '" + _path + "'");
+				_offset += count;
+				_zs.next_in = _input.data();
+				_zs.avail_in = count;
+			}
+
+			const size_t chunk = std::min<size_t>(length-done, 1u << 30);
+			_zs.next_out = reinterpret_cast<Bytef*>(buffer+done);
+			_zs.avail_out = chunk;
+			int res = ::inflate(&_zs, Z_NO_FLUSH);
+			done += chunk-_zs.avail_out;
+			if(res==Z_STREAM_END)
+				_end = true;
+			else if(res!=Z_OK && res!=Z_BUF_ERROR)
+				throw_stream_error("corrupted object in '" + _path + "'", GITERR_ZLIB);
+		}
+		return done;
+	}
+
+private:
+	int _fd;
+	uint64_t _offset;
+	std::string _path;
+	std::vector<unsigned char> _input;
+	z_stream _zs;
+	bool _end;
+};
+
+/**
+ * Open the loose object file of a blob, after its "blob <size>" header.
+ *
+ * @return The source; null if the blob is not a loose object.
+ */
+std::unique_ptr<BlobReader::Source> open_loose(const std::string& objectsDir, const OId& oid, size_t size)
+{
+	const std::string hex = oid.format();
+	const std::string path = objectsDir + hex.substr(0, 2) + "/" + hex.substr(2);
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if(fd<0)
+		return nullptr;
+
+	std::unique_ptr<BlobReader::Source> source(new InflateSource(fd, 0, path));
+	std::string header;
+	char c;
+	while(header.size()<max_loose_header && source->read(&c, 1)==1 && c!='\0')
+		header.push_back(c);
+	if(header!="blob " + std::to_string(size))
+		throw_stream_error("corrupted loose object '" + path + "'");
+	return source;
+}
+
+/**
+ * Open the pack entry of a blob, after its header.
+ *
+ * @return The source; null if the blob is not in a pack or is stored as
+ * a delta.
+ */
+std::unique_ptr<BlobReader::Source> open_packed(const std::string& objectsDir, const OId& oid, size_t size)
+{
+	for(const std::shared_ptr<const helper::PackIndex>& index : helper::pack_indexes(objectsDir))
+	{
+		size_t position;
+		if(!index->find(*oid.constData(), position))
+			continue;
+
+		const uint64_t offset = index->offset(position);
+		const std::string& path = index->packPath();
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if(fd<0)
+			continue;
+
+		// Type and size of the entry: 3 bits and a little-endian varint.
+		unsigned char header[16];
+		ssize_t count = ::pread(fd, header, sizeof(header), offset);
+		ssize_t pos = 1;
+		uint64_t entrySize = count>0 ? header[0] & 15 : 0;
+		for(unsigned int shift = 4; count>0 && (header[pos-1] & 0x80) && pos<count; shift += 7, ++pos)
+			entrySize |= (uint64_t)(header[pos] & 0x7f) << shift;
+		if(count<=0 || (header[pos-1] & 0x80) || ((header[0]>>4) & 7)!=GIT_OBJ_BLOB || entrySize!=size)
+		{
+			::close(fd);
+			return nullptr;
+		}
+		return std::unique_ptr<BlobReader::Source>(new InflateSource(fd, offset+pos, path));
+	}
+	return nullptr;
+}
+
+} // namespace
+
+
+BlobReader::BlobReader(const Repository& repo, const OId& oid):
+_size(0),
+_offset(0)
+{
+	git_odb *db = repository_odb(repo);
+	helper::Git2PtrWrapper<git_odb, git_odb_free> odb(db);
+
+	git_otype type;
+	Exception::git2_assert(git_odb_read_header(&_size, &type, db, oid.constData()));
+	if(type!=GIT_OBJ_BLOB)
+	{
+		giterr_set_str(GITERR_INVALID, ("object " + oid.format() + " is not a blob").c_str());
+		throw Exception(GIT_ENOTFOUND);
+	}
+
+	// Inflate the object ourselves from the files of the repository: the
+	// read streams of the default backends hold the whole compressed
+	// object in memory.
+	if(const char* path = git_repository_path(repo.data()))
+	{
+		const std::string objectsDir = std::string(path) + "objects/";
+		for(const std::string& dir : helper::object_dirs(objectsDir))
+		{
+			_source = open_loose(dir + "/", oid, _size);
+			if(_source)
+				return;
+		}
+		_source = open_packed(objectsDir, oid, _size);
+		if(_source)
+			return;
+	}
+
+	// Custom backends may stream the object.
+	git_odb_stream* stream;
+	if(git_odb_open_rstream(&stream, db, oid.constData())==GIT_OK)
+	{
+		_source.reset(new OdbStreamSource(stream));
+		return;
+	}
+	giterr_clear();
+
+	git_odb_object *obj;
+	Exception::git2_assert(git_odb_read(&obj, db, oid.constData()));
+	_source.reset(new MemorySource(DatabaseObject(obj)));
+}
+
+BlobReader::~BlobReader()
+{
+}
+
+size_t BlobReader::read(void* buffer, size_t length)
+{
+	length = std::min(length, remaining());
+	if(length==0)
+		return 0;
+	size_t count = _source->read(static_cast<char*>(buffer), length);
+	if(count<length)
+		throw_stream_error("truncated blob");
+	_offset += count;
+	return count;
+}
+
+
+
+BlobWriter::BlobWriter(const Repository& repo, size_t size):
+_odb(repository_odb(repo)),
+_stream(nullptr),
+_spool(nullptr),
+_size(size),
+_written(0),
+_finalized(false)
+{
+	open(size);
+}
+
+BlobWriter::BlobWriter(const Repository& repo):
+_odb(repository_odb(repo)),
+_stream(nullptr),
+_spool(std::tmpfile()),
+_size(0),
+_written(0),
+_finalized(false)
+{
+	if(_spool==nullptr)
+		throw_stream_error("cannot create a temporary file for the blob", GITERR_OS);
+}
+
+BlobWriter::~BlobWriter()
+{
+	if(_stream!=nullptr)
+		git_odb_stream_free(_stream);
+	if(_spool!=nullptr)
+		std::fclose(_spool);
+}
+
+void BlobWriter::open(size_t size)
+{
+	if(_stream!=nullptr)
+	{
+		git_odb_stream_free(_stream);
+		_stream = nullptr;
+	}
+	Exception::git2_assert(git_odb_open_wstream(&_stream, _odb.data(), size, GIT_OBJ_BLOB));
+}
+
+void BlobWriter::write(const void* data, size_t length)
+{
+	if(_finalized)
+		throw_stream_error("blob already finalized", GITERR_INVALID);
+
+	if(_spool!=nullptr)
+	{
+		if(std::fwrite(data, 1, length, _spool)!=length)
+			throw_stream_error("cannot write the temporary file of the blob", GITERR_OS);
+	}
+	else
+	{
+		if(length>_size-_written)
+			throw_stream_error("blob content longer than its size", GITERR_INVALID);
+		Exception::git2_assert(git_odb_stream_write(_stream, static_cast<const char*>(data), length));
+	}
+	_written += length;
+}
+
+OId BlobWriter::finalize()
+{
+	if(_finalized)
+		throw_stream_error("blob already finalized", GITERR_INVALID);
+
+	if(_spool!=nullptr)
+	{
+		// The size is known now: replay the spooled content.
+		open(_written);
+		_size = _written;
+		if(std::fflush(_spool)!=0 || std::fseek(_spool, 0, SEEK_SET)!=0)
+			throw_stream_error("cannot read the temporary file of the blob", GITERR_OS);
+		std::vector<char> buffer(spool_chunk_size);
+		for(size_t left = _size; left>0;)
+		{
+			size_t count = std::fread(buffer.data(), 1, std::min(left, buffer.size()), _spool);
+			if(count==0)
+				throw_stream_error("cannot read the temporary file of the blob", GITERR_OS);
+			Exception::git2_assert(git_odb_stream_write(_stream, buffer.data(), count));
+			left -= count;
+		}
+		std::fclose(_spool);
+		_spool = nullptr;
+	}
+
+	if(_written!=_size)
+		throw_stream_error("blob content shorter than its size", GITERR_INVALID);
+
+	git_oid oid;
+	Exception::git2_assert(git_odb_stream_finalize_write(&oid, _stream));
+	_finalized = true;
+	git_odb_stream_free(_stream);
+	_stream = nullptr;
+	return OId(&oid);
+}
+
+} // namespace git2
@@ -0,0 +1,169 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#ifndef _GIT2PP_BLOBSTREAM_HPP_
+#define _GIT2PP_BLOBSTREAM_HPP_
+
+#include <git2.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+
+#include "common.hpp"
+
+namespace git2
+{
+
+class OId;
+class Repository;
+
+/**
+ * Reader of the content of a blob, a chunk at a time, in constant memory
+ * whatever the size of the blob.
+ *
+ * The blob is inflated while it is read, from its loose object file or
+ * from its pack when it is not stored as a delta, alternate object
+ * databases included. Blobs found in neither, e.g. in the custom backends
+ * of an in-memory repository, come from a read stream of the object
+ * database when the backend provides one. Only the blobs stored as deltas
+ * are read in memory at once, as libgit2 would anyway. Pack indexes are
+ * mapped once per process and shared by all the readers.
+ *
+ * A BlobReader is not thread safe.
+ */
+class BlobReader
+{
+public:
+	/**
+	 * Open a blob for reading.
+	 *
+	 * @param repo Repository of the blob.
+	 * @param oid Id of the blob.
+	 * @throws Exception GIT_ENOTFOUND if there is no such blob.
+	 */
+	BlobReader(const Repository& repo, const OId& oid);
+	~BlobReader();
+
+	BlobReader(const BlobReader&) = delete;
+	BlobReader& operator=(const BlobReader&) = delete;
+
+	/**
+	 * Size of the content in bytes.
+	 */
+	size_t size() const {return _size;}
+
+	/**
+	 * Number of bytes left to read.
+	 */
+	size_t remaining() const {return _size - _offset;}
+
+	/**
+	 * Read the next bytes of the content.
+	 *
+	 * @param buffer Buffer to fill.
+	 * @param length Size of the buffer.
+	 * @return The number of bytes read, less than length only at the end
+	 * of the content; 0 once all of it is read.
+	 * @throws Exception if the object is corrupted.
+	 */
+	size_t read(void* buffer, size_t length);
+
+	class Source;
+
+private:
+	std::unique_ptr<Source> _source;
+	size_t _size;
+	size_t _offset;
+};
+
+/**
+ * Writer of a blob from chunks of its content, as they arrive.
+ *
+ * When the size of the blob is known upfront, the chunks go straight to
+ * a write stream of the object database, which hashes and deflates them
+ * as they come: the loose backend of libgit2 writes them to a temporary
+ * object file. Otherwise the chunks are first spooled to an anonymous
+ * temporary file, since the header of the object, hashed first, holds
+ * its size; they are streamed to the database when the blob is
+ * finalized. In both cases memory use does not depend on the size of the
+ * blob, as long as the database has a backend supporting write streams.
+ *
+ * A blob which is not finalized is not created. A BlobWriter is not
+ * thread safe.
+ */
+class BlobWriter
+{
+public:
+	/**
+	 * Start writing a blob of a known size.
+	 *
+	 * @param repo Repository to create the blob in.
+	 * @param size Size of the content of the blob in bytes.
+	 * @throws Exception
+	 */
+	BlobWriter(const Repository& repo, size_t size);
+
+	/**
+	 * Start writing a blob of unknown size.
+	 *
+	 * @param repo Repository to create the blob in.
+	 * @throws Exception
+	 */
+	explicit BlobWriter(const Repository& repo);
+
+	~BlobWriter();
+
+	BlobWriter(const BlobWriter&) = delete;
+	BlobWriter& operator=(const BlobWriter&) = delete;
+
+	/**
+	 * Number of bytes written so far.
+	 */
+	size_t written() const {return _written;}
+
+	/**
+	 * Write the next chunk of the content.
+	 *
+	 * @throws Exception if the chunk goes past the size of the blob, or if
+	 * the blob is already finalized.
+	 */
+	void write(const void* data, size_t length);
+
+	/**
+	 * Create the blob once all its content is written.
+	 *
+	 * @return The id of the blob.
+	 * @throws Exception if less than the size of the blob was written.
+	 */
+	OId finalize();
+
+private:
+	void open(size_t size);
+
+	helper::Git2PtrWrapper<git_odb, git_odb_free> _odb;
+	git_odb_stream* _stream;
+	FILE* _spool;
+	size_t _size;
+	size_t _written;
+	bool _finalized;
+};
+
+} // namespace git2
+#endif // _GIT2PP_BLOBSTREAM_HPP_
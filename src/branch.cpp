@@ -38,7 +38,7 @@ _Class(ref)
 }
 
 Branch::Branch(const Branch& other):
-_Class(other.data())
+_Class(other)
 {
 }
 
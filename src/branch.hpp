@@ -54,6 +54,14 @@ public:
      */
     Branch(const Branch& other);
 
+    /**
+     * Move constructor; takes over the underlaying data structure.
+     */
+    Branch(Branch&& other) = default;
+
+    Branch& operator=(const Branch& other) = default;
+    Branch& operator=(Branch&& other) = default;
+
 	/**
 	 * Delete an existing branch reference.
 	 */
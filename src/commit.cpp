@@ -52,7 +52,12 @@ OId Commit::oid() const
 
 std::string Commit::message() const
 {
-    return std::string(git_commit_message(data()));
+    return messageView().str();
+}
+
+StringView Commit::messageView() const
+{
+    return StringView(git_commit_message(data()));
 }
 
 std::string Commit::shortMessage(size_t maxLen) const
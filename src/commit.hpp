@@ -24,6 +24,7 @@
 
 #include "common.hpp"
 #include "object.hpp"
+#include "stringview.hpp"
 
 namespace git2
 {
@@ -61,6 +62,14 @@ public:
      */
     Commit(const Commit& other);
 
+    /**
+     * Move constructor; takes over the underlaying data structure.
+     */
+    Commit(Commit&& other) = default;
+
+    Commit& operator=(const Commit& other) = default;
+    Commit& operator=(Commit&& other) = default;
+
     /**
     * Get the id of a commit.
     */
@@ -71,6 +80,13 @@ public:
      */
     std::string message() const;
 
+    /**
+     * Get the full message of a commit without copying it.
+     *
+     * The view is valid as long as the commit object is alive.
+     */
+    StringView messageView() const;
+
     /**
      * Get the short commit message.
      *
@@ -0,0 +1,1137 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#include "commitgraph.hpp"
+
+#include "commit.hpp"
+#include "exception.hpp"
+#include "packindex.hpp"
+#include "oidmap.hpp"
+#include "revwalk.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace git2
+{
+
+namespace
+{
+
+const uint32_t graph_signature   = 0x43475048; // "CGPH"
+const uint32_t chunk_oid_fanout  = 0x4f494446; // "OIDF"
+const uint32_t chunk_oid_lookup  = 0x4f49444c; // "OIDL"
+const uint32_t chunk_commit_data = 0x43444154; // "CDAT"
+const uint32_t chunk_extra_edges = 0x45444745; // "EDGE"
+
+const size_t   commit_data_size  = GIT_OID_RAWSZ + 16;
+const uint32_t parent_none       = 0x70000000;
+const uint32_t parent_octopus    = 0x80000000;
+const uint32_t edge_last         = 0x80000000;
+const uint32_t generation_max    = 0x3fffffff;
+const uint32_t no_position       = 0xffffffff;
+
+using helper::read_be32;
+using helper::read_be64;
+using helper::write_be32;
+using helper::write_be64;
+
+void throw_graph_error(const std::string& msg, int err = GIT_ERROR)
+{
+	giterr_set_str(GITERR_ODB, msg.c_str());
+	throw Exception(err);
+}
+
+/**
+ * Commit-graph file, as last mapped.
+ */
+struct GraphFile
+{
+	time_t mtime;
+	off_t size;
+	ino_t inode;
+	std::shared_ptr<const CommitGraph::Storage> storage;
+};
+
+std::mutex graph_files_mutex;
+std::map<std::string, GraphFile> graph_files;
+
+} // namespace
+
+
+const uint32_t CommitGraph::GENERATION_INFINITY;
+
+/**
+ * Commit-graph data, mapped from a file or built in memory, in the file
+ * format in both cases.
+ */
+struct CommitGraph::Storage
+{
+	Storage():
+	map(nullptr), mapSize(0), count(0),
+	fanout(nullptr), oids(nullptr), commits(nullptr), edges(nullptr), edgeCount(0)
+	{
+	}
+
+	~Storage()
+	{
+		if(map!=nullptr)
+			::munmap(map, mapSize);
+	}
+
+	Storage(const Storage&) = delete;
+	Storage& operator=(const Storage&) = delete;
+
+	/**
+	 * Locate the chunks of a commit-graph.
+	 * @throws Exception if the data is not a valid commit-graph.
+	 */
+	void parse(const unsigned char* data, size_t size, const std::string& path)
+	{
+		std::string error = "invalid commit-graph '" + path + "': ";
+		if(size<8+12+GIT_OID_RAWSZ || read_be32(data)!=graph_signature)
+			throw_graph_error(error + "bad signature");
+		if(data[4]!=1 || data[5]!=1)
+			throw_graph_error(error + "unsupported version");
+		if(data[7]!=0)
+			throw_graph_error(error + "split commit-graphs are not supported");
+
+		size_t chunks = data[6];
+		if(8+(chunks+1)*12 > size)
+			throw_graph_error(error + "truncated chunk table");
+
+		size_t commitsSize = 0;
+		const unsigned char* entry = data+8;
+		for(size_t n=0; n<chunks; ++n, entry+=12)
+		{
+			uint32_t id = read_be32(entry);
+			uint64_t begin = read_be64(entry+4), end = read_be64(entry+16);
+			if(begin>end || end>size-GIT_OID_RAWSZ)
+				throw_graph_error(error + "bad chunk offset");
+			const unsigned char* chunk = data+begin;
+			size_t length = end-begin;
+			switch(id)
+			{
+			case chunk_oid_fanout:
+				if(length!=256*4)
+					throw_graph_error(error + "bad fanout size");
+				fanout = chunk;
+				break;
+			case chunk_oid_lookup:
+				oids = chunk;
+				count = length/GIT_OID_RAWSZ;
+				break;
+			case chunk_commit_data:
+				commits = chunk;
+				commitsSize = length;
+				break;
+			case chunk_extra_edges:
+				edges = chunk;
+				edgeCount = length/4;
+				break;
+			}
+		}
+
+		if(fanout==nullptr || oids==nullptr || commits==nullptr)
+			throw_graph_error(error + "missing chunk");
+		if(read_be32(fanout+255*4)!=count || commitsSize<(size_t)count*commit_data_size)
+			throw_graph_error(error + "inconsistent commit count");
+	}
+
+	/**
+	 * Compute the generations of the commits of a graph written without
+	 * them: Git before 2.19 writes 0 for every commit.
+	 */
+	void computeGenerations()
+	{
+		generations.assign(count, 0);
+		std::vector<uint32_t> stack, parentPositions;
+		for(uint32_t n=0; n<count; ++n)
+		{
+			stack.push_back(n);
+			while(!stack.empty())
+			{
+				uint32_t pos = stack.back();
+				if(generations[pos]!=0)
+				{
+					stack.pop_back();
+					continue;
+				}
+				uint32_t generation = 0;
+				bool ready = true;
+				parentPositions.clear();
+				parents(pos, parentPositions);
+				for(uint32_t parent : parentPositions)
+				{
+					if(generations[parent]==0)
+					{
+						stack.push_back(parent);
+						ready = false;
+					}
+					else
+						generation = std::max(generation, generations[parent]);
+				}
+				if(ready)
+				{
+					generations[pos] = std::min(generation+1, generation_max);
+					stack.pop_back();
+				}
+			}
+		}
+	}
+
+	uint32_t find(const git_oid& oid) const
+	{
+		uint32_t first = oid.id[0]==0 ? 0 : read_be32(fanout+(oid.id[0]-1)*4);
+		uint32_t last  = read_be32(fanout+oid.id[0]*4);
+		while(first<last)
+		{
+			uint32_t middle = first + (last-first)/2;
+			int cmp = std::memcmp(oids+middle*GIT_OID_RAWSZ, oid.id, GIT_OID_RAWSZ);
+			if(cmp==0)
+				return middle;
+			if(cmp<0)
+				first = middle+1;
+			else
+				last = middle;
+		}
+		return no_position;
+	}
+
+	const unsigned char* oid(uint32_t pos) const {return oids+pos*GIT_OID_RAWSZ;}
+	const unsigned char* tree(uint32_t pos) const {return commits+pos*commit_data_size;}
+	uint32_t generation(uint32_t pos) const
+	{
+		return generations.empty() ? read_be32(commits+pos*commit_data_size+GIT_OID_RAWSZ+8) >> 2 : generations[pos];
+	}
+
+	int64_t time(uint32_t pos) const {return read_be64(commits+pos*commit_data_size+GIT_OID_RAWSZ+8) & 0x3ffffffffULL;}
+
+	void parents(uint32_t pos, std::vector<uint32_t>& out) const
+	{
+		const unsigned char* data = commits+pos*commit_data_size+GIT_OID_RAWSZ;
+		uint32_t first = read_be32(data), second = read_be32(data+4);
+		if(first!=parent_none && first<count)
+			out.push_back(first);
+		if(second==parent_none)
+			return;
+		if(!(second & parent_octopus))
+		{
+			if(second<count)
+				out.push_back(second);
+			return;
+		}
+		for(size_t edge = second & ~parent_octopus; edge<edgeCount; ++edge)
+		{
+			uint32_t parent = read_be32(edges+edge*4);
+			if((parent & ~edge_last)<count)
+				out.push_back(parent & ~edge_last);
+			if(parent & edge_last)
+				break;
+		}
+	}
+
+	void* map;
+	size_t mapSize;
+	std::vector<unsigned char> buffer;
+	std::vector<uint32_t> generations; //!< Computed generations, if the data has none.
+
+	uint32_t count;
+	const unsigned char* fanout;
+	const unsigned char* oids;
+	const unsigned char* commits;
+	const unsigned char* edges;
+	size_t edgeCount;
+};
+
+
+namespace
+{
+
+/**
+ * Walk state over the commits of a graph and the commits missing from it.
+ *
+ * Nodes below the graph size are graph positions, the others are commits
+ * read from the repository. Walks pop nodes by decreasing generation, then
+ * commit time, so all the children of a node are processed before it.
+ */
+class GraphWalker
+{
+public:
+	enum Flags
+	{
+		FLAG_ONE    = 1,
+		FLAG_TWO    = 2,
+		FLAG_QUEUED = 4
+	};
+
+	GraphWalker(const CommitGraph::Storage* graph, git_repository* repo):
+	_graph(graph),
+	_repo(repo),
+	_count(graph!=nullptr ? graph->count : 0)
+	{
+	}
+
+	/**
+	 * Get the node of a commit.
+	 *
+	 * A commit missing from the graph is read from the repository, along
+	 * with its ancestors missing from the graph, to compute its generation.
+	 */
+	uint32_t node(const git_oid& oid)
+	{
+		uint32_t start = find(oid);
+		if(start!=no_position)
+			return start;
+
+		start = load(oid);
+		std::vector<uint32_t> stack(1, start);
+		std::vector<uint32_t> parents;
+		while(!stack.empty())
+		{
+			uint32_t current = stack.back();
+			if(_extra[current-_count].generation!=0)
+			{
+				stack.pop_back();
+				continue;
+			}
+
+			uint32_t generation = 0;
+			bool ready = true;
+			parents.clear();
+			for(size_t n=0; n<_extra[current-_count].parentIds.size(); ++n)
+			{
+				// load() may grow _extra, copy the id.
+				git_oid id = _extra[current-_count].parentIds[n];
+				uint32_t parent = find(id);
+				if(parent==no_position)
+					parent = load(id);
+				parents.push_back(parent);
+
+				if(parent>=_count && _extra[parent-_count].generation==0)
+				{
+					stack.push_back(parent);
+					ready = false;
+				}
+				else
+					generation = std::max(generation, this->generation(parent));
+			}
+
+			if(ready)
+			{
+				_extra[current-_count].parents = parents;
+				_extra[current-_count].generation = generation+1;
+				stack.pop_back();
+			}
+		}
+		return start;
+	}
+
+	void parents(uint32_t node, std::vector<uint32_t>& out) const
+	{
+		out.clear();
+		if(node<_count)
+			_graph->parents(node, out);
+		else
+			out = _extra[node-_count].parents;
+	}
+
+	uint32_t generation(uint32_t node) const
+	{
+		return node<_count ? _graph->generation(node) : _extra[node-_count].generation;
+	}
+
+	OId oid(uint32_t node) const
+	{
+		if(node<_count)
+			return OId(reinterpret_cast<const git_oid*>(_graph->oid(node)));
+		return OId(&_extra[node-_count].oid);
+	}
+
+	unsigned char flags(uint32_t node) const
+	{
+		std::unordered_map<uint32_t, unsigned char>::const_iterator it = _flags.find(node);
+		return it!=_flags.end() ? it->second : 0;
+	}
+
+	void setFlags(uint32_t node, unsigned char flags)
+	{
+		_flags[node] = flags;
+	}
+
+	const std::unordered_map<uint32_t, unsigned char>& allFlags() const {return _flags;}
+
+	/**
+	 * Drop the flags and the queue, to walk again over the same nodes.
+	 */
+	void clear()
+	{
+		_flags.clear();
+		_queue = std::priority_queue<Entry>();
+	}
+
+	/**
+	 * Queue a node, unless it is already queued.
+	 * @return True if the node has been queued.
+	 */
+	bool push(uint32_t node)
+	{
+		unsigned char& flags = _flags[node];
+		if(flags & FLAG_QUEUED)
+			return false;
+		flags |= FLAG_QUEUED;
+		Entry entry = {generation(node), time(node), node};
+		_queue.push(entry);
+		return true;
+	}
+
+	bool empty() const {return _queue.empty();}
+
+	uint32_t pop()
+	{
+		uint32_t node = _queue.top().node;
+		_queue.pop();
+		_flags[node] &= ~FLAG_QUEUED;
+		return node;
+	}
+
+private:
+	struct Extra
+	{
+		git_oid oid;
+		int64_t time;
+		uint32_t generation; //!< 0 until computed.
+		std::vector<git_oid> parentIds;
+		std::vector<uint32_t> parents;
+	};
+
+	uint32_t find(const git_oid& oid) const
+	{
+		if(_count>0)
+		{
+			uint32_t pos = _graph->find(oid);
+			if(pos!=no_position)
+				return pos;
+		}
+		const uint32_t* known = _extraIndex.find(OId(&oid));
+		return known!=nullptr ? *known : no_position;
+	}
+
+	uint32_t load(const git_oid& oid)
+	{
+		git_commit* commit;
+		Exception::git2_assert(git_commit_lookup(&commit, _repo, &oid));
+		Commit owner(commit);
+
+		Extra extra;
+		extra.oid = oid;
+		extra.time = git_commit_time(commit);
+		extra.generation = 0;
+		for(unsigned int n=0; n<git_commit_parentcount(commit); ++n)
+			extra.parentIds.push_back(*git_commit_parent_id(commit, n));
+
+		uint32_t node = _count + _extra.size();
+		_extra.push_back(extra);
+		_extraIndex.insert(OId(&oid), node);
+		return node;
+	}
+
+	struct Entry
+	{
+		uint32_t generation;
+		int64_t time;
+		uint32_t node;
+
+		bool operator<(const Entry& other) const
+		{
+			if(generation!=other.generation)
+				return generation<other.generation;
+			return time<other.time;
+		}
+	};
+
+	int64_t time(uint32_t node) const
+	{
+		return node<_count ? _graph->time(node) : _extra[node-_count].time;
+	}
+
+	const CommitGraph::Storage* _graph;
+	git_repository* _repo;
+	uint32_t _count;
+
+	std::vector<Extra> _extra;
+	OIdMap<uint32_t> _extraIndex;
+	std::unordered_map<uint32_t, unsigned char> _flags;
+	std::priority_queue<Entry> _queue;
+};
+
+/**
+ * Propagate flags to the parents of a node, queueing the parents which
+ * got new flags.
+ */
+template<class Changed>
+void propagate(GraphWalker& walker, uint32_t node, unsigned char flags, std::vector<uint32_t>& parents, Changed changed)
+{
+	walker.parents(node, parents);
+	for(uint32_t parent : parents)
+	{
+		unsigned char old = walker.flags(parent);
+		if((old | flags)==old)
+			continue;
+		walker.setFlags(parent, old | flags);
+		changed(parent, old, old | flags);
+		if(!(old & GraphWalker::FLAG_QUEUED))
+			walker.push(parent);
+	}
+}
+
+/**
+ * Ancestors of a commit, walked by decreasing generation as far as asked
+ * only, so that several walks can share it.
+ *
+ * Every ancestor of a generation higher than the ones queued has been
+ * reached, and an ancestor is only reached through a child of higher
+ * generation: once extended to a generation, the ancestors above it are
+ * all expanded and the ones at or below it all descend from the queue.
+ */
+class AncestorWalk
+{
+public:
+	AncestorWalk(GraphWalker& walker, uint32_t tip):
+	_walker(walker),
+	_expanded(0)
+	{
+		reach(tip);
+	}
+
+	/**
+	 * Whether a node is the tip or one of its ancestors.
+	 */
+	bool reaches(uint32_t node)
+	{
+		extend(_walker.generation(node));
+		return _reached.count(node)!=0;
+	}
+
+	/**
+	 * Expand the reached nodes of a generation higher than the given one.
+	 */
+	void extend(uint32_t generation)
+	{
+		while(!_queue.empty() && _queue.front().first>generation)
+		{
+			uint32_t node = _queue.front().second;
+			std::pop_heap(_queue.begin(), _queue.end());
+			_queue.pop_back();
+			++_expanded;
+			_walker.parents(node, _parents);
+			for(uint32_t parent : _parents)
+				reach(parent);
+		}
+	}
+
+	/**
+	 * Number of nodes expanded so far.
+	 */
+	size_t expanded() const {return _expanded;}
+
+	/**
+	 * Nodes reached but not expanded yet.
+	 */
+	void frontier(std::vector<uint32_t>& out) const
+	{
+		out.clear();
+		for(const std::pair<uint32_t, uint32_t>& entry : _queue)
+			out.push_back(entry.second);
+	}
+
+private:
+	void reach(uint32_t node)
+	{
+		if(!_reached.insert(node).second)
+			return;
+		_queue.push_back(std::make_pair(_walker.generation(node), node));
+		std::push_heap(_queue.begin(), _queue.end());
+	}
+
+	GraphWalker& _walker;
+	size_t _expanded;
+	std::unordered_set<uint32_t> _reached;
+	std::vector<std::pair<uint32_t, uint32_t> > _queue; //!< Heap of (generation, node).
+	std::vector<uint32_t> _parents;
+};
+
+} // namespace
+
+
+CommitGraph::CommitGraph()
+{
+}
+
+CommitGraph::CommitGraph(const Repository& repo):
+_repo(repo)
+{
+	std::string path = repo.path() + "objects/info/commit-graph";
+	struct stat st;
+	*this = ::stat(path.c_str(), &st)==0 ? open(repo, path) : build(repo);
+}
+
+CommitGraph::CommitGraph(const Repository& repo, std::shared_ptr<const Storage> storage):
+_repo(repo),
+_storage(storage)
+{
+}
+
+CommitGraph CommitGraph::open(const Repository& repo, const std::string& path)
+{
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if(fd<0)
+	{
+		std::lock_guard<std::mutex> lock(graph_files_mutex);
+		graph_files.erase(path);
+		throw_graph_error("cannot open commit-graph '" + path + "'", GIT_ENOTFOUND);
+	}
+
+	struct stat st;
+	if(::fstat(fd, &st)!=0)
+	{
+		::close(fd);
+		throw_graph_error("cannot stat commit-graph '" + path + "'");
+	}
+
+	// Git replaces the file rather than writing it in place, so a file of
+	// the same inode, size and time is the one already mapped.
+	{
+		std::lock_guard<std::mutex> lock(graph_files_mutex);
+		std::map<std::string, GraphFile>::const_iterator known = graph_files.find(path);
+		if(known!=graph_files.end() && known->second.inode==st.st_ino
+				&& known->second.size==st.st_size && known->second.mtime==st.st_mtime)
+		{
+			::close(fd);
+			return CommitGraph(repo, known->second.storage);
+		}
+	}
+
+	void* map = st.st_size>0 ? ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	::close(fd);
+	if(map==MAP_FAILED)
+		throw_graph_error("cannot map commit-graph '" + path + "'");
+
+	std::shared_ptr<Storage> storage = std::make_shared<Storage>();
+	storage->map = map;
+	storage->mapSize = st.st_size;
+	storage->parse(static_cast<const unsigned char*>(map), st.st_size, path);
+	if(storage->count>0 && storage->generation(0)==0)
+		storage->computeGenerations();
+
+	std::lock_guard<std::mutex> lock(graph_files_mutex);
+	GraphFile& file = graph_files[path];
+	file.mtime = st.st_mtime;
+	file.size = st.st_size;
+	file.inode = st.st_ino;
+	file.storage = storage;
+	return CommitGraph(repo, storage);
+}
+
+CommitGraph CommitGraph::forRepository(const Repository& repo) const
+{
+	return CommitGraph(repo, _storage);
+}
+
+CommitGraph CommitGraph::build(const Repository& repo)
+{
+	struct Entry
+	{
+		git_oid oid;
+		git_oid tree;
+		int64_t time;
+		std::vector<git_oid> parents;
+		uint32_t generation;
+	};
+
+	// Collect the commits reachable from the references.
+	git_revwalk* walk;
+	Exception::git2_assert(git_revwalk_new(&walk, repo.data()));
+	RevWalk revwalk(walk);
+	Exception::git2_assert(git_revwalk_push_glob(walk, "*"));
+	int err = git_revwalk_push_head(walk);
+	if(err!=GIT_ENOTFOUND && err!=GIT_EUNBORNBRANCH)
+		Exception::git2_assert(err);
+
+	std::vector<Entry> entries;
+	OId oid;
+	while(revwalk.next(oid))
+	{
+		git_commit* commit;
+		Exception::git2_assert(git_commit_lookup(&commit, repo.data(), oid.constData()));
+		Commit owner(commit);
+
+		Entry entry;
+		entry.oid = *oid.constData();
+		entry.tree = *git_commit_tree_id(commit);
+		entry.time = std::max<int64_t>(git_commit_time(commit), 0);
+		for(unsigned int n=0; n<git_commit_parentcount(commit); ++n)
+			entry.parents.push_back(*git_commit_parent_id(commit, n));
+		entry.generation = 0;
+		entries.push_back(entry);
+	}
+
+	std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b){
+		return std::memcmp(a.oid.id, b.oid.id, GIT_OID_RAWSZ) < 0;
+	});
+
+	// Translate the parents to positions, ignoring the ones cut by a
+	// shallow clone.
+	uint32_t count = entries.size();
+	std::vector<std::vector<uint32_t> > parents(count);
+	for(uint32_t n=0; n<count; ++n)
+	{
+		for(const git_oid& parent : entries[n].parents)
+		{
+			std::vector<Entry>::const_iterator it = std::lower_bound(entries.begin(), entries.end(), parent,
+				[](const Entry& a, const git_oid& b){return std::memcmp(a.oid.id, b.id, GIT_OID_RAWSZ) < 0;});
+			if(it!=entries.end() && std::memcmp(it->oid.id, parent.id, GIT_OID_RAWSZ)==0)
+				parents[n].push_back(it-entries.begin());
+		}
+	}
+
+	// Generations, computed parents first without recursion.
+	std::vector<uint32_t> stack;
+	for(uint32_t n=0; n<count; ++n)
+	{
+		stack.push_back(n);
+		while(!stack.empty())
+		{
+			uint32_t pos = stack.back();
+			if(entries[pos].generation!=0)
+			{
+				stack.pop_back();
+				continue;
+			}
+			uint32_t generation = 0;
+			bool ready = true;
+			for(uint32_t parent : parents[pos])
+			{
+				if(entries[parent].generation==0)
+				{
+					stack.push_back(parent);
+					ready = false;
+				}
+				else
+					generation = std::max(generation, entries[parent].generation);
+			}
+			if(ready)
+			{
+				entries[pos].generation = std::min(generation+1, generation_max);
+				stack.pop_back();
+			}
+		}
+	}
+
+	// Serialize in the commit-graph file format.
+	std::vector<uint32_t> edges;
+	for(uint32_t n=0; n<count; ++n)
+	{
+		if(parents[n].size()>2)
+		{
+			for(size_t p=1; p<parents[n].size(); ++p)
+				edges.push_back(parents[n][p] | (p+1==parents[n].size() ? edge_last : 0));
+		}
+	}
+
+	uint32_t chunks = edges.empty() ? 3 : 4;
+	uint64_t offset = 8 + (chunks+1)*12;
+	std::shared_ptr<Storage> storage = std::make_shared<Storage>();
+	std::vector<unsigned char>& buffer = storage->buffer;
+	buffer.reserve(offset + 256*4 + count*(GIT_OID_RAWSZ+commit_data_size) + edges.size()*4 + GIT_OID_RAWSZ);
+
+	write_be32(buffer, graph_signature);
+	buffer.push_back(1);
+	buffer.push_back(1);
+	buffer.push_back(chunks);
+	buffer.push_back(0);
+
+	const uint32_t ids[] = {chunk_oid_fanout, chunk_oid_lookup, chunk_commit_data, chunk_extra_edges};
+	const uint64_t sizes[] = {256*4, (uint64_t)count*GIT_OID_RAWSZ, (uint64_t)count*commit_data_size, (uint64_t)edges.size()*4};
+	for(uint32_t n=0; n<chunks; ++n)
+	{
+		write_be32(buffer, ids[n]);
+		write_be64(buffer, offset);
+		offset += sizes[n];
+	}
+	write_be32(buffer, 0);
+	write_be64(buffer, offset);
+
+	uint32_t fanout = 0;
+	for(int n=0; n<256; ++n)
+	{
+		while(fanout<count && entries[fanout].oid.id[0]==n)
+			++fanout;
+		write_be32(buffer, fanout);
+	}
+
+	for(const Entry& entry : entries)
+		buffer.insert(buffer.end(), entry.oid.id, entry.oid.id+GIT_OID_RAWSZ);
+
+	uint32_t edge = 0;
+	for(uint32_t n=0; n<count; ++n)
+	{
+		const Entry& entry = entries[n];
+		buffer.insert(buffer.end(), entry.tree.id, entry.tree.id+GIT_OID_RAWSZ);
+		write_be32(buffer, parents[n].empty() ? parent_none : parents[n][0]);
+		if(parents[n].size()>2)
+		{
+			write_be32(buffer, parent_octopus | edge);
+			edge += parents[n].size()-1;
+		}
+		else
+			write_be32(buffer, parents[n].size()==2 ? parents[n][1] : parent_none);
+		write_be64(buffer, ((uint64_t)entry.generation << 34) | ((uint64_t)entry.time & 0x3ffffffffULL));
+	}
+
+	for(uint32_t value : edges)
+		write_be32(buffer, value);
+
+	// No checksum, the data never leaves the memory.
+	buffer.resize(buffer.size()+GIT_OID_RAWSZ, 0);
+
+	storage->parse(buffer.data(), buffer.size(), "<memory>");
+	return CommitGraph(repo, storage);
+}
+
+size_t CommitGraph::size() const
+{
+	return _storage ? _storage->count : 0;
+}
+
+bool CommitGraph::contains(const OId& oid) const
+{
+	return _storage && _storage->count>0 && _storage->find(*oid.constData())!=no_position;
+}
+
+uint32_t CommitGraph::generation(const OId& oid) const
+{
+	uint32_t pos = _storage && _storage->count>0 ? _storage->find(*oid.constData()) : no_position;
+	return pos!=no_position ? _storage->generation(pos) : GENERATION_INFINITY;
+}
+
+std::vector<OId> CommitGraph::parents(const OId& oid) const
+{
+	GraphWalker walker(_storage.get(), _repo.data());
+	std::vector<uint32_t> nodes;
+	walker.parents(walker.node(*oid.constData()), nodes);
+
+	std::vector<OId> result;
+	for(uint32_t node : nodes)
+		result.push_back(walker.oid(node));
+	return result;
+}
+
+OId CommitGraph::tree(const OId& oid) const
+{
+	uint32_t pos = _storage && _storage->count>0 ? _storage->find(*oid.constData()) : no_position;
+	if(pos!=no_position)
+		return OId(reinterpret_cast<const git_oid*>(_storage->tree(pos)));
+
+	git_commit* commit;
+	Exception::git2_assert(git_commit_lookup(&commit, _repo.data(), oid.constData()));
+	Commit owner(commit);
+	return OId(git_commit_tree_id(commit));
+}
+
+int64_t CommitGraph::commitTime(const OId& oid) const
+{
+	uint32_t pos = _storage && _storage->count>0 ? _storage->find(*oid.constData()) : no_position;
+	if(pos!=no_position)
+		return _storage->time(pos);
+
+	git_commit* commit;
+	Exception::git2_assert(git_commit_lookup(&commit, _repo.data(), oid.constData()));
+	Commit owner(commit);
+	return git_commit_time(commit);
+}
+
+std::pair<size_t, size_t> CommitGraph::aheadBehind(const OId& local, const OId& upstream) const
+{
+	const unsigned char both = GraphWalker::FLAG_ONE | GraphWalker::FLAG_TWO;
+	GraphWalker walker(_storage.get(), _repo.data());
+	uint32_t one = walker.node(*local.constData());
+	uint32_t two = walker.node(*upstream.constData());
+	if(one==two)
+		return std::make_pair(0, 0);
+
+	// Paint down from both commits until only commits reachable from both
+	// remain queued.
+	walker.setFlags(one, GraphWalker::FLAG_ONE);
+	walker.setFlags(two, GraphWalker::FLAG_TWO);
+	walker.push(one);
+	walker.push(two);
+	size_t unique = 2;
+
+	std::vector<uint32_t> parents;
+	while(unique>0 && !walker.empty())
+	{
+		uint32_t node = walker.pop();
+		unsigned char flags = walker.flags(node) & both;
+		if(flags!=both)
+			--unique;
+		propagate(walker, node, flags, parents, [&](uint32_t, unsigned char old, unsigned char now){
+			bool wasQueued = (old & GraphWalker::FLAG_QUEUED)!=0;
+			if(wasQueued && (old & both)!=both && (now & both)==both)
+				--unique;
+			else if(!wasQueued && (now & both)!=both)
+				++unique;
+		});
+	}
+
+	std::pair<size_t, size_t> res(0, 0);
+	for(const std::pair<const uint32_t, unsigned char>& node : walker.allFlags())
+	{
+		if((node.second & both)==GraphWalker::FLAG_ONE)
+			++res.first;
+		else if((node.second & both)==GraphWalker::FLAG_TWO)
+			++res.second;
+	}
+	return res;
+}
+
+std::vector<std::pair<size_t, size_t>> CommitGraph::aheadBehind(const std::vector<OId>& locals, const OId& upstream) const
+{
+	std::vector<std::pair<size_t, size_t>> res(locals.size());
+	GraphWalker walker(_storage.get(), _repo.data());
+	const uint32_t two = walker.node(*upstream.constData());
+
+	// Ahead: walk down from each local until the ancestors of the upstream,
+	// and keep the ones reached. The ancestors of the upstream are found
+	// once for all the locals.
+	AncestorWalk members(walker, two);
+	std::vector<std::vector<uint32_t>> bounds(locals.size());
+	std::vector<uint32_t> tops(locals.size(), 0);
+	std::vector<uint32_t> parents;
+	for(size_t n=0; n<locals.size(); ++n)
+	{
+		walker.clear();
+		uint32_t one = walker.node(*locals[n].constData());
+		walker.setFlags(one, GraphWalker::FLAG_ONE);
+		walker.push(one);
+		while(!walker.empty())
+		{
+			uint32_t node = walker.pop();
+			if(members.reaches(node))
+			{
+				bounds[n].push_back(node);
+				tops[n] = std::max(tops[n], walker.generation(node));
+				continue;
+			}
+			++res[n].first;
+			walker.parents(node, parents);
+			for(uint32_t parent : parents)
+			{
+				if(walker.flags(parent)==0)
+				{
+					walker.setFlags(parent, GraphWalker::FLAG_ONE);
+					walker.push(parent);
+				}
+			}
+		}
+	}
+
+	// Behind: the ancestors of the upstream above the highest common one
+	// are all behind, the ones below are the ancestors of the frontier of
+	// the upstream walk there which are not common. The locals are taken
+	// by decreasing height so that the upstream walk only goes down.
+	std::vector<size_t> order(locals.size());
+	for(size_t n=0; n<order.size(); ++n)
+		order[n] = n;
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b){ return tops[a]>tops[b]; });
+
+	const unsigned char both = GraphWalker::FLAG_ONE | GraphWalker::FLAG_TWO;
+	AncestorWalk levels(walker, two);
+	std::vector<uint32_t> frontier;
+	for(size_t n : order)
+	{
+		levels.extend(tops[n]);
+		res[n].second = levels.expanded();
+
+		walker.clear();
+		for(uint32_t node : bounds[n])
+		{
+			walker.setFlags(node, GraphWalker::FLAG_ONE);
+			walker.push(node);
+		}
+		size_t unique = 0;
+		levels.frontier(frontier);
+		for(uint32_t node : frontier)
+		{
+			unsigned char flags = walker.flags(node);
+			walker.setFlags(node, flags | GraphWalker::FLAG_TWO);
+			if(!(flags & GraphWalker::FLAG_ONE))
+			{
+				walker.push(node);
+				++unique;
+			}
+		}
+
+		// Paint down until no queued commit is reached from the frontier
+		// only.
+		while(unique>0 && !walker.empty())
+		{
+			uint32_t node = walker.pop();
+			unsigned char flags = walker.flags(node) & both;
+			if(flags==GraphWalker::FLAG_TWO)
+			{
+				--unique;
+				++res[n].second;
+			}
+			propagate(walker, node, flags, parents, [&](uint32_t, unsigned char old, unsigned char now){
+				bool wasQueued = (old & GraphWalker::FLAG_QUEUED)!=0;
+				if(wasQueued && (old & both)==GraphWalker::FLAG_TWO && (now & both)==both)
+					--unique;
+				else if(!wasQueued && (now & both)==GraphWalker::FLAG_TWO)
+					++unique;
+			});
+		}
+	}
+	return res;
+}
+
+bool CommitGraph::isDescendantOf(const OId& commit, const OId& ancestor) const
+{
+	GraphWalker walker(_storage.get(), _repo.data());
+	uint32_t start = walker.node(*commit.constData());
+	uint32_t target = walker.node(*ancestor.constData());
+	if(start==target)
+		return false;
+
+	uint32_t minGeneration = walker.generation(target);
+	walker.setFlags(start, GraphWalker::FLAG_ONE);
+	walker.push(start);
+
+	std::vector<uint32_t> parents;
+	while(!walker.empty())
+	{
+		uint32_t node = walker.pop();
+		walker.parents(node, parents);
+		for(uint32_t parent : parents)
+		{
+			if(parent==target)
+				return true;
+			if(walker.flags(parent)!=0 || walker.generation(parent)<minGeneration)
+				continue;
+			walker.setFlags(parent, GraphWalker::FLAG_ONE);
+			walker.push(parent);
+		}
+	}
+	return false;
+}
+
+OId CommitGraph::mergeBase(const OId& one, const OId& two) const
+{
+	const unsigned char both = GraphWalker::FLAG_ONE | GraphWalker::FLAG_TWO;
+	GraphWalker walker(_storage.get(), _repo.data());
+	uint32_t first = walker.node(*one.constData());
+	uint32_t second = walker.node(*two.constData());
+	if(first==second)
+		return walker.oid(first);
+
+	walker.setFlags(first, GraphWalker::FLAG_ONE);
+	walker.setFlags(second, GraphWalker::FLAG_TWO);
+	walker.push(first);
+	walker.push(second);
+
+	// The first commit popped with both flags has no common descendant
+	// left in the queue.
+	std::vector<uint32_t> parents;
+	while(!walker.empty())
+	{
+		uint32_t node = walker.pop();
+		unsigned char flags = walker.flags(node) & both;
+		if(flags==both)
+			return walker.oid(node);
+		propagate(walker, node, flags, parents, [](uint32_t, unsigned char, unsigned char){});
+	}
+
+	throw_graph_error("no merge base found", GIT_ENOTFOUND);
+	return OId();
+}
+
+std::vector<OId> CommitGraph::topologicalOrder(const std::vector<OId>& tips, const std::vector<OId>& hidden) const
+{
+	const unsigned char seen = GraphWalker::FLAG_ONE;
+	const unsigned char uninteresting = GraphWalker::FLAG_TWO;
+	GraphWalker walker(_storage.get(), _repo.data());
+	size_t interesting = 0;
+
+	for(const OId& oid : hidden)
+	{
+		uint32_t node = walker.node(*oid.constData());
+		walker.setFlags(node, walker.flags(node) | seen | uninteresting);
+		walker.push(node);
+	}
+	for(const OId& oid : tips)
+	{
+		uint32_t node = walker.node(*oid.constData());
+		if(walker.flags(node) & seen)
+			continue;
+		walker.setFlags(node, seen);
+		walker.push(node);
+		++interesting;
+	}
+
+	std::vector<OId> result;
+	std::vector<uint32_t> parents;
+	while(interesting>0 && !walker.empty())
+	{
+		uint32_t node = walker.pop();
+		unsigned char flags = walker.flags(node);
+		if(flags & uninteresting)
+		{
+			propagate(walker, node, seen | uninteresting, parents, [&](uint32_t, unsigned char old, unsigned char){
+				if((old & seen) && !(old & uninteresting) && (old & GraphWalker::FLAG_QUEUED))
+					--interesting;
+			});
+			continue;
+		}
+
+		--interesting;
+		result.push_back(walker.oid(node));
+		walker.parents(node, parents);
+		for(uint32_t parent : parents)
+		{
+			if(walker.flags(parent) & seen)
+				continue;
+			walker.setFlags(parent, seen);
+			walker.push(parent);
+			++interesting;
+		}
+	}
+	return result;
+}
+
+} // namespace git2
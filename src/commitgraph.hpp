@@ -0,0 +1,221 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#ifndef _GIT2PP_COMMITGRAPH_HPP_
+#define _GIT2PP_COMMITGRAPH_HPP_
+
+#include <git2.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "oid.hpp"
+#include "repository.hpp"
+
+namespace git2
+{
+
+/**
+ * Table of the commits of a repository with their parents, tree, commit
+ * time and generation number, to walk the history without inflating
+ * commit objects.
+ *
+ * The table is Git's commit-graph file (objects/info/commit-graph, as
+ * written by `git commit-graph write`), memory-mapped. When the file does
+ * not exist, an equivalent table is built in memory from the commits
+ * reachable from the references.
+ *
+ * The generation number of a commit is one more than the highest one of
+ * its parents, so a commit can only be reached from commits of higher
+ * generations. The walks below process commits by decreasing generation
+ * and stop as soon as the result cannot change anymore.
+ * Commit-graph files written by Git before 2.19 hold no generation
+ * numbers: they are computed from the parents when the file is opened.
+ *
+ * Commits created after the table are read from the repository, along
+ * with their ancestors down to the table, to compute their generation.
+ * Keep the table up to date: with an empty one, walks read the whole
+ * history.
+ *
+ * A CommitGraph is immutable and can be used from several threads at
+ * once, as long as the repository itself is.
+ */
+class CommitGraph
+{
+public:
+	/**
+	 * Generation of a commit which is not in the table.
+	 */
+	static const uint32_t GENERATION_INFINITY = 0xffffffff;
+
+	/**
+	 * Create an empty table, with which every commit is read from the
+	 * repository.
+	 */
+	CommitGraph();
+
+	/**
+	 * Open the commit-graph file of a repository, or build the table if
+	 * there is none.
+	 *
+	 * Building the table reads every commit, see build(): keep the table
+	 * rather than creating it again for each query.
+	 *
+	 * @throws Exception
+	 */
+	explicit CommitGraph(const Repository& repo);
+
+	/**
+	 * Open a commit-graph file.
+	 *
+	 * The file stays mapped once opened: opening it again while its inode,
+	 * size and modification time are unchanged shares the same table,
+	 * without reading it.
+	 *
+	 * @param repo Repository the commits belong to.
+	 * @param path Path of the commit-graph file.
+	 * @throws Exception if the file cannot be read or is invalid.
+	 */
+	static CommitGraph open(const Repository& repo, const std::string& path);
+
+	/**
+	 * Share this table with another handle of the repository, e.g. the
+	 * one of another thread, from which the commits missing from the
+	 * table are read.
+	 */
+	CommitGraph forRepository(const Repository& repo) const;
+
+	/**
+	 * Build the table of all the commits reachable from the references
+	 * and HEAD of a repository.
+	 *
+	 * Every commit is read once, so this is as slow as a full log. Prefer
+	 * running `git commit-graph write` for large repositories.
+	 *
+	 * @throws Exception
+	 */
+	static CommitGraph build(const Repository& repo);
+
+	/**
+	 * Number of commits in the table.
+	 */
+	size_t size() const;
+
+	/**
+	 * Check if a commit is in the table.
+	 */
+	bool contains(const OId& oid) const;
+
+	/**
+	 * Get the generation number of a commit.
+	 *
+	 * @return The generation, or GENERATION_INFINITY if the commit is not in the table.
+	 */
+	uint32_t generation(const OId& oid) const;
+
+	/**
+	 * Get the parents of a commit.
+	 *
+	 * @throws Exception if the commit does not exist.
+	 */
+	std::vector<OId> parents(const OId& oid) const;
+
+	/**
+	 * Get the tree of a commit.
+	 *
+	 * @throws Exception if the commit does not exist.
+	 */
+	OId tree(const OId& oid) const;
+
+	/**
+	 * Get the commit time of a commit, in seconds since the epoch.
+	 *
+	 * @throws Exception if the commit does not exist.
+	 */
+	int64_t commitTime(const OId& oid) const;
+
+	/**
+	 * Count the number of unique commits between two commits, like
+	 * Repository::aheadBehind().
+	 *
+	 * @param local the commit for local
+	 * @param upstream the commit for upstream
+	 * @return The number of commits only reachable from local (ahead) and
+	 * only reachable from upstream (behind).
+	 * @throws Exception
+	 */
+	std::pair<size_t, size_t> aheadBehind(const OId& local, const OId& upstream) const;
+
+	/**
+	 * Count the unique commits between several commits and the same
+	 * upstream, like aheadBehind() for each of them.
+	 *
+	 * The ancestors of the upstream are walked once for all the locals,
+	 * down to the lowest one they share with a local: only the commits
+	 * near the history shared with each local are walked again.
+	 *
+	 * @param locals the commits for local
+	 * @param upstream the commit for upstream
+	 * @return (ahead, behind) counts, in the order of the locals.
+	 * @throws Exception
+	 */
+	std::vector<std::pair<size_t, size_t>> aheadBehind(const std::vector<OId>& locals, const OId& upstream) const;
+
+	/**
+	 * Check if a commit is a descendant of another one.
+	 *
+	 * The commits whose generation is lower than the ancestor one are not
+	 * walked.
+	 *
+	 * @return True if ancestor can be reached from commit; a commit is not
+	 * its own descendant.
+	 * @throws Exception
+	 */
+	bool isDescendantOf(const OId& commit, const OId& ancestor) const;
+
+	/**
+	 * Find a merge base of two commits.
+	 *
+	 * @return The common ancestor of highest generation.
+	 * @throws Exception GIT_ENOTFOUND if the commits have no common ancestor.
+	 */
+	OId mergeBase(const OId& one, const OId& two) const;
+
+	/**
+	 * List the commits reachable from tips and not from hidden, each
+	 * commit coming before its parents, like a topological RevWalk.
+	 *
+	 * @throws Exception
+	 */
+	std::vector<OId> topologicalOrder(const std::vector<OId>& tips, const std::vector<OId>& hidden = std::vector<OId>()) const;
+
+	struct Storage;
+
+private:
+	CommitGraph(const Repository& repo, std::shared_ptr<const Storage> storage);
+
+	Repository _repo;
+	std::shared_ptr<const Storage> _storage;
+};
+
+} // namespace git2
+#endif // _GIT2PP_COMMITGRAPH_HPP_
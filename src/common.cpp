@@ -24,6 +24,10 @@
 namespace git2
 {
 
+#ifdef GIT2PP_COUNT_REF_UPDATES
+std::atomic<unsigned long> helper::ref_updates(0);
+#endif
+
 static TraceCallback trace_callback(nullptr);
 
 static void trace_cb(git_trace_level_t level, const char* msg)
@@ -23,8 +23,10 @@
 #include <git2.h>
 #include <git2/trace.h>
 
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <utility>
 
 namespace git2
 {
@@ -53,27 +55,154 @@ void setTraceCallback(git_trace_level_t level, TraceCallback cb);
 namespace helper
 {
 
+#ifdef GIT2PP_COUNT_REF_UPDATES
+/**
+ * Number of reference count updates made by the wrappers, counted only
+ * when the library is compiled with GIT2PP_COUNT_REF_UPDATES, for the
+ * benchmarks.
+ */
+extern std::atomic<unsigned long> ref_updates;
+inline void count_ref_update(){ref_updates.fetch_add(1, std::memory_order_relaxed);}
+#else
+inline void count_ref_update(){}
+#endif
+
+/**
+ * Reference count shared by the copies of a Git2PtrWrapper.
+ */
+struct Git2SharedCount
+{
+	explicit Git2SharedCount(long count):refs(count){}
+	std::atomic<long> refs;
+};
+
 /**
  * Represents a Git wrapped structure pointer.
+ *
+ * The wrapper owns the pointer alone until it is copied: creating,
+ * moving and destroying an unshared wrapper allocates nothing and does
+ * no atomic operation.
+ *
+ * Copying shares the pointer. If the structure has its own reference
+ * count, i.e. a _Dup function is given (like git_object_dup), the copy
+ * uses it. Otherwise a Git2SharedCount is allocated on the first copy and
+ * the pointer is freed with the last wrapper.
  */
-template<class _Type, void(*_Deleter)(_Type*) = nullptr>
+template<class _Type, void(*_Deleter)(_Type*) = nullptr, int(*_Dup)(_Type**, _Type*) = nullptr>
 class Git2PtrWrapper
 {
 public:
-	typedef Git2PtrWrapper<_Type,_Deleter> _Class;
-	typedef std::shared_ptr<_Type> _PtrType;
+	typedef Git2PtrWrapper<_Type,_Deleter,_Dup> _Class;
+
+	Git2PtrWrapper():_ptr(nullptr),_count(nullptr){}
+	Git2PtrWrapper(_Type* ptr):_ptr(ptr),_count(nullptr){}
+	Git2PtrWrapper(const _Class& other):_ptr(nullptr),_count(nullptr){other.shareTo(*this);}
+	Git2PtrWrapper(_Class&& other) noexcept:
+	_ptr(other._ptr),
+	_count(other._count.load(std::memory_order_relaxed))
+	{
+		other._ptr = nullptr;
+		other._count.store(nullptr, std::memory_order_relaxed);
+	}
+	~Git2PtrWrapper(){unref();}
+
+	_Class& operator=(const _Class& other)
+	{
+		if(this!=&other)
+		{
+			_Class copy(other);
+			swap(copy);
+		}
+		return *this;
+	}
+
+	_Class& operator=(_Class&& other) noexcept
+	{
+		if(this!=&other)
+		{
+			_Class moved(std::move(other));
+			swap(moved);
+		}
+		return *this;
+	}
+
+	void swap(_Class& other) noexcept
+	{
+		std::swap(_ptr, other._ptr);
+		Git2SharedCount* count = _count.load(std::memory_order_relaxed);
+		_count.store(other._count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		other._count.store(count, std::memory_order_relaxed);
+	}
 
-	Git2PtrWrapper(){}
-	Git2PtrWrapper(_Type* ptr):_ptr(ptr, _Deleter){} // Todo protect deleter from null pointer
-	Git2PtrWrapper(const _Class& other):_ptr(other._ptr){}
-	~Git2PtrWrapper(){}
+	/**
+	 * Share the wrapped pointer with a new wrapper, like a copy does.
+	 */
+	_Class share() const {return _Class(*this);}
 
-	bool ok()const{return _ptr.get()!=nullptr;}
-	_Type* data() const {return _ptr.get();}
-	_PtrType& ptr() const {return _ptr;}
+	bool ok()const{return _ptr!=nullptr;}
+	_Type* data() const {return _ptr;}
 
 private:
-	_PtrType _ptr;
+	void shareTo(_Class& copy) const
+	{
+		if(_ptr==nullptr)
+			return;
+		if(_Dup!=nullptr)
+		{
+			// libgit2 counts the references itself (it never fails for
+			// the structures it is used with).
+			count_ref_update();
+			if(_Dup(&copy._ptr, _ptr)!=0)
+				copy._ptr = nullptr;
+			return;
+		}
+
+		Git2SharedCount* count = _count.load(std::memory_order_acquire);
+		if(count==nullptr)
+		{
+			// First share: this wrapper and the copy.
+			Git2SharedCount* created = new Git2SharedCount(2);
+			count_ref_update();
+			if(_count.compare_exchange_strong(count, created, std::memory_order_acq_rel))
+				count = created;
+			else
+			{
+				delete created;
+				count_ref_update();
+				count->refs.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		else
+		{
+			count_ref_update();
+			count->refs.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		copy._ptr = _ptr;
+		copy._count.store(count, std::memory_order_relaxed);
+	}
+
+	void unref()
+	{
+		Git2SharedCount* count = _count.load(std::memory_order_relaxed);
+		if(count!=nullptr)
+		{
+			count_ref_update();
+			if(count->refs.fetch_sub(1, std::memory_order_acq_rel)!=1)
+				return;
+			delete count;
+		}
+		if(_ptr!=nullptr && _Deleter!=nullptr)
+		{
+			// Freeing a structure libgit2 counts drops a reference.
+			if(_Dup!=nullptr)
+				count_ref_update();
+			_Deleter(_ptr);
+		}
+	}
+
+	_Type* _ptr;
+	mutable std::atomic<Git2SharedCount*> _count;
 };
 
 /**
@@ -25,20 +25,19 @@ namespace git2
 {
 
 Config::Config(git_config *cfg):
-_conf(cfg)
+_Class(cfg)
 {
-    if (_conf == NULL)
-        git_config_new(&_conf);
+    if (cfg == NULL && git_config_new(&cfg) == GIT_OK)
+        _Class::operator=(_Class(cfg));
 }
 
 Config::Config(const Config &other):
-_conf(other._conf)
+_Class(other)
 {
 }
 
 Config::~Config()
 {
-    git_config_free(_conf);
 }
 
 Config Config::openDefaultConfig()
@@ -123,13 +122,13 @@ int64_t Config::parseInt64(const std::string& value)
 
 bool Config::addFile(const std::string &path, Level level, bool force)
 {
-    return git_config_add_file_ondisk(_conf, path.c_str(), (git_config_level_t)level, force ? 1 : 0) == GIT_OK;
+    return git_config_add_file_ondisk(data(), path.c_str(), (git_config_level_t)level, force ? 1 : 0) == GIT_OK;
 }
 
 bool Config::get(const std::string &key, std::string& value) const
 {
     const char * result = NULL;
-    if (git_config_get_string(&result, _conf, key.c_str()) == GIT_OK)
+    if (git_config_get_string(&result, data(), key.c_str()) == GIT_OK)
 	{
 		value.assign(result);
         return true;
@@ -143,7 +142,7 @@ bool Config::get(const std::string &key, std::string& value) const
 std::string Config::get(const std::string &key, const std::string &defaultValue) const
 {
     const char * result = NULL;
-    if (git_config_get_string(&result, _conf, key.c_str()) == GIT_OK)
+    if (git_config_get_string(&result, data(), key.c_str()) == GIT_OK)
         return std::string(result);
 
     return defaultValue;
@@ -151,45 +150,45 @@ std::string Config::get(const std::string &key, const std::string &defaultValue)
 
 void Config::set(const std::string &key, const std::string &value)
 {
-    Exception::git2_assert( git_config_set_string(_conf, key.c_str(), value.c_str()) );
+    Exception::git2_assert( git_config_set_string(data(), key.c_str(), value.c_str()) );
 }
 
 
 
 bool Config::get(const std::string &key, int32_t* value) const
 {
-    return git_config_get_int32(value, _conf, key.c_str()) == GIT_OK;
+    return git_config_get_int32(value, data(), key.c_str()) == GIT_OK;
 }
 
 int32_t Config::get(const std::string &key, int32_t defaultValue) const
 {
     int32_t result = 0;
-    if (git_config_get_int32(&result, _conf, key.c_str()) == GIT_OK)
+    if (git_config_get_int32(&result, data(), key.c_str()) == GIT_OK)
         return result;
     return defaultValue;
 }
 
 void Config::set(const std::string &key, int32_t value)
 {
-	Exception::git2_assert( git_config_set_int32(_conf, key.c_str(), value) );	
+	Exception::git2_assert( git_config_set_int32(data(), key.c_str(), value) );	
 }
 
 bool Config::get(const std::string &key, int64_t* value) const
 {
-    return git_config_get_int64(value, _conf, key.c_str()) == GIT_OK;
+    return git_config_get_int64(value, data(), key.c_str()) == GIT_OK;
 }
 
 int64_t Config::get(const std::string &key, int64_t defaultValue) const
 {
     int64_t result = 0;
-    if (git_config_get_int64(&result, _conf, key.c_str()) == GIT_OK)
+    if (git_config_get_int64(&result, data(), key.c_str()) == GIT_OK)
         return result;
     return defaultValue;
 }
 
 void Config::set(const std::string &key, int64_t value)
 {
-	Exception::git2_assert( git_config_set_int64(_conf, key.c_str(), value) );	
+	Exception::git2_assert( git_config_set_int64(data(), key.c_str(), value) );	
 }
 
 
@@ -197,7 +196,7 @@ void Config::set(const std::string &key, int64_t value)
 bool Config::get(const std::string &key, bool* value) const
 {
 	int result = 0;
-    if(git_config_get_bool(&result, _conf, key.c_str()) == GIT_OK)
+    if(git_config_get_bool(&result, data(), key.c_str()) == GIT_OK)
 	{
 		*value = result;
 		return true;
@@ -209,7 +208,7 @@ bool Config::get(const std::string &key, bool* value) const
 int32_t Config::get(const std::string &key, bool defaultValue) const
 {
     int result = 0;
-    if (git_config_get_bool(&result, _conf, key.c_str()) == GIT_OK)
+    if (git_config_get_bool(&result, data(), key.c_str()) == GIT_OK)
 	{
         return result;
 	}
@@ -218,23 +217,18 @@ int32_t Config::get(const std::string &key, bool defaultValue) const
 
 void Config::set(const std::string &key, bool value)
 {
-	Exception::git2_assert( git_config_set_bool(_conf, key.c_str(), value?1:0) );
+	Exception::git2_assert( git_config_set_bool(data(), key.c_str(), value?1:0) );
 }
 
 
 void Config::deleteEntry(const std::string &name)
 {
-	Exception::git2_assert( git_config_delete_entry(_conf, name.c_str()) );	
-}
-
-git_config * Config::data()
-{
-	return _conf;
+	Exception::git2_assert( git_config_delete_entry(data(), name.c_str()) );	
 }
 
 const git_config * Config::constData()const
 {
-	return _conf;
+	return data();
 }
 
 } // namespace git2
@@ -24,6 +24,8 @@
 
 #include <string>
 
+#include "common.hpp"
+
 namespace git2
 {
 
@@ -32,7 +34,7 @@ class Repository;
 /**
   * Represents the git configuration file.
   */
-class Config
+class Config : public helper::Git2PtrWrapper<git_config, git_config_free>
 {
 public:
 	enum Level {
@@ -51,6 +53,11 @@ public:
 	  */
 	Config(git_config *cfg = 0);
 	Config(const Config &other);
+	Config(Config&& other) = default;
+
+	Config& operator=(const Config& other) = default;
+	Config& operator=(Config&& other) = default;
+
 	virtual ~Config();
 
 	/**
@@ -296,11 +303,7 @@ public:
 	// static std::string findXdg();
 
 
-	git_config * data();
 	const git_config * constData()const;
-
-private:
-	git_config * _conf; //!< internal pointer to the libgit2 config instance
 };
 
 } // namespace git2
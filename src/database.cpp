@@ -22,10 +22,105 @@
 #include <git2/odb_backend.h>
 
 #include "exception.hpp"
+#include "packindex.hpp"
+#include "prefixindex.hpp"
+
+#include <algorithm>
+#include <cstring>
 
 namespace git2
 {
 
+namespace
+{
+
+const size_t bloom_bits_per_object = 10;
+const unsigned int bloom_hashes = 7;
+
+/**
+ * Append the ids of the loose objects of an objects directory.
+ */
+void list_loose(const std::string& dirPath, std::vector<git_oid>& ids)
+{
+	static const char hex[] = "0123456789abcdef";
+	for(int n=0; n<256; ++n)
+	{
+		char prefix[3] = {hex[n >> 4], hex[n & 0x0f], 0};
+		for(const std::string& name : helper::list_dir(dirPath + "/" + prefix))
+		{
+			if(name.size()!=GIT_OID_HEXSZ-2)
+				continue;
+			std::string str = prefix + name;
+			git_oid oid;
+			if(git_oid_fromstrn(&oid, str.c_str(), str.size())==GIT_OK)
+				ids.push_back(oid);
+			else
+				giterr_clear();
+		}
+	}
+}
+
+/**
+ * Bloom filter of object ids.
+ *
+ * Ids are SHA-1 hashes, so their bytes are used as is to derive the bit
+ * positions, by double hashing.
+ */
+class OIdBloomFilter
+{
+public:
+	explicit OIdBloomFilter(size_t count)
+	{
+		size_t bits = 64;
+		while(bits<count*bloom_bits_per_object)
+			bits *= 2;
+		_bits.assign(bits/64, 0);
+		_mask = bits-1;
+	}
+
+	void add(const unsigned char* oid)
+	{
+		uint64_t hash, step;
+		hashes(oid, hash, step);
+		for(unsigned int n=0; n<bloom_hashes; ++n, hash+=step)
+			_bits[(hash & _mask) >> 6] |= (uint64_t)1 << (hash & 63);
+	}
+
+	bool mayContain(const unsigned char* oid) const
+	{
+		uint64_t hash, step;
+		hashes(oid, hash, step);
+		for(unsigned int n=0; n<bloom_hashes; ++n, hash+=step)
+		{
+			if(!(_bits[(hash & _mask) >> 6] & ((uint64_t)1 << (hash & 63))))
+				return false;
+		}
+		return true;
+	}
+
+private:
+	static void hashes(const unsigned char* oid, uint64_t& hash, uint64_t& step)
+	{
+		std::memcpy(&hash, oid, sizeof(hash));
+		std::memcpy(&step, oid+sizeof(hash), sizeof(step));
+		step |= 1;
+	}
+
+	std::vector<uint64_t> _bits;
+	uint64_t _mask;
+};
+
+} // namespace
+
+/**
+ * Pack indexes loaded for Database::existsMany().
+ */
+struct Database::PackIndexes
+{
+	std::vector<std::shared_ptr<const helper::PackIndex>> packs;
+	std::unique_ptr<OIdBloomFilter> filter;
+};
+
 
 //
 // DatabaseBackend
@@ -86,7 +181,7 @@ _Class(obj)
 }
 
 DatabaseObject::DatabaseObject(const DatabaseObject& other):
-_Class(other.data())
+_Class(other)
 {
 }
 
@@ -126,7 +221,8 @@ _db(odb)
 {
 }
 
-Database::Database( const Database& db )
+Database::Database( const Database& db ):
+_packIndexes(db._packIndexes)
 {
     _db = db._db;
 }
@@ -152,6 +248,12 @@ void Database::refresh()
 	Exception::git2_assert( git_odb_refresh(data()) );
 }
 
+void Database::refresh(OIdPrefixIndex& index)
+{
+	refresh();
+	index.refresh();
+}
+
 void Database::addBackend(DatabaseBackend *backend, int priority)
 {
     Exception::git2_assert( git_odb_add_backend(_db, (git_odb_backend *)backend, priority) );
@@ -172,6 +274,86 @@ int Database::exists(const OId& id)
     return git_odb_exists(_db, id.constData());
 }
 
+size_t Database::existsMany(const OId* oids, size_t count, std::vector<bool>& found)
+{
+	found.assign(count, false);
+	std::vector<size_t> pending(count);
+	for(size_t n=0; n<count; ++n)
+		pending[n] = n;
+	std::sort(pending.begin(), pending.end(), [oids](size_t a, size_t b){
+		return std::memcmp(oids[a].constData()->id, oids[b].constData()->id, GIT_OID_RAWSZ)<0;
+	});
+
+	if(const PackIndexes* indexes = _packIndexes.get())
+	{
+		// A negative answer of the filter is final.
+		if(indexes->filter)
+		{
+			pending.erase(std::remove_if(pending.begin(), pending.end(), [&](size_t n){
+				return !indexes->filter->mayContain(oids[n].constData()->id);
+			}), pending.end());
+		}
+
+		// The ids are sorted, so each pack index is searched forward only.
+		std::vector<size_t> missing;
+		for(const std::shared_ptr<const helper::PackIndex>& pack : indexes->packs)
+		{
+			size_t pos = 0;
+			missing.clear();
+			for(size_t n : pending)
+			{
+				const unsigned char* id = oids[n].constData()->id;
+				pos = pack->lowerBound(id, pos);
+				if(pos<pack->count() && std::memcmp(pack->id(pos), id, GIT_OID_RAWSZ)==0)
+					found[n] = true;
+				else
+					missing.push_back(n);
+			}
+			pending.swap(missing);
+		}
+	}
+
+	// Loose objects, other backends and false positives of the filter.
+	for(size_t n=0; n<pending.size(); ++n)
+	{
+		const git_oid* id = oids[pending[n]].constData();
+		if(n>0 && git_oid_cmp(id, oids[pending[n-1]].constData())==0)
+			found[pending[n]] = found[pending[n-1]];
+		else
+			found[pending[n]] = git_odb_exists(_db, id)!=0;
+	}
+	return std::count(found.begin(), found.end(), true);
+}
+
+void Database::loadPackIndexes(const std::string& objectsDir, bool bloomFilter)
+{
+	std::shared_ptr<PackIndexes> indexes(new PackIndexes);
+	indexes->packs = helper::pack_indexes(objectsDir);
+
+	// Each objects directory has a loose and a pack backend; objects of
+	// any other backend would be missing from the filter.
+	const std::vector<std::string> dirs = helper::object_dirs(objectsDir);
+	if(bloomFilter && git_odb_num_backends(_db)<=2*dirs.size())
+	{
+		std::vector<git_oid> loose;
+		for(const std::string& dir : dirs)
+			list_loose(dir, loose);
+		size_t total = loose.size();
+		for(const std::shared_ptr<const helper::PackIndex>& pack : indexes->packs)
+			total += pack->count();
+
+		indexes->filter.reset(new OIdBloomFilter(total));
+		for(const std::shared_ptr<const helper::PackIndex>& pack : indexes->packs)
+		{
+			for(size_t n=0; n<pack->count(); ++n)
+				indexes->filter->add(pack->id(n));
+		}
+		for(const git_oid& oid : loose)
+			indexes->filter->add(oid.id);
+	}
+	_packIndexes = indexes;
+}
+
 size_t Database::getNumBackends()
 {
 	return git_odb_num_backends(data());
@@ -28,13 +28,16 @@
 #include "oid.hpp"
 #include "object.hpp"
 
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace git2
 {
 
 class DatabaseBackend;
 class Database;
+class OIdPrefixIndex;
 
 /**
  * Represents a Git object database backend.
@@ -82,11 +85,15 @@ private:
 /**
  * Represents a Git object.
  */
-class DatabaseObject : public helper::Git2PtrWrapper<git_odb_object, git_odb_object_free>
+class DatabaseObject : public helper::Git2PtrWrapper<git_odb_object, git_odb_object_free, git_odb_object_dup>
 {
 public:
 	DatabaseObject(git_odb_object* obj);
 	DatabaseObject(const DatabaseObject& other);
+	DatabaseObject(DatabaseObject&& other) = default;
+
+	DatabaseObject& operator=(const DatabaseObject& other) = default;
+	DatabaseObject& operator=(DatabaseObject&& other) = default;
 
 	/**
 	 * Return the size of an ODB object.
@@ -165,6 +172,15 @@ public:
      */
     void refresh();
 
+    /**
+     * Refresh the object database and a prefix index of its objects
+     * directory, to load and index newly added files.
+     *
+     * @param index Prefix index to refresh along with the database.
+     * @throws Exception
+     */
+    void refresh(OIdPrefixIndex& index);
+
     /**
      * Add a custom backend to an existing Object DB
      *
@@ -214,6 +230,43 @@ public:
      */
     int exists(const OId& id);
 
+    /**
+     * Determine which of many objects can be found in the object database.
+     *
+     * The ids are sorted first. When pack indexes were loaded with
+     * loadPackIndexes(), they are searched in each pack index in a single
+     * forward pass, and only the ids found in no pack are looked up one by
+     * one through the backends. With the Bloom filter, the ids it rejects
+     * are reported missing without any lookup.
+     *
+     * @param oids Array of count object ids.
+     * @param count Number of ids.
+     * @param found Receives count flags, true for the ids found.
+     * @return Number of ids found.
+     */
+    size_t existsMany(const OId* oids, size_t count, std::vector<bool>& found);
+
+    /**
+     * Load the pack indexes used by existsMany().
+     *
+     * The .idx files of the objects directory and of its alternates are
+     * mapped in memory. Objects added later are still found through the
+     * backends.
+     *
+     * The optional Bloom filter holds the ids of all the packs and loose
+     * objects, at about 10 bits per object, so most missing ids are
+     * answered without reading any file. It is a snapshot: objects written
+     * after the load are reported missing until this method is called
+     * again. It is not built when the database has backends other than the
+     * loose and pack ones of these directories, whose objects it could not
+     * know.
+     *
+     * @param objectsDir path of the "objects" directory.
+     * @param bloomFilter true to build the Bloom filter.
+     * @throws Exception if a pack index cannot be read.
+     */
+    void loadPackIndexes(const std::string& objectsDir, bool bloomFilter = false);
+
 	// TODO implement foreach functions (git_odb_foreach)
 	
 	/**
@@ -293,7 +346,10 @@ public:
 
     git_odb* data() const;
 private:
+    struct PackIndexes;
+
     git_odb *_db;
+    std::shared_ptr<PackIndexes> _packIndexes;
 };
 
 
@@ -19,11 +19,22 @@
 
 #include "diff.hpp"
 
+#include "blob.hpp"
 #include "exception.hpp"
 #include "oid.hpp"
+#include "oidmap.hpp"
 #include "repository.hpp"
 #include "ref.hpp"
 #include "signature.hpp"
+#include "similarity.hpp"
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
 
 namespace git2
 {
@@ -42,15 +53,6 @@ _mode(diff_file!=NULL ? diff_file->mode : 0)
 {
 }
 
-DiffFile::DiffFile(const DiffFile& other):
-_oid(other._oid),
-_path(other._path),
-_size(other._size),
-_flags(other._flags),
-_mode(other._mode)
-{
-}
-
 //
 // DiffDelta
 //
@@ -64,267 +66,1138 @@ _flags(diff_delta!=NULL ? diff_delta->flags : 0)
 {
 }
 
-DiffDelta::DiffDelta(const DiffDelta& other):
-_old(other._old),
-_new(other._new),
-_status(other._status),
-_similarity(other._similarity),
-_flags(other._flags)
+//
+// DiffOptions
+//
+
+DiffOptions::DiffOptions(uint32_t flags):
+_flags(flags),
+_contextLines(3),
+_interhunkLines(0),
+_oldPrefix("a"),
+_newPrefix("b"),
+_maxSize(512*1024*1024)
 {
 }
 
+void DiffOptions::setFlags(uint32_t flags)
+{
+	_flags = flags;
+}
+
+void DiffOptions::setContextLines(uint16_t lines)
+{
+	_contextLines = lines;
+}
+
+void DiffOptions::setInterhunkLines(uint16_t lines)
+{
+	_interhunkLines = lines;
+}
+
+void DiffOptions::setOldPrefix(const std::string& prefix)
+{
+	_oldPrefix = prefix;
+}
+
+void DiffOptions::setNewPrefix(const std::string& prefix)
+{
+	_newPrefix = prefix;
+}
+
+void DiffOptions::setPathspec(const std::vector<std::string>& pathspec)
+{
+	_pathspec = pathspec;
+}
+
+void DiffOptions::setMaxSize(git_off_t size)
+{
+	_maxSize = size;
+}
+
+void DiffOptions::setNotify(DiffNotifyCallbackFunction notify)
+{
+	_notify = notify;
+}
+
+const git_diff_options* DiffOptions::data()const
+{
+	auto notify_cb = [](const git_diff *, const git_diff_delta *delta_to_add, const char *matched_pathspec, void *payload)->int
+	{
+		DiffNotifyCallbackFunction* callback = (DiffNotifyCallbackFunction*)payload;
+		return (*callback)(DiffDelta(delta_to_add), std::string(matched_pathspec!=NULL ? matched_pathspec : ""));
+	};
+
+	_paths.clear();
+	for(const std::string& path : _pathspec)
+		_paths.push_back(const_cast<char*>(path.c_str()));
+
+	git_diff_options options = GIT_DIFF_OPTIONS_INIT;
+	options.flags = _flags;
+	options.pathspec.strings = _paths.empty() ? NULL : _paths.data();
+	options.pathspec.count = _paths.size();
+	options.notify_cb = _notify ? (git_diff_notify_cb)notify_cb : NULL;
+	options.notify_payload = _notify ? (void*)&_notify : NULL;
+	options.context_lines = _contextLines;
+	options.interhunk_lines = _interhunkLines;
+	options.max_size = _maxSize;
+	options.old_prefix = _oldPrefix.c_str();
+	options.new_prefix = _newPrefix.c_str();
+	_options = options;
+	return &_options;
+}
+
+//
+// DiffStats
+//
+
+DiffStats::DiffStats():
+_additions(0),
+_deletions(0)
+{
+}
+
+void DiffStats::add(const DiffFileStats& file)
+{
+	_files.push_back(file);
+	_additions += file.additions;
+	_deletions += file.deletions;
+}
+
 //
 // DiffList
 //
 
-// DiffList::DiffList(git_diff_list* list):
-// _Class(list)
-// {
-// }
-
-// DiffList::DiffList(const DiffList& other):
-// _Class(other.data())
-// {
-// }
-
-// void DiffList::merge(const DiffList& from)
-// {
-// 	Exception::git2_assert(git_diff_merge(data(), from.data()));
-// }
-
-// bool DiffList::findSimilar()
-// {
-// 	return git_diff_find_similar(data(), NULL) == 0;
-// }
-
-// bool DiffList::findSimilar(uint32_t flags, uint16_t renameThreshold,
-// 		uint16_t renameFromRewriteThreshold, uint16_t copyThreshold,
-// 		uint16_t breakRewriteThreshold, size_t renameLimit)
-// {
-// 	git_diff_find_options options = {
-// 		GIT_DIFF_FIND_OPTIONS_VERSION,
-// 		flags,
-// 		renameThreshold,
-// 		renameFromRewriteThreshold,
-// 		copyThreshold,
-// 		breakRewriteThreshold,
-// 		renameLimit,
-// 		NULL
-// 	};
-// 	return git_diff_find_similar(data(), &options) == 0;
-// }
-
-// bool DiffList::foreach(DiffFileCallbackFunction fileCallback, DiffHunkCallbackFunction hunkCallback,
-// 		DiffDataCallbackFunction lineCallback)
-// {
-// 	auto file_cb = [](const git_diff_delta *delta, float progress, void *payload)->int
-// 	{
-// 		void** ptr = (void**)payload;
-// 		DiffFileCallbackFunction* callback = (DiffFileCallbackFunction*)ptr[0];
-// 		if(callback!=nullptr)
-// 			return (*callback)(DiffDelta(delta), progress);
-// 		else
-// 			return 0;
-// 	};
-
-// 	auto hunk_cb = [](const git_diff_delta *delta, const git_diff_hunk *range, const char *header, size_t header_len, void *payload)->int
-// 	{
-// 		void** ptr = (void**)payload;
-// 		DiffHunkCallbackFunction* callback = (DiffHunkCallbackFunction*)ptr[1];
-// 		if(callback!=nullptr)
-// 			return (*callback)(DiffDelta(delta), range, std::string(header, header_len));
-// 		else
-// 			return 0;
-// 	};
-
-// 	auto line_cb = [](const git_diff_delta *delta, const git_diff_hunk *range, char line_origin, const char *content, size_t content_len, void *payload)->int
-// 	{
-// 		void** ptr = (void**)payload;
-// 		DiffDataCallbackFunction* callback = (DiffDataCallbackFunction*)ptr[2];
-// 		if(callback!=nullptr)
-// 			return (*callback)(DiffDelta(delta), range, line_origin, std::string(content, content_len));
-// 		else
-// 			return 0;
-// 	};
-
-// 	void* ptr[3] = {(void*)&file_cb, (void*)&hunk_cb, (void*)&line_cb};
-
-// 	int res = git_diff_foreach(data(), file_cb, hunk_cb, line_cb, (void*)ptr);
-// 	if(res==GIT_OK)
-// 		return true;
-// 	else if(res==GIT_EUSER)
-// 		return false;
-// 	else
-// 		Exception::git2_assert(res);
-// }
-
-// bool DiffList::printCompact(DiffDataCallbackFunction printCallback)
-// {
-// 	auto print_cb = [](const git_diff_delta *delta, const git_diff_hunk *range, char line_origin, const char *content, size_t content_len, void *payload)->int
-// 	{
-// 		DiffDataCallbackFunction* callback = (DiffDataCallbackFunction*)payload;
-// 		if(callback!=nullptr)
-// 			return (*callback)(DiffDelta(delta), range, line_origin, std::string(content, content_len));
-// 		else
-// 			return 0;
-// 	};
-// 	int res = git_diff_print_compact(data(), print_cb, (void*)&printCallback);
-// 	if(res==GIT_OK)
-// 		return true;
-// 	else if(res==GIT_EUSER)
-// 		return false;
-// 	else
-// 		Exception::git2_assert(res);
-// }
-
-// bool DiffList::printRaw(DiffDataCallbackFunction printCallback)
-// {
-// 	auto print_cb = [](const git_diff_delta *delta, const git_diff_hunk *range, char line_origin, const char *content, size_t content_len, void *payload)->int
-// 	{
-// 		DiffDataCallbackFunction* callback = (DiffDataCallbackFunction*)payload;
-// 		if(callback!=nullptr)
-// 			return (*callback)(DiffDelta(delta), range, line_origin, std::string(content, content_len));
-// 		else
-// 			return 0;
-// 	};
-// 	int res = git_diff_print_raw(data(), print_cb, (void*)&printCallback);
-// 	if(res==GIT_OK)
-// 		return true;
-// 	else if(res==GIT_EUSER)
-// 		return false;
-// 	else
-// 		Exception::git2_assert(res);
-// }
-
-// bool DiffList::printPatch(DiffDataCallbackFunction printCallback)
-// {
-// 	auto print_cb = [](const git_diff_delta *delta, const git_diff_hunk *range, char line_origin, const char *content, size_t content_len, void *payload)->int
-// 	{
-// 		DiffDataCallbackFunction* callback = (DiffDataCallbackFunction*)payload;
-// 		if(callback!=nullptr)
-// 			return (*callback)(DiffDelta(delta), range, line_origin, std::string(content, content_len));
-// 		else
-// 			return 0;
-// 	};
-// 	int res = git_diff_print_patch(data(), print_cb, (void*)&printCallback);
-// 	if(res==GIT_OK)
-// 		return true;
-// 	else if(res==GIT_EUSER)
-// 		return false;
-// 	else
-// 		Exception::git2_assert(res);
-// }
-
-// size_t DiffList::deltaCount()const
-// {
-// 	return git_diff_num_deltas(data());
-// }
-
-// size_t DiffList::deltaCount(git_delta_t type)const
-// {
-// 	return git_diff_num_deltas_of_type(data(), type);
-// }
-
-// DiffPatch DiffList::patch(size_t idx)
-// {
-// 	git_diff_patch *out;
-// 	Exception::git2_assert(git_diff_get_patch(&out, NULL, data(), idx));
-// 	return DiffPatch(out);
-// }
-
-// DiffDelta DiffList::delta(size_t idx)
-// {
-// 	const git_diff_delta *out;
-// 	Exception::git2_assert(git_diff_get_patch(NULL, &out, data(), idx));
-// 	return DiffDelta(out);
-// }
+namespace
+{
+
+/**
+ * Callbacks of an iteration, and the delta of the file being iterated,
+ * converted once per file rather than per line.
+ */
+struct DiffPayload
+{
+	DiffPayload(const DiffFileCallbackFunction* file, const DiffHunkCallbackFunction* hunk,
+		const DiffDataCallbackFunction* line):
+	fileCallback(file), hunkCallback(hunk), lineCallback(line), raw(NULL)
+	{
+	}
+
+	const DiffDelta& deltaOf(const git_diff_delta *delta)
+	{
+		if(delta!=raw)
+		{
+			raw = delta;
+			current = DiffDelta(delta);
+		}
+		return current;
+	}
+
+	const DiffFileCallbackFunction* fileCallback;
+	const DiffHunkCallbackFunction* hunkCallback;
+	const DiffDataCallbackFunction* lineCallback;
+	const git_diff_delta* raw;
+	DiffDelta current;
+};
+
+int diff_file_cb(const git_diff_delta *delta, float progress, void *payload)
+{
+	DiffPayload* p = (DiffPayload*)payload;
+	return (*p->fileCallback)(p->deltaOf(delta), progress) ? 0 : GIT_EUSER;
+}
+
+int diff_hunk_cb(const git_diff_delta *delta, const git_diff_hunk *hunk, void *payload)
+{
+	DiffPayload* p = (DiffPayload*)payload;
+	return (*p->hunkCallback)(p->deltaOf(delta), DiffHunk(hunk)) ? 0 : GIT_EUSER;
+}
+
+int diff_line_cb(const git_diff_delta *delta, const git_diff_hunk *hunk, const git_diff_line *line, void *payload)
+{
+	DiffPayload* p = (DiffPayload*)payload;
+	return (*p->lineCallback)(p->deltaOf(delta), DiffHunk(hunk), DiffLine(line)) ? 0 : GIT_EUSER;
+}
+
+bool iteration_result(int res)
+{
+	if(res==GIT_EUSER)
+		return false;
+	Exception::git2_assert(res);
+	return true;
+}
+
+/**
+ * Look up the blob of one side of a delta, or an empty blob if the side is
+ * absent.
+ * @return false if the blob is not in the object database, as working
+ * directory files libgit2 hashed without writing them.
+ */
+bool side_blob(const Repository& repo, const git_diff_file& file, Blob& blob)
+{
+	if(file.mode==0)
+	{
+		blob = Blob();
+		return true;
+	}
+	git_blob *out = NULL;
+	int res = git_blob_lookup(&out, repo.data(), &file.id);
+	if(res==GIT_ENOTFOUND)
+	{
+		giterr_clear();
+		return false;
+	}
+	Exception::git2_assert(res);
+	blob = Blob(out);
+	return true;
+}
+
+/**
+ * Blobs recently loaded by a patch worker, dropped all at once when they
+ * weigh more than the budget.
+ */
+class BlobCache
+{
+public:
+	BlobCache(const Repository& repo, size_t budget):
+	_repo(repo), _budget(budget), _size(0)
+	{
+	}
+
+	/**
+	 * Blob of one side of a delta, as side_blob().
+	 */
+	bool blob(const git_diff_file& file, Blob& blob)
+	{
+		if(file.mode==0)
+			return side_blob(_repo, file, blob);
+		OId oid(&file.id);
+		if(const Blob* cached = _blobs.find(oid))
+		{
+			blob = *cached;
+			return true;
+		}
+		if(!side_blob(_repo, file, blob))
+			return false;
+		size_t size = blob.rawSize();
+		if(size <= _budget)
+		{
+			if(_size + size > _budget)
+			{
+				_blobs.clear();
+				_size = 0;
+			}
+			_blobs.insert(oid, blob);
+			_size += size;
+		}
+		return true;
+	}
+
+private:
+	Repository _repo;
+	OIdMap<Blob> _blobs;
+	size_t _budget;
+	size_t _size;
+};
+
+/**
+ * Whether a side of a delta can be diffed from its blob: it is absent (no
+ * mode) or libgit2 knows its blob id. Working directory files libgit2 has
+ * not hashed have a zero id without GIT_DIFF_FLAG_VALID_ID.
+ */
+bool has_blob(const git_diff_file& file)
+{
+	if(file.mode==0)
+		return true;
+	return (file.flags & GIT_DIFF_FLAG_VALID_ID)!=0 && file.mode!=GIT_FILEMODE_COMMIT;
+}
+
+/**
+ * Line of a file, with its newline if any.
+ */
+struct LineKey
+{
+	const char* data;
+	size_t size;
+};
+
+struct LineKeyHash
+{
+	size_t operator()(const LineKey& key)const
+	{
+		// FNV-1a, a word at a time.
+		uint64_t hash = 0xcbf29ce484222325ull;
+		const char* p = key.data;
+		size_t n = key.size;
+		for(; n >= 8; p += 8, n -= 8)
+		{
+			uint64_t word;
+			std::memcpy(&word, p, 8);
+			hash = (hash ^ word) * 0x100000001b3ull;
+		}
+		for(; n > 0; ++p, --n)
+			hash = (hash ^ (unsigned char)*p) * 0x100000001b3ull;
+		return hash ^ (hash >> 32);
+	}
+};
+
+struct LineKeyEqual
+{
+	bool operator()(const LineKey& a, const LineKey& b)const
+	{
+		return a.size==b.size && std::memcmp(a.data, b.data, a.size)==0;
+	}
+};
+
+typedef std::unordered_map<LineKey, uint32_t, LineKeyHash, LineKeyEqual> LineClasses;
+
+/**
+ * Split a file in lines and replace each line by the number of its class
+ * of equal lines.
+ */
+void split_lines(const char* data, size_t size, LineClasses& classes, std::vector<uint32_t>& lines)
+{
+	const char* end = data + size;
+	while(data < end)
+	{
+		const char* newline = (const char*)std::memchr(data, '\n', end - data);
+		const char* next = newline!=NULL ? newline + 1 : end;
+		LineKey key = {data, size_t(next - data)};
+		uint32_t id = classes.size();
+		lines.push_back(classes.emplace(key, id).first->second);
+		data = next;
+	}
+}
+
+/**
+ * Constants of xdiff the line counts follow to match the patches:
+ * XDL_SIMSCAN_WINDOW, XDL_MAX_EQLIMIT and XDL_HEUR_MIN_COST. The
+ * bench/diffstats check compares the counts with the patches over a
+ * history.
+ */
+const size_t xdl_simscan_window = 100;
+const size_t xdl_max_eqlimit = 1024;
+const int64_t xdl_heur_min_cost = 256;
+
+/**
+ * Whether a line matching many lines of the other file is in the middle of
+ * lines without match, and should be ignored like xdiff does.
+ */
+bool lonely_multimatch(const std::vector<char>& matches, size_t i)
+{
+	const size_t window = xdl_simscan_window;
+	const size_t first = i > window ? i - window : 0;
+	const size_t last = std::min(matches.size() - 1, i + window);
+
+	size_t none = 0, multi = 1;
+	for(size_t j = i; j > first && matches[j-1]!=1; --j)
+		++(matches[j-1]==0 ? none : multi);
+	if(none==0)
+		return false;
+	size_t noneAfter = 0;
+	++multi;
+	for(size_t j = i + 1; j <= last && matches[j]!=1; ++j)
+		++(matches[j]==0 ? noneAfter : multi);
+	if(noneAfter==0)
+		return false;
+	none += noneAfter;
+	return multi * 4 < multi + none;
+}
+
+/**
+ * Keep the lines of a file which may be common with the other file.
+ *
+ * As xdiff, this drops the lines missing from the other file, and the
+ * lines matching many others (like blank lines) when surrounded by lines
+ * without match, so that the counts are the ones Git reports.
+ */
+void candidate_lines(const std::vector<uint32_t>& lines, size_t begin, size_t end,
+	const std::vector<uint32_t>& otherCounts, std::vector<uint32_t>& kept)
+{
+	size_t many = 1;
+	for(size_t n = lines.size(); n > 0; n >>= 2)
+		many <<= 1;
+	many = std::min<size_t>(many, xdl_max_eqlimit);
+
+	std::vector<char> matches(end - begin);
+	for(size_t n = begin; n < end; ++n)
+	{
+		uint32_t count = otherCounts[lines[n]];
+		matches[n - begin] = count==0 ? 0 : count >= many ? 2 : 1;
+	}
+	for(size_t n = begin; n < end; ++n)
+	{
+		char match = matches[n - begin];
+		if(match==1 || (match==2 && !lonely_multimatch(matches, n - begin)))
+			kept.push_back(lines[n]);
+	}
+}
+
+/**
+ * Number of lines of a longest common subsequence of two files, by
+ * Myers' algorithm.
+ *
+ * Past an edit cost of XDL_HEUR_MIN_COST xdiff trades minimality for
+ * speed, so such files are left to the patch generator to count the way
+ * git does.
+ *
+ * @return false if the files differ by more than that cost.
+ */
+bool common_lines(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b,
+	size_t classCount, size_t& common)
+{
+	size_t begin = 0;
+	while(begin < a.size() && begin < b.size() && a[begin]==b[begin])
+		++begin;
+	size_t endA = a.size(), endB = b.size();
+	while(endA > begin && endB > begin && a[endA-1]==b[endB-1])
+		--endA, --endB;
+	common = begin + (a.size() - endA);
+
+	std::vector<uint32_t> countA(classCount), countB(classCount);
+	for(uint32_t line : a)
+		++countA[line];
+	for(uint32_t line : b)
+		++countB[line];
+	std::vector<uint32_t> x, y;
+	candidate_lines(a, begin, endA, countB, x);
+	candidate_lines(b, begin, endB, countA, y);
+
+	const int64_t sizeX = x.size(), sizeY = y.size();
+	if(sizeX==0 || sizeY==0)
+		return true;
+
+	const int64_t maxCost = xdl_heur_min_cost;
+	const int64_t max = sizeX + sizeY;
+	const int64_t diagonals = std::min(max, maxCost);
+	std::vector<int64_t> furthest(2 * diagonals + 3);
+	int64_t* v = furthest.data() + diagonals + 1;
+	for(int64_t d = 0; d <= diagonals; ++d)
+	{
+		for(int64_t k = -d; k <= d; k += 2)
+		{
+			int64_t i = (k==-d || (k!=d && v[k-1] < v[k+1])) ? v[k+1] : v[k-1] + 1;
+			int64_t j = i - k;
+			while(i < sizeX && j < sizeY && x[i]==y[j])
+				++i, ++j;
+			v[k] = i;
+			if(i >= sizeX && j >= sizeY)
+			{
+				common += (max - d) / 2;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+/**
+ * Count the added and deleted lines between two blobs.
+ *
+ * @return false if the blobs are too different to be counted exactly.
+ */
+bool count_lines(const Blob& oldBlob, const Blob& newBlob, DiffFileStats& stats)
+{
+	LineClasses classes;
+	std::vector<uint32_t> oldLines, newLines;
+	if(oldBlob.ok())
+		split_lines((const char*)oldBlob.rawContent(), oldBlob.rawSize(), classes, oldLines);
+	if(newBlob.ok())
+		split_lines((const char*)newBlob.rawContent(), newBlob.rawSize(), classes, newLines);
+
+	size_t common;
+	if(!common_lines(oldLines, newLines, classes.size(), common))
+		return false;
+	stats.additions = newLines.size() - common;
+	stats.deletions = oldLines.size() - common;
+	return true;
+}
+
+/**
+ * Patch waiting for its turn, with the blobs its lines point into.
+ */
+struct PendingPatch
+{
+	DiffPatch patch;
+	Blob oldBlob, newBlob;
+	size_t weight = 0;
+	bool ready = false;
+};
+
+void find_similar(git_diff *diff, uint32_t flags, uint16_t renameThreshold,
+		uint16_t renameFromRewriteThreshold, uint16_t copyThreshold,
+		uint16_t breakRewriteThreshold, size_t renameLimit, git_diff_similarity_metric *metric)
+{
+	git_diff_find_options options = GIT_DIFF_FIND_OPTIONS_INIT;
+	options.flags = flags;
+	options.rename_threshold = renameThreshold;
+	options.rename_from_rewrite_threshold = renameFromRewriteThreshold;
+	options.copy_threshold = copyThreshold;
+	options.break_rewrite_threshold = breakRewriteThreshold;
+	options.rename_limit = renameLimit;
+	options.metric = metric;
+	Exception::git2_assert(git_diff_find_similar(diff, &options));
+}
+
+/**
+ * Sketch hashes shared by more sources than that do not tell similar
+ * files apart, like the lines of a license header.
+ */
+const size_t MaxSketchSources = 64;
+
+/**
+ * Number of sources sharing the most sketch hashes compared with a target.
+ */
+const size_t MaxRenameCandidates = 16;
+
+const git_oid empty_blob_id = {{0xe6, 0x9d, 0xe2, 0x9b, 0xb2, 0xd1, 0xd6, 0x43, 0x4b, 0x8b,
+	0x29, 0xae, 0x77, 0x5a, 0xd8, 0xc2, 0xe4, 0x8c, 0x53, 0x91}};
+
+/**
+ * Whether a side of a delta is a non-empty blob rename detection can
+ * compare.
+ */
+bool is_renamable(const git_diff_file& file)
+{
+	if((file.flags & GIT_DIFF_FLAG_VALID_ID)==0 || git_oid_iszero(&file.id)
+			|| git_oid_equal(&file.id, &empty_blob_id))
+		return false;
+	return file.mode==GIT_FILEMODE_BLOB || file.mode==GIT_FILEMODE_BLOB_EXECUTABLE
+		|| file.mode==GIT_FILEMODE_LINK;
+}
+
+bool same_file_name(const char* a, const char* b)
+{
+	const char* nameA = std::strrchr(a, '/');
+	const char* nameB = std::strrchr(b, '/');
+	return std::strcmp(nameA!=NULL ? nameA+1 : a, nameB!=NULL ? nameB+1 : b)==0;
+}
+
+/**
+ * File taking part in a rename detection.
+ */
+struct RenameFile
+{
+	size_t index;               // Index of the delta.
+	const git_diff_file* file;  // Old file of a source, new file of a target.
+	size_t signature;           // Index of the signature of its blob.
+	bool deleted;               // Source that can be renamed.
+};
+
+/**
+ * Pair of files similar enough to be a rename or a copy.
+ */
+struct RenameCandidate
+{
+	int similarity;
+	bool sameName;
+	size_t target;
+	size_t source;
+
+	bool operator<(const RenameCandidate& other)const
+	{
+		if(similarity!=other.similarity)
+			return similarity > other.similarity;
+		if(sameName!=other.sameName)
+			return sameName;
+		if(target!=other.target)
+			return target < other.target;
+		return source < other.source;
+	}
+};
+
+} // namespace
+
+DiffList::DiffList(git_diff *diff):
+_Class(diff)
+{
+}
+
+DiffList::DiffList(const DiffList& other):
+_Class(other)
+{
+}
+
+void DiffList::merge(const DiffList& from)
+{
+	Exception::git2_assert(git_diff_merge(data(), from.data()));
+}
+
+void DiffList::findSimilar()
+{
+	Exception::git2_assert(git_diff_find_similar(data(), NULL));
+}
+
+void DiffList::findSimilar(uint32_t flags, uint16_t renameThreshold,
+		uint16_t renameFromRewriteThreshold, uint16_t copyThreshold,
+		uint16_t breakRewriteThreshold, size_t renameLimit)
+{
+	find_similar(data(), flags, renameThreshold, renameFromRewriteThreshold, copyThreshold,
+		breakRewriteThreshold, renameLimit, NULL);
+}
+
+void DiffList::findSimilar(SimilarityCache& cache, uint32_t flags, uint16_t renameThreshold,
+		uint16_t renameFromRewriteThreshold, uint16_t copyThreshold,
+		uint16_t breakRewriteThreshold, size_t renameLimit)
+{
+	find_similar(data(), flags, renameThreshold, renameFromRewriteThreshold, copyThreshold,
+		breakRewriteThreshold, renameLimit, cache.metric());
+}
+
+std::vector<DiffRename> DiffList::findRenames(const Repository& repo, ThreadPool& pool,
+		SimilarityCache& cache, uint32_t flags, uint16_t renameThreshold, uint16_t copyThreshold)const
+{
+	const bool renames = (flags & GIT_DIFF_FIND_RENAMES)!=0;
+	const bool copies = (flags & GIT_DIFF_FIND_COPIES)!=0;
+	const bool unmodified = (flags & GIT_DIFF_FIND_COPIES_FROM_UNMODIFIED)!=0;
+	std::vector<DiffRename> found;
+	if(!renames && !copies)
+		return found;
+
+	std::vector<RenameFile> sources, targets;
+	const size_t count = deltaCount();
+	for(size_t idx = 0; idx < count; ++idx)
+	{
+		const git_diff_delta *delta = git_diff_get_delta(data(), idx);
+		if(delta->status==GIT_DELTA_ADDED && is_renamable(delta->new_file))
+			targets.push_back(RenameFile{idx, &delta->new_file, 0, false});
+		else if(is_renamable(delta->old_file) && (delta->status==GIT_DELTA_DELETED
+				|| (copies && delta->status==GIT_DELTA_MODIFIED)
+				|| (copies && unmodified && delta->status==GIT_DELTA_UNMODIFIED)))
+			sources.push_back(RenameFile{idx, &delta->old_file, 0, delta->status==GIT_DELTA_DELETED});
+	}
+	if(sources.empty() || targets.empty())
+		return found;
+
+	std::vector<bool> renamed(sources.size()), matched(targets.size());
+	auto pair = [&](size_t target, size_t source, int similarity)
+	{
+		bool copy;
+		if(renames && sources[source].deleted && !renamed[source] && similarity >= renameThreshold)
+			copy = false;
+		else if(copies && similarity >= copyThreshold)
+			copy = true;
+		else
+			return;
+		renamed[source] = renamed[source] || !copy;
+		matched[target] = true;
+		found.push_back(DiffRename{sources[source].index, targets[target].index, (uint16_t)similarity, copy});
+	};
+	auto byTarget = [](const DiffRename& a, const DiffRename& b){ return a.newIndex < b.newIndex; };
+
+	// Identical blobs first, preferring the sources that can still be
+	// renamed, then the ones with the same name.
+	OIdMap<std::vector<size_t>> sourcesById;
+	for(size_t source = 0; source < sources.size(); ++source)
+		sourcesById[OId(&sources[source].file->id)].push_back(source);
+	for(size_t target = 0; target < targets.size(); ++target)
+	{
+		const std::vector<size_t>* same = sourcesById.find(OId(&targets[target].file->id));
+		if(same==NULL)
+			continue;
+		size_t best = 0;
+		int bestRank = -1;
+		for(size_t source : *same)
+		{
+			const int rank = (sources[source].deleted && !renamed[source] ? 2 : 0)
+				+ (same_file_name(sources[source].file->path, targets[target].file->path) ? 1 : 0);
+			if(rank > bestRank)
+			{
+				best = source;
+				bestRank = rank;
+			}
+		}
+		pair(target, best, 100);
+	}
+	if((flags & GIT_DIFF_FIND_EXACT_MATCH_ONLY)!=0)
+	{
+		std::sort(found.begin(), found.end(), byTarget);
+		return found;
+	}
+
+	// Signatures of the remaining files, from the cache or computed.
+	const int threshold = std::min(renames ? renameThreshold : 100, copies ? copyThreshold : 100);
+	std::vector<size_t> candidateSources, candidateTargets;
+	for(size_t source = 0; source < sources.size(); ++source)
+		if(copies || !renamed[source])
+			candidateSources.push_back(source);
+	for(size_t target = 0; target < targets.size(); ++target)
+		if(!matched[target])
+			candidateTargets.push_back(target);
+	if(candidateSources.empty() || candidateTargets.empty())
+	{
+		std::sort(found.begin(), found.end(), byTarget);
+		return found;
+	}
+
+	OIdMap<size_t> signatureIndex;
+	std::vector<OId> ids;
+	auto addSignature = [&](RenameFile& file)
+	{
+		OId oid(&file.file->id);
+		size_t& index = signatureIndex[oid];
+		if(index==0)
+		{
+			ids.push_back(oid);
+			index = ids.size();
+		}
+		file.signature = index - 1;
+	};
+	for(size_t source : candidateSources)
+		addSignature(sources[source]);
+	for(size_t target : candidateTargets)
+		addSignature(targets[target]);
+
+	std::vector<std::shared_ptr<const SimilaritySignature>> signatures(ids.size());
+	std::vector<size_t> missing;
+	for(size_t n = 0; n < ids.size(); ++n)
+	{
+		signatures[n] = cache.find(ids[n]);
+		if(!signatures[n])
+			missing.push_back(n);
+	}
+	const char* path = git_repository_path(repo.data());
+	std::atomic<size_t> next(0);
+	if(!missing.empty())
+		pool.run([&](unsigned int worker)
+		{
+			if(worker != 0 && path == NULL)
+				return;
+			Repository handle = worker == 0 ? repo : Repository::open(path);
+			for(size_t n = next++; n < missing.size(); n = next++)
+				signatures[missing[n]] = cache.signature(handle, ids[missing[n]]);
+		});
+
+	// Index of the sources by the hashes of their sketch.
+	std::unordered_map<uint32_t, std::vector<uint32_t>> sketchSources;
+	for(size_t n = 0; n < candidateSources.size(); ++n)
+		for(uint32_t hash : signatures[sources[candidateSources[n]].signature]->sketch())
+			sketchSources[hash].push_back(n);
+
+	// Compare each target with the sources sharing most of its sketch.
+	std::vector<std::vector<RenameCandidate>> candidates(candidateTargets.size());
+	next = 0;
+	pool.run([&](unsigned int)
+	{
+		std::unordered_map<uint32_t, uint32_t> shared;
+		std::vector<std::pair<uint32_t, uint32_t>> ranked;
+		for(size_t n = next++; n < candidateTargets.size(); n = next++)
+		{
+			const RenameFile& target = targets[candidateTargets[n]];
+			const SimilaritySignature& signature = *signatures[target.signature];
+			shared.clear();
+			for(uint32_t hash : signature.sketch())
+			{
+				auto it = sketchSources.find(hash);
+				if(it!=sketchSources.end() && it->second.size() <= MaxSketchSources)
+					for(uint32_t source : it->second)
+						++shared[source];
+			}
+
+			ranked.clear();
+			for(const std::pair<const uint32_t, uint32_t>& source : shared)
+				ranked.push_back(std::make_pair(source.second, source.first));
+			auto mostShared = [](const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b)
+			{
+				return a.first!=b.first ? a.first > b.first : a.second < b.second;
+			};
+			if(ranked.size() > MaxRenameCandidates)
+			{
+				std::nth_element(ranked.begin(), ranked.begin() + MaxRenameCandidates, ranked.end(), mostShared);
+				ranked.resize(MaxRenameCandidates);
+			}
+
+			for(const std::pair<uint32_t, uint32_t>& rank : ranked)
+			{
+				const size_t source = candidateSources[rank.second];
+				if((sources[source].file->mode==GIT_FILEMODE_LINK) != (target.file->mode==GIT_FILEMODE_LINK))
+					continue;
+				const SimilaritySignature& other = *signatures[sources[source].signature];
+				// The similarity is at most the ratio of the sizes.
+				const size_t small = std::min(signature.size(), other.size());
+				const size_t large = std::max(signature.size(), other.size());
+				if(small * 100 < large * threshold)
+					continue;
+				const int similarity = signature.similarity(other);
+				if(similarity >= threshold)
+					candidates[n].push_back(RenameCandidate{similarity,
+						same_file_name(sources[source].file->path, target.file->path),
+						candidateTargets[n], source});
+			}
+		}
+	});
+
+	std::vector<RenameCandidate> all;
+	for(const std::vector<RenameCandidate>& target : candidates)
+		all.insert(all.end(), target.begin(), target.end());
+	std::sort(all.begin(), all.end());
+	for(const RenameCandidate& candidate : all)
+		if(!matched[candidate.target])
+			pair(candidate.target, candidate.source, candidate.similarity);
+
+	std::sort(found.begin(), found.end(), byTarget);
+	return found;
+}
+
+bool DiffList::foreach(DiffFileCallbackFunction fileCallback, DiffHunkCallbackFunction hunkCallback,
+		DiffDataCallbackFunction lineCallback)const
+{
+	DiffPayload payload(&fileCallback, &hunkCallback, &lineCallback);
+	return iteration_result(git_diff_foreach(data(),
+		fileCallback ? diff_file_cb : NULL, NULL,
+		hunkCallback ? diff_hunk_cb : NULL,
+		lineCallback ? diff_line_cb : NULL,
+		(void*)&payload));
+}
+
+bool DiffList::foreachPatch(DiffSelectCallbackFunction selectCallback,
+		DiffHunkCallbackFunction hunkCallback, DiffDataCallbackFunction lineCallback)const
+{
+	const size_t count = deltaCount();
+	for(size_t idx = 0; idx < count; ++idx)
+	{
+		if(!selectCallback(idx, DiffDelta(git_diff_get_delta(data(), idx))))
+			continue;
+		DiffPatch patch = this->patch(idx);
+		if(patch.ok() && !patch.foreach(hunkCallback, lineCallback))
+			return false;
+	}
+	return true;
+}
+
+bool DiffList::foreachPatch(const Repository& repo, ThreadPool& pool,
+		DiffPatchCallbackFunction callback, const DiffOptions& options, size_t maxMemory)const
+{
+	const size_t count = deltaCount();
+	const git_diff_options* opts = options.data();
+	const char* path = git_repository_path(repo.data());
+
+	// A quarter of the budget at most goes to the blob caches of the
+	// workers, the rest to the patches waiting for the callback.
+	const size_t workers = path != NULL ? pool.size() : 1;
+	const size_t cacheSize = std::min<size_t>(maxMemory / 4 / workers, 16*1024*1024);
+	const size_t patchBudget = maxMemory - workers * cacheSize;
+
+	std::vector<PendingPatch> pending(count);
+	std::mutex mutex;
+	std::condition_variable progress;
+	size_t next = 0;       // Next delta to generate.
+	size_t delivered = 0;  // Next delta to pass to the callback.
+	size_t inFlight = 0;   // Weight of the patches generated and not passed yet.
+	bool delivering = false, stop = false, interrupted = false;
+	std::mutex listMutex;  // Serializes the patches generated from the list.
+
+	// Pass the ready patches in order, unless another worker does it.
+	auto deliver = [&]()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if(delivering)
+			return;
+		delivering = true;
+		while(!stop && delivered < count && pending[delivered].ready)
+		{
+			const size_t idx = delivered;
+			PendingPatch patch = std::move(pending[idx]);
+			lock.unlock();
+			bool more;
+			try
+			{
+				more = callback(idx, patch.patch);
+			}
+			catch(...)
+			{
+				lock.lock();
+				stop = true;
+				delivering = false;
+				progress.notify_all();
+				throw;
+			}
+			const size_t weight = patch.weight;
+			patch = PendingPatch();
+			lock.lock();
+			++delivered;
+			inFlight -= weight;
+			if(!more)
+				stop = interrupted = true;
+			progress.notify_all();
+		}
+		delivering = false;
+	};
+
+	pool.run([&](unsigned int worker)
+	{
+		if(worker != 0 && path == NULL)
+			return;
+		Repository handle = worker == 0 ? repo : Repository::open(path);
+		BlobCache blobs(handle, cacheSize);
+		try
+		{
+			for(;;)
+			{
+				size_t idx;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					if(stop || next >= count)
+						break;
+					idx = next++;
+					progress.wait(lock, [&]{ return stop || idx == delivered || inFlight < patchBudget; });
+					if(stop)
+						break;
+				}
+
+				const git_diff_delta *delta = git_diff_get_delta(data(), idx);
+				PendingPatch patch;
+				git_patch *out = NULL;
+				if(has_blob(delta->old_file) && has_blob(delta->new_file)
+					&& blobs.blob(delta->old_file, patch.oldBlob) && blobs.blob(delta->new_file, patch.newBlob))
+				{
+					Exception::git2_assert(git_patch_from_blobs(&out,
+						patch.oldBlob.data(), delta->old_file.path,
+						patch.newBlob.data(), delta->new_file.path, opts));
+					patch.weight = (patch.oldBlob.ok() ? patch.oldBlob.rawSize() : 0)
+						+ (patch.newBlob.ok() ? patch.newBlob.rawSize() : 0);
+				}
+				else
+				{
+					patch.oldBlob = Blob();
+					std::lock_guard<std::mutex> lock(listMutex);
+					Exception::git2_assert(git_patch_from_diff(&out, data(), idx));
+				}
+				patch.patch = DiffPatch(out);
+				if(patch.patch.ok())
+					patch.weight += patch.patch.size();
+				patch.ready = true;
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					inFlight += patch.weight;
+					pending[idx] = std::move(patch);
+				}
+				deliver();
+			}
+		}
+		catch(...)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+			progress.notify_all();
+			throw;
+		}
+	});
+	return !interrupted;
+}
+
+DiffStats DiffList::stats(const Repository& repo)const
+{
+	DiffStats stats;
+	const size_t count = deltaCount();
+	for(size_t idx = 0; idx < count; ++idx)
+	{
+		const git_diff_delta *delta = git_diff_get_delta(data(), idx);
+		if(delta->status==GIT_DELTA_UNMODIFIED || delta->status==GIT_DELTA_IGNORED)
+			continue;
+
+		DiffFileStats file;
+		file.path = delta->status==GIT_DELTA_DELETED ? delta->old_file.path : delta->new_file.path;
+		file.additions = file.deletions = 0;
+		file.binary = (delta->flags & GIT_DIFF_FLAG_BINARY)!=0;
+
+		bool counted = file.binary;
+		if(!counted && has_blob(delta->old_file) && has_blob(delta->new_file))
+		{
+			Blob oldBlob, newBlob;
+			if(delta->old_file.mode!=0 && delta->new_file.mode!=0
+					&& git_oid_equal(&delta->old_file.id, &delta->new_file.id))
+				counted = true;
+			else if(side_blob(repo, delta->old_file, oldBlob) && side_blob(repo, delta->new_file, newBlob))
+			{
+				if(!(delta->flags & GIT_DIFF_FLAG_NOT_BINARY)
+					&& ((oldBlob.ok() && oldBlob.isBinary()) || (newBlob.ok() && newBlob.isBinary())))
+					counted = file.binary = true;
+				else
+					counted = count_lines(oldBlob, newBlob, file);
+			}
+		}
+		if(!counted)
+		{
+			DiffPatch patch = this->patch(idx);
+			if(!patch.ok() || (git_patch_get_delta(patch.data())->flags & GIT_DIFF_FLAG_BINARY))
+				file.binary = true;
+			else
+				patch.lineStats(NULL, &file.additions, &file.deletions);
+		}
+		stats.add(file);
+	}
+	return stats;
+}
+
+bool DiffList::print(DiffDataCallbackFunction callback, git_diff_format_t format)const
+{
+	DiffPayload payload(NULL, NULL, &callback);
+	return iteration_result(git_diff_print(data(), format, diff_line_cb, (void*)&payload));
+}
+
+size_t DiffList::deltaCount()const
+{
+	return git_diff_num_deltas(data());
+}
+
+size_t DiffList::deltaCount(git_delta_t type)const
+{
+	return git_diff_num_deltas_of_type(data(), type);
+}
+
+DiffDelta DiffList::delta(size_t idx)const
+{
+	const git_diff_delta *delta = git_diff_get_delta(data(), idx);
+	if(delta==NULL)
+	{
+		giterr_set_str(GITERR_INVALID, "delta index out of range");
+		throw Exception(GIT_ENOTFOUND);
+	}
+	return DiffDelta(delta);
+}
+
+DiffPatch DiffList::patch(size_t idx)const
+{
+	git_patch *patch = NULL;
+	Exception::git2_assert(git_patch_from_diff(&patch, data(), idx));
+	return DiffPatch(patch);
+}
 
 
 //
 // DiffPatch
 //
 
-// DiffPatch::DiffPatch(git_diff_patch* patch):
-// _Class(patch)
-// {
-// }
-
-// DiffPatch::DiffPatch(const DiffPatch& other):
-// _Class(other.data())
-// {
-// }
-
-
-// DiffDelta DiffPatch::delta()const
-// {
-// 	return DiffDelta(git_diff_patch_delta(data()));
-// }
-
-// size_t DiffPatch::hunkCount()const
-// {
-// 	return git_diff_patch_num_hunks(data());
-// }
-
-// void DiffPatch::lineStats(size_t *total_context, size_t *total_additions, size_t *total_deletions)const
-// {
-// 	Exception::git2_assert(git_diff_patch_line_stats(total_context, total_additions, total_deletions, data()));
-// }
-
-// bool DiffPatch::hunk(size_t idx, const git_diff_hunk **range, std::string* header, size_t *linesInHunk)
-// {
-// 	const char *buffer;
-// 	size_t len;
-
-// 	int res = git_diff_patch_get_hunk(range, header!=NULL ? &buffer : NULL, header!=NULL ? &len : NULL, linesInHunk, data(), idx);
-// 	if(res==GIT_OK)
-// 	{
-// 		if(header!=NULL)
-// 		{
-// 			header->assign(buffer, len);
-// 		}
-// 		return true;
-// 	}
-// 	else if(res==GIT_ENOTFOUND)
-// 	{
-// 		return false;
-// 	}
-// 	else
-// 	{
-// 		Exception::git2_assert(res);
-// 	}
-// }
-
-// int DiffPatch::hunkLineCount(size_t idx)
-// {
-// 	return git_diff_patch_num_lines_in_hunk(data(), idx);
-// }
-
-// void DiffPatch::hunkLine(size_t idx, size_t line, char *lineOrigin, std::string* content, int *oldLineno, int *newLineno)
-// {
-// 	const char *buffer;
-// 	size_t content_len;
-// 	Exception::git2_assert(git_diff_patch_get_line_in_hunk(lineOrigin, &buffer, &content_len, oldLineno, newLineno, data(), idx, line));
-// 	if(content!=NULL)
-// 		content->assign(buffer, content_len);
-// }
-
-// bool DiffPatch::print(DiffDataCallbackFunction callback)
-// {
-// 	auto print_cb = [](const git_diff_delta *delta, const git_diff_hunk *range, char line_origin, const char *content, size_t content_len, void *payload)->int
-// 	{
-// 		DiffDataCallbackFunction* callback = (DiffDataCallbackFunction*)payload;
-// 		if(callback!=nullptr)
-// 			return (*callback)(DiffDelta(delta), range, line_origin, std::string(content, content_len));
-// 		else
-// 			return 0;
-// 	};
-// 	int res = git_diff_patch_print(data(), print_cb, (void*)&callback);
-// 	if(res==GIT_OK)
-// 		return true;
-// 	else if(res==GIT_EUSER)
-// 		return false;
-// 	else
-// 		Exception::git2_assert(res);
-// }
+DiffPatch::DiffPatch(git_patch* patch):
+_Class(patch)
+{
+}
+
+DiffPatch::DiffPatch(const DiffPatch& other):
+_Class(other)
+{
+}
+
+DiffDelta DiffPatch::delta()const
+{
+	return DiffDelta(git_patch_get_delta(data()));
+}
+
+size_t DiffPatch::hunkCount()const
+{
+	return git_patch_num_hunks(data());
+}
+
+void DiffPatch::lineStats(size_t *totalContext, size_t *totalAdditions, size_t *totalDeletions)const
+{
+	Exception::git2_assert(git_patch_line_stats(totalContext, totalAdditions, totalDeletions, data()));
+}
+
+DiffHunk DiffPatch::hunk(size_t idx, size_t *linesInHunk)const
+{
+	const git_diff_hunk *hunk;
+	Exception::git2_assert(git_patch_get_hunk(&hunk, linesInHunk, data(), idx));
+	return DiffHunk(hunk);
+}
+
+size_t DiffPatch::hunkLineCount(size_t idx)const
+{
+	int res = git_patch_num_lines_in_hunk(data(), idx);
+	Exception::git2_assert(res < 0 ? res : GIT_OK);
+	return res;
+}
+
+DiffLine DiffPatch::line(size_t idx, size_t line)const
+{
+	const git_diff_line *out;
+	Exception::git2_assert(git_patch_get_line_in_hunk(&out, data(), idx, line));
+	return DiffLine(out);
+}
+
+size_t DiffPatch::size(bool includeContext, bool includeHunkHeaders, bool includeFileHeaders)const
+{
+	return git_patch_size(data(), includeContext, includeHunkHeaders, includeFileHeaders);
+}
+
+bool DiffPatch::foreach(DiffHunkCallbackFunction hunkCallback, DiffDataCallbackFunction lineCallback)const
+{
+	const DiffDelta delta = this->delta();
+	const size_t hunks = hunkCount();
+	for(size_t idx = 0; idx < hunks; ++idx)
+	{
+		const git_diff_hunk *hunk;
+		size_t lines;
+		Exception::git2_assert(git_patch_get_hunk(&hunk, &lines, data(), idx));
+		if(hunkCallback && !hunkCallback(delta, DiffHunk(hunk)))
+			return false;
+		if(!lineCallback)
+			continue;
+		for(size_t n = 0; n < lines; ++n)
+		{
+			const git_diff_line *line;
+			Exception::git2_assert(git_patch_get_line_in_hunk(&line, data(), idx, n));
+			if(!lineCallback(delta, DiffHunk(hunk), DiffLine(line)))
+				return false;
+		}
+	}
+	return true;
+}
+
+bool DiffPatch::print(DiffDataCallbackFunction callback)const
+{
+	DiffPayload payload(NULL, NULL, &callback);
+	return iteration_result(git_patch_print(data(), diff_line_cb, (void*)&payload));
+}
+
+//
+// BlobDiff
+//
+
+BlobDiff::BlobDiff(const DiffOptions& options, DiffFileCallbackFunction fileCallback,
+		DiffHunkCallbackFunction hunkCallback, DiffDataCallbackFunction lineCallback):
+_options(options),
+_data(_options.data()),
+_fileCallback(fileCallback),
+_hunkCallback(hunkCallback),
+_lineCallback(lineCallback)
+{
+}
+
+bool BlobDiff::diff(const Blob& oldBlob, const Blob& newBlob, const char* oldPath, const char* newPath)const
+{
+	DiffPayload payload(&_fileCallback, &_hunkCallback, &_lineCallback);
+	return iteration_result(git_diff_blobs(oldBlob.data(), oldPath, newBlob.data(), newPath, _data,
+		_fileCallback ? diff_file_cb : NULL, NULL,
+		_hunkCallback ? diff_hunk_cb : NULL,
+		_lineCallback ? diff_line_cb : NULL,
+		(void*)&payload));
+}
+
+bool BlobDiff::diff(const Blob& oldBlob, const StringView& buffer, const char* oldPath, const char* bufferPath)const
+{
+	DiffPayload payload(&_fileCallback, &_hunkCallback, &_lineCallback);
+	return iteration_result(git_diff_blob_to_buffer(oldBlob.data(), oldPath,
+		buffer.data(), buffer.size(), bufferPath, _data,
+		_fileCallback ? diff_file_cb : NULL, NULL,
+		_hunkCallback ? diff_hunk_cb : NULL,
+		_lineCallback ? diff_line_cb : NULL,
+		(void*)&payload));
+}
+
+DiffPatch BlobDiff::patch(const Blob& oldBlob, const Blob& newBlob, const char* oldPath, const char* newPath)const
+{
+	git_patch *patch;
+	Exception::git2_assert(git_patch_from_blobs(&patch, oldBlob.data(), oldPath, newBlob.data(), newPath, _data));
+	return DiffPatch(patch);
+}
+
+DiffPatch BlobDiff::patch(const Blob& oldBlob, const StringView& buffer, const char* oldPath, const char* bufferPath)const
+{
+	git_patch *patch;
+	Exception::git2_assert(git_patch_from_blob_and_buffer(&patch, oldBlob.data(), oldPath,
+		buffer.data(), buffer.size(), bufferPath, _data));
+	return DiffPatch(patch);
+}
 
 } // namespace git2
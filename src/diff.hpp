@@ -23,19 +23,29 @@
 #include <git2.h>
 
 #include <functional>
+#include <iterator>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "common.hpp"
 
 #include "oid.hpp"
+#include "stringview.hpp"
 
 namespace git2
 {
 
+class Blob;
 class DiffFile;
 class DiffDelta;
+class DiffHunk;
+class DiffLine;
 class DiffList;
 class DiffPatch;
+class Repository;
+class SimilarityCache;
+class ThreadPool;
 
 
 
@@ -52,11 +62,10 @@ class DiffPatch;
  * - returns 0, the delta is inserted into the diff list, and the diff process
  *		continues.
  *
- * @param list List to which the delta will be inserted
  * @param delta Delta to insert in the list
- * @param matchedPathspec Path spec
+ * @param matchedPathspec Path spec the delta matched, empty if none
  */
-typedef std::function<int(const DiffList& list, const DiffDelta& delta, const std::string& matchedPathspec)> DiffNotifyCallbackFunction;
+typedef std::function<int(const DiffDelta& delta, const std::string& matchedPathspec)> DiffNotifyCallbackFunction;
 
 /**
  * When iterating over a diff, callback that will be made per file.
@@ -69,21 +78,111 @@ typedef std::function<bool(const DiffDelta& delta, float progress)> DiffFileCall
 
 /**
  * When iterating over a diff, callback that will be made per hunk.
+ *
+ * @param delta Delta data for the file
+ * @param hunk Hunk, only valid during the call
+ * @return true to continue iteration, false to stop iteration
  */
-typedef std::function<bool(const DiffDelta& delta, const git_diff_hunk *range, const std::string& header)> DiffHunkCallbackFunction;
-
+typedef std::function<bool(const DiffDelta& delta, const DiffHunk& hunk)> DiffHunkCallbackFunction;
 
 /**
  * When iterating over a diff, callback that will be made per text diff
- * line. In this context, the provided range will be NULL.
+ * line.
  *
  * When printing a diff, callback that will be made to output each line
  * of text.  This uses some extra GIT_DIFF_LINE_... constants for output
- * of lines of file and hunk headers.
+ * of lines of file and hunk headers, the hunk is then invalid.
+ *
+ * @param delta Delta data for the file
+ * @param hunk Hunk of the line, only valid during the call
+ * @param line Line, only valid during the call
+ * @return true to continue iteration, false to stop iteration
+ */
+typedef std::function<bool(const DiffDelta& delta, const DiffHunk& hunk, const DiffLine& line)> DiffDataCallbackFunction;
+
+/**
+ * Callback selecting the deltas of a diff list to generate the text diff of.
+ *
+ * @param index Index of the delta in the list
+ * @param delta Delta data for the file
+ * @return true to generate the text diff of the file
+ */
+typedef std::function<bool(size_t index, const DiffDelta& delta)> DiffSelectCallbackFunction;
+
+/**
+ * Added and deleted line counts of a file, like a line of
+ * `git diff --numstat`.
+ */
+struct DiffFileStats
+{
+	std::string path; //!< New path, or old path of a deleted file.
+	size_t additions; //!< Number of added lines.
+	size_t deletions; //!< Number of deleted lines.
+	bool binary;      //!< Whether the file is binary, without line counts.
+};
+
+/**
+ * Line counts of the files of a diff and their totals, like
+ * `git diff --numstat` and `git diff --shortstat`.
+ */
+class DiffStats
+{
+public:
+	DiffStats();
+
+	/**
+	 * Add the counts of a file.
+	 */
+	void add(const DiffFileStats& file);
+
+	size_t fileCount()const{return _files.size();}
+	const DiffFileStats& file(size_t idx)const{return _files[idx];}
+	const std::vector<DiffFileStats>& files()const{return _files;}
+
+	/**
+	 * Total number of added lines.
+	 */
+	size_t additions()const{return _additions;}
+
+	/**
+	 * Total number of deleted lines.
+	 */
+	size_t deletions()const{return _deletions;}
+
+private:
+	std::vector<DiffFileStats> _files;
+	size_t _additions;
+	size_t _deletions;
+};
+
+/**
+ * Rename or copy of a file found by DiffList::findRenames().
  */
-typedef std::function<bool(const DiffDelta& delta, const git_diff_hunk *hunk, char line_origin,const std::string& content)> DiffDataCallbackFunction;
+struct DiffRename
+{
+	size_t oldIndex;     //!< Index of the delta of the source file.
+	size_t newIndex;     //!< Index of the added delta of the target file.
+	uint16_t similarity; //!< Similarity of the contents, from 0 to 100.
+	bool copy;           //!< Whether the source file is kept, rather than renamed.
+};
 
+/**
+ * Callback receiving the line counts of a commit.
+ *
+ * @param commit Id of the commit
+ * @param stats Line counts of the commit against its first parent
+ * @return true to continue iteration, false to stop iteration
+ */
+typedef std::function<bool(const OId& commit, const DiffStats& stats)> DiffStatsCallbackFunction;
 
+/**
+ * Callback receiving the patch of a delta of a diff list.
+ *
+ * @param index Index of the delta in the list
+ * @param patch Patch of the delta, only valid during the call
+ * @return true to continue iteration, false to stop iteration
+ */
+typedef std::function<bool(size_t index, const DiffPatch& patch)> DiffPatchCallbackFunction;
 
 
 
@@ -116,11 +215,6 @@ public:
      */
     DiffFile(const git_diff_file *diff_file = NULL);
 
-    /**
-     * Copy constructor
-     */
-    DiffFile(const DiffFile& other);
-
 	OId oid()const{return _oid;}
 	const std::string& path()const{return _path;}
 	size_t size()const{return _size;}
@@ -181,11 +275,6 @@ public:
      */
     DiffDelta(const git_diff_delta *diff_delta = NULL);
 
-    /**
-     * Copy constructor
-     */
-    DiffDelta(const DiffDelta& other);
-
 	DiffFile oldFile()const{return _old;}
 	DiffFile newFile()const{return _new;}
 	git_delta_t status()const{return _status;}
@@ -200,128 +289,459 @@ protected:
 	uint32_t    _flags;
 };
 
-// /**
-//  * The diff list object that contains all individual file deltas.
-//  */
-// class DiffList : public helper::Git2PtrWrapper<git_diff_list, git_diff_list_free>
-// {
-// public:
-// 	DiffList(git_diff_list*);
-// 	DiffList(const DiffList& other);
-
-// 	/**
-// 	 * Merge one diff list into another.
-// 	 *
-// 	 * This merges items from the "from" list into the "this" list.  The
-// 	 * resulting diff list will have all items that appear in either list.
-// 	 * If an item appears in both lists, then it will be "merged" to appear
-// 	 * as if the old version was from the "onto" list and the new version
-// 	 * is from the "from" list (with the exception that if the item has a
-// 	 * pending DELETE in the middle, then it will show as deleted).
-// 	 */
-// 	void merge(const DiffList& from);
-
-// 	/**
-// 	 * Transform a diff list marking file renames, copies, etc.
-// 	 *
-// 	 * This modifies a diff list in place, replacing old entries that look
-// 	 * like renames or copies with new entries reflecting those changes.
-// 	 * This also will, if requested, break modified files into add/remove
-// 	 * pairs if the amount of change is above a threshold.
-// 	 *
-// 	 * @param flags Combination of git_diff_find_t values (default FIND_RENAMES)
-// 	 * @param renameThreshold Similarity to consider a file renamed (default 50)
-// 	 * @param renameFromRewriteThreshold Similarity of modified to be eligible rename source (default 50)
-// 	 * @param copyThreshold Similarity to consider a file a copy (default 50)
-// 	 * @param breakRewriteThreshold Similarity to split modify into delete/add pair (default 60)
-// 	 * @param renameLimit Maximum similarity sources to examine for a file (somewhat like
-// 	 *  git-diff's `-l` option or `diff.renameLimit` config) (default 200)
-// 	 *
-// 	 * TODO add git_diff_similarity_metric *metric
-// 	 */
-// 	bool findSimilar();
-// 	bool findSimilar(uint32_t flags, uint16_t renameThreshold=50,
-// 			uint16_t renameFromRewriteThreshold = 50, uint16_t copyThreshold = 50,
-// 			uint16_t breakRewriteThreshold = 60, size_t renameLimit = 200);
-
-// 	/**
-// 	 * Loop over all deltas in a diff list issuing callbacks.
-// 	 *
-// 	 * This will iterate through all of the files described in a diff.  You
-// 	 * should provide a file callback to learn about each file.
-// 	 *
-// 	 * The "hunk" and "line" callbacks are optional, and the text diff of the
-// 	 * files will only be calculated if they are not NULL.  Of course, these
-// 	 * callbacks will not be invoked for binary files on the diff list or for
-// 	 * files whose only changed is a file mode change.
-// 	 *
-// 	 * @param fileCallback Callback function to make per file in the diff.
-// 	 * @param hunkCallback Optional callback to make per hunk of text diff.  This
-// 	 *                callback is called to describe a range of lines in the
-// 	 *                diff.  It will not be issued for binary files.
-// 	 * @param lineCallback Optional callback to make per line of diff text.  This
-// 	 *                same callback will be made for context lines, added, and
-// 	 *                removed lines, and even for a deleted trailing newline.
-// 	 * @return true if completly terminated and false if user terminated.
-// 	 */
-// 	bool foreach(DiffFileCallbackFunction fileCallback, DiffHunkCallbackFunction hunkCallback,
-// 		DiffDataCallbackFunction lineCallback);
-
-// 	/**
-// 	 * Iterate over a diff generating text output like "git diff --name-status".
-// 	 *
-// 	 * @return true if completly terminated and false if user terminated.
-// 	 */
-// 	bool printCompact(DiffDataCallbackFunction printCallback);
-
-// 	/**
-// 	 * Iterate over a diff generating text output like "git diff --raw".
-// 	 *
-// 	 * @return true if completly terminated and false if user terminated.
-// 	 */
-// 	bool printRaw(DiffDataCallbackFunction printCallback);
-
-// 	/**
-// 	 * Iterate over a diff generating text output like "git diff".
-// 	 *
-// 	 * This is a super easy way to generate a patch from a diff.
-// 	 *
-// 	 * @return true if completly terminated and false if user terminated.
-// 	 */
-// 	bool printPatch(DiffDataCallbackFunction printCallback);
-
-// 	/**
-// 	 * Query how many diff records are there in a diff list.
-// 	 *
-// 	 * @return Count of number of deltas in the list
-// 	 */
-// 	size_t deltaCount()const;
-
-// 	/**
-// 	 * Query how many diff deltas are there in a diff list filtered by type.
-// 	 *
-// 	 * @param type A git_delta_t value to filter the count
-// 	 * @return Count of number of deltas matching delta_t type
-// 	 */
-// 	size_t deltaCount(git_delta_t type)const;
-
-// 	/**
-// 	 * Return the diff patch for an entry in the diff list.
-// 	 *
-// 	 * @param idx Index into diff list
-// 	 * @return delta patch object
-// 	 */
-// 	DiffPatch patch(size_t idx);
-
-// 	/**
-// 	 * Return the diff delta for an entry in the diff list.
-// 	 *
-// 	 * @param idx Index into diff list
-// 	 * @return delta patch object
-// 	 */
-// 	DiffDelta delta(size_t idx);
-
-// };
+/**
+ * Options of a diff.
+ *
+ * The defaults are the ones of libgit2 (GIT_DIFF_OPTIONS_INIT), with the
+ * "a" and "b" prefixes.
+ */
+class DiffOptions
+{
+public:
+	/**
+	 * Create diff options.
+	 *
+	 * @param flags Combination of git_diff_option_t values.
+	 */
+	explicit DiffOptions(uint32_t flags = GIT_DIFF_NORMAL);
+
+	/**
+	 * Combination of git_diff_option_t values.
+	 */
+	uint32_t flags()const{return _flags;}
+	void setFlags(uint32_t flags);
+
+	/**
+	 * Number of unchanged lines around the changes (default 3).
+	 */
+	uint16_t contextLines()const{return _contextLines;}
+	void setContextLines(uint16_t lines);
+
+	/**
+	 * Maximum number of unchanged lines between two hunks before they are
+	 * merged (default 0).
+	 */
+	uint16_t interhunkLines()const{return _interhunkLines;}
+	void setInterhunkLines(uint16_t lines);
+
+	/**
+	 * Prefixes of the old and new paths in patch headers.
+	 */
+	const std::string& oldPrefix()const{return _oldPrefix;}
+	void setOldPrefix(const std::string& prefix);
+	const std::string& newPrefix()const{return _newPrefix;}
+	void setNewPrefix(const std::string& prefix);
+
+	/**
+	 * Paths or fnmatch patterns to restrict the diff to.
+	 */
+	const std::vector<std::string>& pathspec()const{return _pathspec;}
+	void setPathspec(const std::vector<std::string>& pathspec);
+
+	/**
+	 * Size in bytes above which a blob is considered binary (default 512MB).
+	 */
+	git_off_t maxSize()const{return _maxSize;}
+	void setMaxSize(git_off_t size);
+
+	/**
+	 * Callback filtering the deltas as they are added to the list.
+	 */
+	const DiffNotifyCallbackFunction& notify()const{return _notify;}
+	void setNotify(DiffNotifyCallbackFunction notify);
+
+	/**
+	 * libgit2 options, valid until the options are changed or destroyed.
+	 */
+	const git_diff_options* data()const;
+
+private:
+	uint32_t _flags;
+	uint16_t _contextLines;
+	uint16_t _interhunkLines;
+	std::string _oldPrefix;
+	std::string _newPrefix;
+	std::vector<std::string> _pathspec;
+	git_off_t _maxSize;
+	DiffNotifyCallbackFunction _notify;
+
+	mutable git_diff_options _options;
+	mutable std::vector<char*> _paths;
+};
+
+/**
+ * Range of changed lines of a text diff, with its "@@ -1,3 +1,4 @@"
+ * header.
+ *
+ * A hunk refers to libgit2 data: it is only valid during the callback it
+ * is passed to, or as long as the patch it comes from.
+ */
+class DiffHunk
+{
+public:
+	DiffHunk(const git_diff_hunk *hunk = NULL):_hunk(hunk){}
+
+	/**
+	 * Whether there is a hunk, i.e. false for file header lines.
+	 */
+	bool ok()const{return _hunk!=NULL;}
+
+	int oldStart()const{return _hunk->old_start;}
+	int oldLines()const{return _hunk->old_lines;}
+	int newStart()const{return _hunk->new_start;}
+	int newLines()const{return _hunk->new_lines;}
+	StringView header()const{return StringView(_hunk->header, _hunk->header_len);}
+
+	const git_diff_hunk* data()const{return _hunk;}
+
+private:
+	const git_diff_hunk* _hunk;
+};
+
+/**
+ * Line of a text diff.
+ *
+ * Like hunks, lines refer to libgit2 data and their content is not
+ * copied.
+ */
+class DiffLine
+{
+public:
+	DiffLine(const git_diff_line *line):_line(line){}
+
+	/**
+	 * A git_diff_line_t value.
+	 */
+	char origin()const{return _line->origin;}
+
+	/**
+	 * Line number in the old file, or -1 for an added line.
+	 */
+	int oldLineno()const{return _line->old_lineno;}
+
+	/**
+	 * Line number in the new file, or -1 for a deleted line.
+	 */
+	int newLineno()const{return _line->new_lineno;}
+
+	/**
+	 * Number of newline characters in the content.
+	 */
+	int lineCount()const{return _line->num_lines;}
+
+	/**
+	 * Offset of the content in the file, or -1 for lines not in a file.
+	 */
+	git_off_t contentOffset()const{return _line->content_offset;}
+
+	/**
+	 * Content of the line, with its newline if any; not NUL-terminated.
+	 */
+	StringView content()const{return StringView(_line->content, _line->content_len);}
+
+	const git_diff_line* data()const{return _line;}
+
+private:
+	const git_diff_line* _line;
+};
+
+/**
+ * The diff list object that contains all individual file deltas.
+ *
+ * A list only describes the changed files: text diffs are generated when
+ * they are iterated, one file at a time, or per file with patch().
+ */
+class DiffList : public helper::Git2PtrWrapper<git_diff, git_diff_free>
+{
+public:
+	explicit DiffList(git_diff *diff = NULL);
+	DiffList(const DiffList& other);
+	DiffList(DiffList&& other) = default;
+	DiffList& operator=(const DiffList& other) = default;
+	DiffList& operator=(DiffList&& other) = default;
+
+	/**
+	 * Merge one diff list into another.
+	 *
+	 * This merges items from the "from" list into the "this" list.  The
+	 * resulting diff list will have all items that appear in either list.
+	 * If an item appears in both lists, then it will be "merged" to appear
+	 * as if the old version was from the "onto" list and the new version
+	 * is from the "from" list (with the exception that if the item has a
+	 * pending DELETE in the middle, then it will show as deleted).
+	 *
+	 * @throws Exception
+	 */
+	void merge(const DiffList& from);
+
+	/**
+	 * Transform a diff list marking file renames, copies, etc.
+	 *
+	 * This modifies a diff list in place, replacing old entries that look
+	 * like renames or copies with new entries reflecting those changes.
+	 * This also will, if requested, break modified files into add/remove
+	 * pairs if the amount of change is above a threshold.
+	 *
+	 * @param flags Combination of git_diff_find_t values (default FIND_RENAMES)
+	 * @param renameThreshold Similarity to consider a file renamed (default 50)
+	 * @param renameFromRewriteThreshold Similarity of modified to be eligible rename source (default 50)
+	 * @param copyThreshold Similarity to consider a file a copy (default 50)
+	 * @param breakRewriteThreshold Similarity to split modify into delete/add pair (default 60)
+	 * @param renameLimit Maximum similarity sources to examine for a file (somewhat like
+	 *  git-diff's `-l` option or `diff.renameLimit` config) (default 200)
+	 * @throws Exception
+	 */
+	void findSimilar();
+	void findSimilar(uint32_t flags, uint16_t renameThreshold = 50,
+			uint16_t renameFromRewriteThreshold = 50, uint16_t copyThreshold = 50,
+			uint16_t breakRewriteThreshold = 60, size_t renameLimit = 200);
+
+	/**
+	 * Transform a diff list marking file renames, copies, etc, comparing
+	 * the files with the signatures of a cache.
+	 *
+	 * Signatures of blobs already in the cache are not computed again,
+	 * and the signatures computed are added to it.
+	 *
+	 * @param cache Signatures of the blobs.
+	 * @throws Exception
+	 * @see findSimilar(uint32_t, uint16_t, uint16_t, uint16_t, uint16_t, size_t)
+	 */
+	void findSimilar(SimilarityCache& cache, uint32_t flags, uint16_t renameThreshold = 50,
+			uint16_t renameFromRewriteThreshold = 50, uint16_t copyThreshold = 50,
+			uint16_t breakRewriteThreshold = 60, size_t renameLimit = 200);
+
+	/**
+	 * Find the renamed and copied files of a diff list on a pool of
+	 * threads, without any limit on the number of files.
+	 *
+	 * Added files are the targets. Deleted files are the sources of
+	 * renames, and also of copies with GIT_DIFF_FIND_COPIES, like the
+	 * modified files, and the unmodified files included in the list with
+	 * GIT_DIFF_FIND_COPIES_FROM_UNMODIFIED. Files are compared on their
+	 * blobs: working directory files without blob id, submodules and
+	 * empty files are not considered.
+	 *
+	 * Files with the same blob id are paired first, preferring sources
+	 * with the same file name. The signatures of the other files are then
+	 * taken from the cache or computed by the workers, and each target is
+	 * only compared with the few sources sharing the most hashes of their
+	 * signature sketch, hashes shared by too many sources being ignored.
+	 * Pairs are finally chosen by decreasing similarity, a source being
+	 * renamed once at most.
+	 *
+	 * The list itself is not modified.
+	 *
+	 * @param repo Repository the list was created from.
+	 * @param pool Workers to compute the signatures and compare the files with.
+	 * @param cache Signatures of the blobs.
+	 * @param flags Combination of GIT_DIFF_FIND_RENAMES, GIT_DIFF_FIND_COPIES,
+	 * GIT_DIFF_FIND_COPIES_FROM_UNMODIFIED and GIT_DIFF_FIND_EXACT_MATCH_ONLY.
+	 * @param renameThreshold Similarity to consider a file renamed.
+	 * @param copyThreshold Similarity to consider a file a copy.
+	 * @return Renames and copies, by increasing target index.
+	 * @throws Exception
+	 */
+	std::vector<DiffRename> findRenames(const Repository& repo, ThreadPool& pool,
+		SimilarityCache& cache, uint32_t flags = GIT_DIFF_FIND_RENAMES,
+		uint16_t renameThreshold = 50, uint16_t copyThreshold = 50)const;
+
+	/**
+	 * Loop over all deltas in a diff list issuing callbacks.
+	 *
+	 * This will iterate through all of the files described in a diff.  You
+	 * should provide a file callback to learn about each file.
+	 *
+	 * The "hunk" and "line" callbacks are optional, and the text diff of the
+	 * files will only be calculated if they are given.  Of course, these
+	 * callbacks will not be invoked for binary files on the diff list or for
+	 * files whose only changed is a file mode change.
+	 *
+	 * Lines are streamed from the file contents, a single file is diffed at
+	 * a time.
+	 *
+	 * @param fileCallback Callback function to make per file in the diff.
+	 * @param hunkCallback Optional callback to make per hunk of text diff.  This
+	 *                callback is called to describe a range of lines in the
+	 *                diff.  It will not be issued for binary files.
+	 * @param lineCallback Optional callback to make per line of diff text.  This
+	 *                same callback will be made for context lines, added, and
+	 *                removed lines, and even for a deleted trailing newline.
+	 * @return true if completly terminated and false if user terminated.
+	 * @throws Exception
+	 */
+	bool foreach(DiffFileCallbackFunction fileCallback,
+		DiffHunkCallbackFunction hunkCallback = DiffHunkCallbackFunction(),
+		DiffDataCallbackFunction lineCallback = DiffDataCallbackFunction())const;
+
+	/**
+	 * Loop over the text diff of some deltas only.
+	 *
+	 * The text diff is only generated for the deltas the select callback
+	 * accepts, one file at a time.
+	 *
+	 * @param selectCallback Callback choosing the deltas to diff.
+	 * @param hunkCallback Optional callback to make per hunk of text diff.
+	 * @param lineCallback Optional callback to make per line of diff text.
+	 * @return true if completly terminated and false if user terminated.
+	 * @throws Exception
+	 */
+	bool foreachPatch(DiffSelectCallbackFunction selectCallback,
+		DiffHunkCallbackFunction hunkCallback,
+		DiffDataCallbackFunction lineCallback = DiffDataCallbackFunction())const;
+
+	/**
+	 * Generate the patches of all the deltas on a pool of threads.
+	 *
+	 * The delta list is only read: each worker but the calling thread opens
+	 * its own handle of the repository, keeps its own cache of recently
+	 * loaded blobs, and diffs the blobs of the deltas (as
+	 * git_patch_from_blobs). Deltas with a side that is not in the object
+	 * database, e.g. modified working directory files, and submodules are
+	 * diffed from the list itself, one at a time.
+	 *
+	 * The patches are passed to the callback in the order of the deltas,
+	 * one call at a time but from any worker. The deltas of the patches
+	 * do not carry rename or copy information: use delta(index) for it.
+	 *
+	 * A quarter of maxMemory at most, and 16MB per worker at most, is
+	 * shared between the blob caches of the workers. Workers do not start
+	 * a new patch while the patches waiting for their turn, and the blobs
+	 * they hold, weigh more than the rest of maxMemory, except the one to
+	 * be passed next. The memory in flight is thus bounded by maxMemory
+	 * plus one patch per worker.
+	 *
+	 * @param repo Repository the list was created from.
+	 * @param pool Workers to generate the patches with.
+	 * @param callback Callback receiving the patches.
+	 * @param options Text diff options, like context lines. The options
+	 * selecting deltas (pathspec, notify) and the flags already applied to
+	 * the list (like GIT_DIFF_REVERSE) should not be given again.
+	 * @param maxMemory Budget of the blob caches and of the patches waiting
+	 * for the callback.
+	 * @return true if completly terminated and false if user terminated.
+	 * @throws Exception
+	 */
+	bool foreachPatch(const Repository& repo, ThreadPool& pool,
+		DiffPatchCallbackFunction callback, const DiffOptions& options = DiffOptions(),
+		size_t maxMemory = 64*1024*1024)const;
+
+	/**
+	 * Count the added and deleted lines of each file, without generating
+	 * any patch text.
+	 *
+	 * The lines of both blobs of a file are split and hashed in one pass,
+	 * and the counts are those of a minimal diff of the lines, computed
+	 * on the lines present in both files only, which is what git reports
+	 * for all but heavily edited files.
+	 *
+	 * Files whose blob is binary are reported as such without reading
+	 * further. Deltas without blob ids (working directory files,
+	 * submodules) and heavily edited files are counted from their patch.
+	 *
+	 * Whitespace options of the list are not applied to the counts.
+	 *
+	 * @param repo Repository the list was created from.
+	 * @return Line counts of the files.
+	 * @throws Exception
+	 */
+	DiffStats stats(const Repository& repo)const;
+
+	/**
+	 * Iterate over a diff generating formatted text output.
+	 *
+	 * @param callback Callback called for each line of output.
+	 * @param format Output format, like "git diff" for GIT_DIFF_FORMAT_PATCH
+	 * or "git diff --name-status" for GIT_DIFF_FORMAT_NAME_STATUS.
+	 * @return true if completly terminated and false if user terminated.
+	 * @throws Exception
+	 */
+	bool print(DiffDataCallbackFunction callback, git_diff_format_t format = GIT_DIFF_FORMAT_PATCH)const;
+
+	/**
+	 * Query how many diff records are there in a diff list.
+	 *
+	 * @return Count of number of deltas in the list
+	 */
+	size_t deltaCount()const;
+
+	/**
+	 * Query how many diff deltas are there in a diff list filtered by type.
+	 *
+	 * @param type A git_delta_t value to filter the count
+	 * @return Count of number of deltas matching delta_t type
+	 */
+	size_t deltaCount(git_delta_t type)const;
+
+	/**
+	 * Return the diff delta for an entry in the diff list.
+	 *
+	 * @param idx Index into diff list
+	 * @return delta object
+	 * @throws Exception GIT_ENOTFOUND if the index is out of range.
+	 */
+	DiffDelta delta(size_t idx)const;
+
+	/**
+	 * Generate the text diff of an entry in the diff list.
+	 *
+	 * @param idx Index into diff list
+	 * @return Patch of the entry, empty (not ok()) for an unchanged or
+	 * binary file.
+	 * @throws Exception
+	 */
+	DiffPatch patch(size_t idx)const;
+
+	/**
+	 * Random access to the deltas of a diff list, e.g. in a range-for:
+	 * @code
+	 * for(const DiffDelta& delta : list) ...
+	 * @endcode
+	 */
+	class iterator
+	{
+	public:
+		typedef std::random_access_iterator_tag iterator_category;
+		typedef DiffDelta value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const DiffDelta* pointer;
+		typedef DiffDelta reference;
+
+		iterator():_diff(nullptr),_idx(0){}
+		iterator(const git_diff* diff, size_t idx):_diff(diff),_idx(idx){}
+
+		/**
+		 * Index of the delta, e.g. for DiffList::patch().
+		 */
+		size_t index() const {return _idx;}
+
+		DiffDelta operator*() const {return DiffDelta(git_diff_get_delta(_diff, _idx));}
+		DiffDelta operator[](difference_type n) const {return *(*this + n);}
+		iterator& operator++() {++_idx; return *this;}
+		iterator operator++(int) {iterator it(*this); ++_idx; return it;}
+		iterator& operator--() {--_idx; return *this;}
+		iterator operator--(int) {iterator it(*this); --_idx; return it;}
+		iterator& operator+=(difference_type n) {_idx += n; return *this;}
+		iterator& operator-=(difference_type n) {_idx -= n; return *this;}
+		iterator operator+(difference_type n) const {return iterator(_diff, _idx + n);}
+		iterator operator-(difference_type n) const {return iterator(_diff, _idx - n);}
+		difference_type operator-(const iterator& other) const {return difference_type(_idx) - difference_type(other._idx);}
+
+		bool operator==(const iterator& other) const {return _idx==other._idx;}
+		bool operator!=(const iterator& other) const {return _idx!=other._idx;}
+		bool operator<(const iterator& other) const {return _idx<other._idx;}
+		bool operator>(const iterator& other) const {return _idx>other._idx;}
+		bool operator<=(const iterator& other) const {return _idx<=other._idx;}
+		bool operator>=(const iterator& other) const {return _idx>=other._idx;}
+
+	private:
+		const git_diff* _diff;
+		size_t _idx;
+	};
+
+	iterator begin() const {return iterator(data(), 0);}
+	iterator end() const {return iterator(data(), ok() ? deltaCount() : 0);}
+};
 
 /**
  * The diff patch is used to store all the text diffs for a delta.
@@ -329,90 +749,186 @@ protected:
  * You can easily loop over the content of patches and get information about
  * them.
  */
-// class DiffPatch : public helper::Git2PtrWrapper<git_diff_patch, git_diff_patch_free>
-// {
-// public:
-// 	DiffPatch(git_diff_patch* patch);
-// 	DiffPatch(const DiffPatch& other);
-
-// 	/**
-// 	 * Get the delta associated with a patch
-// 	 */
-// 	DiffDelta delta()const;
-
-// 	/**
-// 	 * Get the number of hunks in a patch
-// 	 */
-// 	size_t hunkCount()const;
-
-//     /**
-// 	 * Get line counts of each type in a patch.
-// 	 *
-// 	 * This helps imitate a diff --numstat type of output.  For that purpose,
-// 	 * you only need the `total_additions` and `total_deletions` values, but we
-// 	 * include the `total_context` line count in case you want the total number
-// 	 * of lines of diff output that will be generated.
-// 	 *
-// 	 * All outputs are optional. Pass NULL if you don't need a particular count.
-// 	 *
-// 	 * @param totalContext Count of context lines in output, can be NULL.
-// 	 * @param totalAdditions Count of addition lines in output, can be NULL.
-// 	 * @param totalDeletions Count of deletion lines in output, can be NULL.
-// 	 */
-// 	void lineStats(size_t *total_context, size_t *total_additions, size_t *total_deletions)const;
-
-// 	/**
-// 	 * Get the information about a hunk in a patch
-// 	 *
-// 	 * Given a patch and a hunk index into the patch, this returns detailed
-// 	 * information about that hunk.  Any of the output pointers can be passed
-// 	 * as NULL if you don't care about that particular piece of information.
-// 	 *
-// 	 * @param idx Input index of hunk to get information about
-// 	 * @param range Output pointer to git_diff_hunk of hunk
-// 	 * @param header Output pointer to header string for hunk.
-// 	 * @param linesInHunk Output count of total lines in this hunk
-// 	 * @param idx Input index of hunk to get information about
-// 	 * @return True if found, false if index is out of range.
-// 	 */
-// 	bool hunk(size_t idx, const git_diff_hunk **range = NULL, std::string* header = NULL, size_t *linesInHunk = NULL);
-
-// 	/**
-// 	 * Get the number of lines in a hunk.
-// 	 *
-// 	 * @param idx Index of the hunk
-// 	 * @return Number of lines in hunk or -1 if invalid hunk index
-// 	 */
-// 	int hunkLineCount(size_t idx);
-
-// 	/**
-// 	 * Get data about a line in a hunk of a patch.
-// 	 *
-// 	 * Given a patch, a hunk index, and a line index in the hunk, this
-// 	 * will return a lot of details about that line.  If you pass a hunk
-// 	 * index larger than the number of hunks or a line index larger than
-// 	 * the number of lines in the hunk, this will return -1.
-// 	 *
-// 	 * @param idx The index of the hunk
-// 	 * @param line The index of the line in the hunk
-// 	 * @param[out] lineOrigin A GIT_DIFF_LINE constant from above
-// 	 * @param[out] content Content of diff line
-// 	 * @param[out] oldLineno Line number in old file or -1 if line is added
-// 	 * @param[out] newLineno Line number in new file or -1 if line is deleted
-// 	 */
-// 	void hunkLine(size_t idx, size_t line, char *lineOrigin, std::string* content, int *oldLineno, int *newLineno);
-
-// 	/**
-// 	 * Serialize the patch to text via callback.
-// 	 * @return true if iterating completly, and false if terminated by user.
-// 	 */
-// 	bool print(DiffDataCallbackFunction callback);
-
-// };
-
-
-// TODO wrap git_diff_similarity_metric
-// TODO wrap misc functions git_diff_blobs git_diff_patch_from_blobs git_diff_blob_to_buffer git_diff_patch_from_blob_and_buffer
+class DiffPatch : public helper::Git2PtrWrapper<git_patch, git_patch_free>
+{
+public:
+	explicit DiffPatch(git_patch* patch = NULL);
+	DiffPatch(const DiffPatch& other);
+	DiffPatch(DiffPatch&& other) = default;
+	DiffPatch& operator=(const DiffPatch& other) = default;
+	DiffPatch& operator=(DiffPatch&& other) = default;
+
+	/**
+	 * Get the delta associated with a patch
+	 */
+	DiffDelta delta()const;
+
+	/**
+	 * Get the number of hunks in a patch
+	 */
+	size_t hunkCount()const;
+
+	/**
+	 * Get line counts of each type in a patch.
+	 *
+	 * This helps imitate a diff --numstat type of output.  For that purpose,
+	 * you only need the `total_additions` and `total_deletions` values, but we
+	 * include the `total_context` line count in case you want the total number
+	 * of lines of diff output that will be generated.
+	 *
+	 * All outputs are optional. Pass NULL if you don't need a particular count.
+	 *
+	 * @param totalContext Count of context lines in output, can be NULL.
+	 * @param totalAdditions Count of addition lines in output, can be NULL.
+	 * @param totalDeletions Count of deletion lines in output, can be NULL.
+	 * @throws Exception
+	 */
+	void lineStats(size_t *totalContext, size_t *totalAdditions, size_t *totalDeletions)const;
+
+	/**
+	 * Get the information about a hunk in a patch
+	 *
+	 * @param idx Index of the hunk
+	 * @param linesInHunk Output count of total lines in this hunk, can be NULL.
+	 * @return Hunk, valid as long as the patch.
+	 * @throws Exception GIT_ENOTFOUND if the index is out of range.
+	 */
+	DiffHunk hunk(size_t idx, size_t *linesInHunk = NULL)const;
+
+	/**
+	 * Get the number of lines in a hunk.
+	 *
+	 * @param idx Index of the hunk
+	 * @return Number of lines in hunk
+	 * @throws Exception GIT_ENOTFOUND if the index is out of range.
+	 */
+	size_t hunkLineCount(size_t idx)const;
+
+	/**
+	 * Get data about a line in a hunk of a patch.
+	 *
+	 * @param idx The index of the hunk
+	 * @param line The index of the line in the hunk
+	 * @return Line, valid as long as the patch.
+	 * @throws Exception GIT_ENOTFOUND if an index is out of range.
+	 */
+	DiffLine line(size_t idx, size_t line)const;
+
+	/**
+	 * Size of the text of the patch, as print() would output it.
+	 *
+	 * @param includeContext Count the context lines.
+	 * @param includeHunkHeaders Count the hunk headers.
+	 * @param includeFileHeaders Count the file headers.
+	 */
+	size_t size(bool includeContext = true, bool includeHunkHeaders = true,
+		bool includeFileHeaders = true)const;
+
+	/**
+	 * Loop over the hunks and lines of the patch.
+	 *
+	 * @param hunkCallback Optional callback to make per hunk.
+	 * @param lineCallback Optional callback to make per line.
+	 * @return true if completly terminated and false if user terminated.
+	 */
+	bool foreach(DiffHunkCallbackFunction hunkCallback,
+		DiffDataCallbackFunction lineCallback = DiffDataCallbackFunction())const;
+
+	/**
+	 * Serialize the patch to text via callback.
+	 * @return true if iterating completly, and false if terminated by user.
+	 * @throws Exception
+	 */
+	bool print(DiffDataCallbackFunction callback)const;
+};
+
+
+/**
+ * Context to diff blobs with other blobs or with buffers, without a diff
+ * list.
+ *
+ * The options and the callbacks are converted once, when the context is
+ * created, and used by all its diffs. Buffers are passed to libgit2 as
+ * they are, without any copy.
+ *
+ * A context must not be used by several threads at once.
+ */
+class BlobDiff
+{
+public:
+	/**
+	 * Create a context.
+	 *
+	 * @param options Options of the diffs; pathspec and notify callback
+	 * are not used.
+	 * @param fileCallback Optional callback to make per diffed file.
+	 * @param hunkCallback Optional callback to make per hunk of text diff.
+	 * @param lineCallback Optional callback to make per line of diff text.
+	 */
+	explicit BlobDiff(const DiffOptions& options = DiffOptions(),
+		DiffFileCallbackFunction fileCallback = DiffFileCallbackFunction(),
+		DiffHunkCallbackFunction hunkCallback = DiffHunkCallbackFunction(),
+		DiffDataCallbackFunction lineCallback = DiffDataCallbackFunction());
+
+	BlobDiff(const BlobDiff&) = delete;
+	BlobDiff& operator=(const BlobDiff&) = delete;
+
+	/**
+	 * Diff two blobs, passing the result to the callbacks.
+	 *
+	 * A null blob is diffed as an absent file, so diffing it with a blob
+	 * shows the blob as added or deleted.
+	 *
+	 * @param oldBlob Blob to diff from, can be null.
+	 * @param newBlob Blob to diff to, can be null.
+	 * @param oldPath Path to report for the old blob, can be NULL.
+	 * @param newPath Path to report for the new blob, can be NULL.
+	 * @return true if completly terminated and false if user terminated.
+	 * @throws Exception
+	 */
+	bool diff(const Blob& oldBlob, const Blob& newBlob,
+		const char* oldPath = NULL, const char* newPath = NULL)const;
+
+	/**
+	 * Diff a blob with a buffer, passing the result to the callbacks.
+	 *
+	 * @param oldBlob Blob to diff from, can be null.
+	 * @param buffer Content to diff to, only read during the call.
+	 * @param oldPath Path to report for the blob, can be NULL.
+	 * @param bufferPath Path to report for the buffer, can be NULL.
+	 * @return true if completly terminated and false if user terminated.
+	 * @throws Exception
+	 */
+	bool diff(const Blob& oldBlob, const StringView& buffer,
+		const char* oldPath = NULL, const char* bufferPath = NULL)const;
+
+	/**
+	 * Generate the patch of two blobs, for random access to the hunks and
+	 * lines rather than streaming them.
+	 *
+	 * @return Patch of the blobs, referring to the blobs.
+	 * @throws Exception
+	 */
+	DiffPatch patch(const Blob& oldBlob, const Blob& newBlob,
+		const char* oldPath = NULL, const char* newPath = NULL)const;
+
+	/**
+	 * Generate the patch of a blob and a buffer.
+	 *
+	 * @return Patch of the blob and the buffer. Its lines refer to the
+	 * buffer, which must outlive it.
+	 * @throws Exception
+	 */
+	DiffPatch patch(const Blob& oldBlob, const StringView& buffer,
+		const char* oldPath = NULL, const char* bufferPath = NULL)const;
+
+private:
+	DiffOptions _options;
+	const git_diff_options* _data;
+	DiffFileCallbackFunction _fileCallback;
+	DiffHunkCallbackFunction _hunkCallback;
+	DiffDataCallbackFunction _lineCallback;
+};
 
 
 
@@ -0,0 +1,234 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#include "diffcache.hpp"
+
+#include "exception.hpp"
+#include "repository.hpp"
+#include "tree.hpp"
+
+#include <cstring>
+
+namespace git2
+{
+
+//
+// DiffDeltaArray
+//
+
+DiffDeltaArray::DiffDeltaArray()
+{
+}
+
+DiffDeltaArray::DiffDeltaArray(const DiffList& list)
+{
+	auto addPath = [this](const char* path)
+	{
+		const uint32_t offset = _paths.size();
+		_paths.insert(_paths.end(), path, path + std::strlen(path) + 1);
+		return offset;
+	};
+
+	const size_t count = list.deltaCount();
+	_entries.resize(count);
+	for(size_t idx = 0; idx < count; ++idx)
+	{
+		const git_diff_delta *delta = git_diff_get_delta(list.data(), idx);
+		Entry& entry = _entries[idx];
+		git_oid_cpy(&entry.oldId, &delta->old_file.id);
+		git_oid_cpy(&entry.newId, &delta->new_file.id);
+		entry.oldPath = addPath(delta->old_file.path);
+		entry.newPath = std::strcmp(delta->old_file.path, delta->new_file.path)==0
+			? entry.oldPath : addPath(delta->new_file.path);
+		entry.flags = delta->flags;
+		entry.oldFlags = delta->old_file.flags;
+		entry.newFlags = delta->new_file.flags;
+		entry.oldMode = delta->old_file.mode;
+		entry.newMode = delta->new_file.mode;
+		entry.similarity = delta->similarity;
+		entry.status = delta->status;
+	}
+	_paths.shrink_to_fit();
+}
+
+size_t DiffDeltaArray::deltaCount(git_delta_t type)const
+{
+	size_t count = 0;
+	for(const Entry& entry : _entries)
+		if(entry.status==type)
+			++count;
+	return count;
+}
+
+DiffDelta DiffDeltaArray::delta(size_t idx)const
+{
+	if(idx >= _entries.size())
+	{
+		giterr_set_str(GITERR_INVALID, "delta index out of range");
+		throw Exception(GIT_ENOTFOUND);
+	}
+	const Entry& entry = _entries[idx];
+	git_diff_delta delta;
+	std::memset(&delta, 0, sizeof(delta));
+	delta.status = (git_delta_t)entry.status;
+	delta.flags = entry.flags;
+	delta.similarity = entry.similarity;
+	delta.nfiles = 2;
+	git_oid_cpy(&delta.old_file.id, &entry.oldId);
+	delta.old_file.path = &_paths[entry.oldPath];
+	delta.old_file.flags = entry.oldFlags;
+	delta.old_file.mode = entry.oldMode;
+	git_oid_cpy(&delta.new_file.id, &entry.newId);
+	delta.new_file.path = &_paths[entry.newPath];
+	delta.new_file.flags = entry.newFlags;
+	delta.new_file.mode = entry.newMode;
+	return DiffDelta(&delta);
+}
+
+size_t DiffDeltaArray::weight()const
+{
+	return sizeof(*this) + _entries.capacity() * sizeof(Entry) + _paths.capacity();
+}
+
+//
+// DiffCache
+//
+
+bool DiffCache::Key::operator==(const Key& other)const
+{
+	return git_oid_equal(&oldTree, &other.oldTree) && git_oid_equal(&newTree, &other.newTree)
+		&& flags==other.flags && maxSize==other.maxSize && pathspec==other.pathspec;
+}
+
+size_t DiffCache::KeyHash::operator()(const Key& key)const
+{
+	// Object ids are already uniformly distributed: mix their first
+	// bytes with a FNV-1a hash of the options.
+	uint64_t oldTree, newTree;
+	std::memcpy(&oldTree, key.oldTree.id, sizeof(oldTree));
+	std::memcpy(&newTree, key.newTree.id, sizeof(newTree));
+	uint64_t hash = 0xcbf29ce484222325ull;
+	auto mix = [&hash](uint64_t value){ hash = (hash ^ value) * 0x100000001b3ull; };
+	mix(key.flags);
+	mix((uint64_t)key.maxSize);
+	for(const std::string& path : key.pathspec)
+		for(char c : path)
+			mix((unsigned char)c);
+	return (size_t)(oldTree ^ (newTree * 31) ^ hash);
+}
+
+DiffCache::DiffCache(size_t maxMemory):
+_budget(maxMemory),
+_memory(0),
+_hits(0),
+_misses(0)
+{
+}
+
+std::shared_ptr<const DiffDeltaArray> DiffCache::diffTreeToTree(const Repository& repo,
+		const Tree& oldTree, const Tree& newTree, const DiffOptions& options)
+{
+	if(options.notify())
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			++_misses;
+		}
+		return std::make_shared<const DiffDeltaArray>(repo.diffTreeToTree(oldTree, newTree, options));
+	}
+
+	Key key;
+	std::memset(&key.oldTree, 0, sizeof(key.oldTree));
+	std::memset(&key.newTree, 0, sizeof(key.newTree));
+	if(!oldTree.isNull())
+		git_oid_cpy(&key.oldTree, git_tree_id(oldTree.data()));
+	if(!newTree.isNull())
+		git_oid_cpy(&key.newTree, git_tree_id(newTree.data()));
+	key.flags = options.flags();
+	key.maxSize = options.maxSize();
+	key.pathspec = options.pathspec();
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		auto it = _index.find(key);
+		if(it!=_index.end())
+		{
+			++_hits;
+			_items.splice(_items.begin(), _items, it->second);
+			return it->second->deltas;
+		}
+		++_misses;
+	}
+
+	// Diff without holding the lock: concurrent misses of the same diff
+	// compute it twice rather than waiting for each other.
+	std::shared_ptr<const DiffDeltaArray> deltas =
+		std::make_shared<const DiffDeltaArray>(repo.diffTreeToTree(oldTree, newTree, options));
+	const size_t weight = deltas->weight() + sizeof(Item) + key.pathspec.size() * sizeof(std::string);
+	if(weight > _budget)
+		return deltas;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if(_index.find(key)!=_index.end())
+		return deltas;
+	_items.push_front(Item{key, deltas, weight});
+	_index.emplace(std::move(key), _items.begin());
+	_memory += weight;
+	while(_memory > _budget)
+	{
+		_memory -= _items.back().weight;
+		_index.erase(_items.back().key);
+		_items.pop_back();
+	}
+	return deltas;
+}
+
+void DiffCache::clear()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_index.clear();
+	_items.clear();
+	_memory = 0;
+}
+
+size_t DiffCache::size()const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _items.size();
+}
+
+size_t DiffCache::memory()const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _memory;
+}
+
+uint64_t DiffCache::hits()const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _hits;
+}
+
+uint64_t DiffCache::misses()const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _misses;
+}
+
+} // namespace git2
@@ -0,0 +1,204 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#ifndef _GIT2PP_DIFFCACHE_HPP_
+#define _GIT2PP_DIFFCACHE_HPP_
+
+#include <git2.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "diff.hpp"
+
+namespace git2
+{
+
+class Repository;
+class Tree;
+
+/**
+ * Compact copy of the deltas of a diff list, which does not hold any
+ * libgit2 data.
+ *
+ * Each delta takes a fixed size entry and the paths are stored once, in
+ * a single buffer. File sizes are not kept.
+ */
+class DiffDeltaArray
+{
+public:
+	DiffDeltaArray();
+
+	/**
+	 * Copy the deltas of a list.
+	 */
+	explicit DiffDeltaArray(const DiffList& list);
+
+	/**
+	 * Number of deltas.
+	 */
+	size_t deltaCount()const{return _entries.size();}
+
+	/**
+	 * Number of deltas of a type.
+	 *
+	 * @param type A git_delta_t value to filter the count
+	 */
+	size_t deltaCount(git_delta_t type)const;
+
+	/**
+	 * Delta of an entry.
+	 *
+	 * @param idx Index into the array
+	 * @throws Exception GIT_ENOTFOUND if the index is out of range.
+	 */
+	DiffDelta delta(size_t idx)const;
+
+	/**
+	 * Memory used by the array, in bytes.
+	 */
+	size_t weight()const;
+
+private:
+	struct Entry
+	{
+		git_oid oldId;
+		git_oid newId;
+		uint32_t oldPath;  // Offsets of the paths in _paths.
+		uint32_t newPath;
+		uint32_t flags;
+		uint16_t oldFlags;
+		uint16_t newFlags;
+		uint16_t oldMode;
+		uint16_t newMode;
+		uint16_t similarity;
+		uint8_t status;
+	};
+
+	std::vector<Entry> _entries;
+	std::vector<char> _paths;  // NUL-terminated paths.
+};
+
+/**
+ * Least recently used cache of the deltas of tree to tree diffs.
+ *
+ * Trees being immutable, the deltas of a diff only depend on the ids of
+ * the trees and on the options selecting the deltas: the flags, the
+ * pathspec and the maximum size. The other options only shape the text
+ * diff and are not part of the key.
+ *
+ * The cache can be used from several threads at once. The least recently
+ * used diffs are dropped when the cached diffs weigh more than the
+ * budget.
+ */
+class DiffCache
+{
+public:
+	/**
+	 * Create a cache.
+	 *
+	 * @param maxMemory Budget of the cached diffs, in bytes.
+	 */
+	explicit DiffCache(size_t maxMemory = 64*1024*1024);
+
+	DiffCache(const DiffCache&) = delete;
+	DiffCache& operator=(const DiffCache&) = delete;
+
+	/**
+	 * Deltas of the diff of two trees, as Repository::diffTreeToTree()
+	 * finds them, from the cache or computed and cached.
+	 *
+	 * Diffs with a notify callback are computed without using the cache,
+	 * and counted as misses.
+	 *
+	 * @param repo Repository to diff the trees in.
+	 * @param oldTree Tree to diff from, can be a null tree.
+	 * @param newTree Tree to diff to, can be a null tree.
+	 * @param options Options of the diff.
+	 * @return Deltas of the diff, shared with the cache.
+	 * @throws Exception
+	 */
+	std::shared_ptr<const DiffDeltaArray> diffTreeToTree(const Repository& repo,
+		const Tree& oldTree, const Tree& newTree, const DiffOptions& options = DiffOptions());
+
+	/**
+	 * Remove all the diffs. The counters are kept.
+	 */
+	void clear();
+
+	/**
+	 * Number of cached diffs.
+	 */
+	size_t size()const;
+
+	/**
+	 * Memory used by the cached diffs, in bytes.
+	 */
+	size_t memory()const;
+
+	/**
+	 * Number of diffs found in the cache.
+	 */
+	uint64_t hits()const;
+
+	/**
+	 * Number of diffs computed.
+	 */
+	uint64_t misses()const;
+
+private:
+	struct Key
+	{
+		git_oid oldTree;
+		git_oid newTree;
+		uint32_t flags;
+		git_off_t maxSize;
+		std::vector<std::string> pathspec;
+
+		bool operator==(const Key& other)const;
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key)const;
+	};
+
+	struct Item
+	{
+		Key key;
+		std::shared_ptr<const DiffDeltaArray> deltas;
+		size_t weight;
+	};
+
+	mutable std::mutex _mutex;
+	std::list<Item> _items;  // Most recently used first.
+	std::unordered_map<Key, std::list<Item>::iterator, KeyHash> _index;
+	size_t _budget;
+	size_t _memory;
+	uint64_t _hits;
+	uint64_t _misses;
+};
+
+} // namespace git2
+#endif // _GIT2PP_DIFFCACHE_HPP_
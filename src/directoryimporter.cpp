@@ -0,0 +1,243 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#include "directoryimporter.hpp"
+
+#include "blobstream.hpp"
+#include "exception.hpp"
+#include "threadpool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace git2
+{
+
+namespace
+{
+
+const size_t default_stream_threshold = 32*1024*1024;
+const size_t stream_chunk_size        = 1024*1024;
+
+void throw_import_error(const std::string& msg)
+{
+	giterr_set_str(GITERR_OS, msg.c_str());
+	throw Exception(GIT_ERROR);
+}
+
+/**
+ * File to import, as listed.
+ */
+struct ImportFile
+{
+	std::string path;
+	git_filemode_t mode;
+	OId oid; //!< Commit checked out, for a nested repository.
+};
+
+/**
+ * File descriptor closed when going out of scope.
+ */
+struct FileDescriptor
+{
+	explicit FileDescriptor(int f):fd(f){}
+	~FileDescriptor(){if(fd>=0) ::close(fd);}
+	FileDescriptor(const FileDescriptor&) = delete;
+	FileDescriptor& operator=(const FileDescriptor&) = delete;
+	int fd;
+};
+
+/**
+ * List the files of a directory and of its subdirectories.
+ *
+ * @param root Directory to import.
+ * @param prefix Path of the listed directory relative to root, "" or
+ * ending with a slash.
+ */
+void list_files(const std::string& root, const std::string& prefix, std::vector<ImportFile>& files)
+{
+	const std::string dirPath = root + "/" + prefix;
+	DIR* dir = ::opendir(dirPath.c_str());
+	if(dir==NULL)
+		throw_import_error("cannot open directory '" + dirPath + "'");
+	std::vector<std::string> names;
+	while(struct dirent* ent = ::readdir(dir))
+	{
+		const char* name = ent->d_name;
+		if(std::strcmp(name, ".")!=0 && std::strcmp(name, "..")!=0 && ::strcasecmp(name, ".git")!=0)
+			names.push_back(name);
+	}
+	::closedir(dir);
+
+	for(const std::string& name : names)
+	{
+		const std::string path = prefix + name;
+		struct stat st;
+		if(::lstat((dirPath + name).c_str(), &st)!=0)
+			throw_import_error("cannot stat '" + dirPath + name + "'");
+		struct stat gitSt;
+		if(S_ISDIR(st.st_mode) && ::lstat((dirPath + name + "/.git").c_str(), &gitSt)==0)
+		{
+			// A nested repository is recorded as a gitlink to its
+			// checked out commit, like git add does.
+			OId head;
+			try
+			{
+				head = Repository::open(dirPath + name).lookupReferenceOId("HEAD");
+			}
+			catch(const Exception&)
+			{
+				throw_import_error("nested repository '" + dirPath + name + "' has no commit checked out");
+			}
+			files.push_back(ImportFile{path, GIT_FILEMODE_COMMIT, head});
+		}
+		else if(S_ISDIR(st.st_mode))
+			list_files(root, path + "/", files);
+		else if(S_ISREG(st.st_mode))
+			files.push_back(ImportFile{path, (st.st_mode & S_IXUSR) ? GIT_FILEMODE_BLOB_EXECUTABLE : GIT_FILEMODE_BLOB, OId()});
+		else if(S_ISLNK(st.st_mode))
+			files.push_back(ImportFile{path, GIT_FILEMODE_LINK, OId()});
+	}
+}
+
+/**
+ * Write a file as a blob.
+ *
+ * @param buffer Buffer of the worker, reused from a file to the next.
+ */
+OId import_file(Repository& repo, const std::string& path, git_filemode_t mode, std::vector<char>& buffer, size_t threshold)
+{
+	if(mode==GIT_FILEMODE_LINK)
+	{
+		// The blob of a link is its target.
+		buffer.resize(std::max<size_t>(buffer.size(), 256));
+		for(;;)
+		{
+			ssize_t length = ::readlink(path.c_str(), buffer.data(), buffer.size());
+			if(length<0)
+				throw_import_error("cannot read link '" + path + "'");
+			if((size_t)length<buffer.size())
+				return repo.createBlobFromBuffer(buffer.data(), length);
+			buffer.resize(buffer.size()*2);
+		}
+	}
+
+	FileDescriptor file(::open(path.c_str(), O_RDONLY));
+	struct stat st;
+	if(file.fd<0 || ::fstat(file.fd, &st)!=0)
+		throw_import_error("cannot open '" + path + "'");
+	const size_t size = st.st_size;
+#ifdef POSIX_FADV_SEQUENTIAL
+	::posix_fadvise(file.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	// Read whole files at once, or a chunk at a time when streamed.
+	const bool stream = size>threshold;
+	std::unique_ptr<BlobWriter> writer(stream ? new BlobWriter(repo, size) : nullptr);
+	buffer.resize(stream ? stream_chunk_size : size);
+	size_t done = 0, filled = 0;
+	while(done<size)
+	{
+		ssize_t count = ::read(file.fd, buffer.data()+filled, std::min(buffer.size()-filled, size-done));
+		if(count<0 && errno==EINTR)
+			continue;
+		if(count<0)
+			throw_import_error("cannot read '" + path + "'");
+		if(count==0)
+			throw_import_error("file '" + path + "' changed while importing");
+		done += count;
+		filled += count;
+		if(stream && (filled==buffer.size() || done==size))
+		{
+			writer->write(buffer.data(), filled);
+			filled = 0;
+		}
+	}
+
+	// The file must also not have grown since fstat().
+	char extra;
+	ssize_t count;
+	while((count = ::read(file.fd, &extra, 1))<0 && errno==EINTR)
+		;
+	if(count<0)
+		throw_import_error("cannot read '" + path + "'");
+	if(count>0)
+		throw_import_error("file '" + path + "' changed while importing");
+	return stream ? writer->finalize() : repo.createBlobFromBuffer(buffer.data(), size);
+}
+
+} // namespace
+
+
+DirectoryImporter::DirectoryImporter(const Repository& repo):
+_repo(repo),
+_streamThreshold(default_stream_threshold)
+{
+}
+
+void DirectoryImporter::setStreamThreshold(size_t size)
+{
+	_streamThreshold = size;
+}
+
+std::vector<ImportEntry> DirectoryImporter::import(const std::string& directory) const
+{
+	ThreadPool pool(1);
+	return import(directory, pool);
+}
+
+std::vector<ImportEntry> DirectoryImporter::import(const std::string& directory, ThreadPool& pool) const
+{
+	std::vector<ImportFile> files;
+	list_files(directory, std::string(), files);
+	std::sort(files.begin(), files.end(), [](const ImportFile& a, const ImportFile& b){ return a.path<b.path; });
+
+	std::vector<ImportEntry> entries(files.size());
+	std::atomic<size_t> next(0);
+	const char* path = git_repository_path(_repo.data());
+	pool.run([&](unsigned int worker)
+	{
+		if(worker != 0 && path == NULL)
+			return;
+		Repository handle = worker == 0 ? _repo : Repository::open(path);
+		std::vector<char> buffer;
+		for(size_t n = next++; n < files.size(); n = next++)
+		{
+			ImportEntry& entry = entries[n];
+			if(files[n].mode==GIT_FILEMODE_COMMIT)
+				entry.oid = files[n].oid;
+			else
+				entry.oid = import_file(handle, directory + "/" + files[n].path, files[n].mode, buffer, _streamThreshold);
+			entry.mode = files[n].mode;
+			entry.path = std::move(files[n].path);
+		}
+	});
+	return entries;
+}
+
+} // namespace git2
@@ -0,0 +1,102 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#ifndef _GIT2PP_DIRECTORYIMPORTER_HPP_
+#define _GIT2PP_DIRECTORYIMPORTER_HPP_
+
+#include <git2.h>
+
+#include <string>
+#include <vector>
+
+#include "oid.hpp"
+#include "repository.hpp"
+
+namespace git2
+{
+
+class ThreadPool;
+
+/**
+ * File of a directory written as a blob.
+ */
+struct ImportEntry
+{
+	std::string path;    //!< Path relative to the directory, with '/' separators.
+	OId oid;             //!< Id of the blob, or of the commit of a gitlink.
+	git_filemode_t mode; //!< GIT_FILEMODE_BLOB, GIT_FILEMODE_BLOB_EXECUTABLE, GIT_FILEMODE_LINK or GIT_FILEMODE_COMMIT.
+};
+
+/**
+ * Writer of all the files of a directory as blobs, like `git add` of a
+ * whole tree without an index.
+ *
+ * Regular files and symbolic links are imported, in all the
+ * subdirectories; ".git" entries and other kinds of files are skipped,
+ * and so are empty directories, which git does not track. A subdirectory
+ * with its own ".git" is a nested repository: like `git add`, it is not
+ * imported but recorded as a gitlink to its checked out commit. The entries are
+ * sorted by path in byte order, so they can be given to a
+ * SortedTreeBuilder as is to create the tree of the directory.
+ */
+class DirectoryImporter
+{
+public:
+	/**
+	 * Create an importer.
+	 *
+	 * @param repo Repository to write the blobs to.
+	 */
+	explicit DirectoryImporter(const Repository& repo);
+
+	/**
+	 * Files bigger than this size are streamed to the object database
+	 * instead of being read in memory at once; 32MB by default.
+	 */
+	size_t streamThreshold()const{return _streamThreshold;}
+	void setStreamThreshold(size_t size);
+
+	/**
+	 * Import a directory, a file at a time.
+	 *
+	 * @throws Exception if a file cannot be read or written, changes while
+	 * it is read, or if a nested repository has no commit checked out.
+	 */
+	std::vector<ImportEntry> import(const std::string& directory) const;
+
+	/**
+	 * Import a directory on a pool of threads.
+	 *
+	 * The directory is listed first. The workers then read, hash,
+	 * compress and write whole files, so the cost of SHA-1 and zlib is
+	 * spread over them. Worker 0 uses the repository of the importer and
+	 * the others open their own handle.
+	 *
+	 * @throws Exception if a file cannot be read or written, changes while
+	 * it is read, or if a nested repository has no commit checked out.
+	 */
+	std::vector<ImportEntry> import(const std::string& directory, ThreadPool& pool) const;
+
+private:
+	Repository _repo;
+	size_t _streamThreshold;
+};
+
+} // namespace git2
+#endif // _GIT2PP_DIRECTORYIMPORTER_HPP_
@@ -25,23 +25,36 @@
 #include "git2pp/common.hpp"
 
 #include "git2pp/blob.hpp"
+#include "git2pp/blobstream.hpp"
 #include "git2pp/branch.hpp"
 #include "git2pp/commit.hpp"
+#include "git2pp/commitgraph.hpp"
 #include "git2pp/config.hpp"
 #include "git2pp/database.hpp"
 #include "git2pp/diff.hpp"
+#include "git2pp/diffcache.hpp"
+#include "git2pp/directoryimporter.hpp"
 #include "git2pp/exception.hpp"
 #include "git2pp/index.hpp"
 #include "git2pp/object.hpp"
 #include "git2pp/oid.hpp"
+#include "git2pp/oidmap.hpp"
+#include "git2pp/prefixindex.hpp"
+#include "git2pp/reachability.hpp"
 #include "git2pp/ref.hpp"
 #include "git2pp/remote.hpp"
 #include "git2pp/repository.hpp"
 #include "git2pp/revwalk.hpp"
 #include "git2pp/signature.hpp"
+#include "git2pp/similarity.hpp"
 #include "git2pp/status.hpp"
+#include "git2pp/stringview.hpp"
 #include "git2pp/tag.hpp"
+#include "git2pp/threadpool.hpp"
 #include "git2pp/tree.hpp"
+#include "git2pp/treebuilder.hpp"
+#include "git2pp/treesnapshot.hpp"
+#include "git2pp/treewalker.hpp"
 
 #endif // _GIT2PP_HPP_
 
@@ -52,7 +52,12 @@ OId IndexEntry::id() const
 
 std::string IndexEntry::path() const
 {
-    return std::string(_entry->path);
+    return pathView().str();
+}
+
+StringView IndexEntry::pathView() const
+{
+    return StringView(_entry->path);
 }
 
 int64_t IndexEntry::fileSize() const
@@ -80,7 +85,7 @@ _Class(index)
 }
 
 Index::Index(const Index& other):
-_Class(other.data())
+_Class(other)
 {
 }
 
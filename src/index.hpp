@@ -25,6 +25,7 @@
 #include <memory>
 
 #include "common.hpp"
+#include "stringview.hpp"
 
 namespace git2
 {
@@ -63,6 +64,14 @@ public:
      */
     std::string path() const;
 
+    /**
+     * Get the path of the index entry without copying it.
+     *
+     * The view is valid as long as the entry is in the index, i.e. until
+     * the index is modified, re-read or freed.
+     */
+    StringView pathView() const;
+
     /**
      * Get the size of the file
      */
@@ -102,6 +111,14 @@ public:
      */
     Index(const Index& other);
 
+    /**
+     * Move constructor; takes over the underlaying data structure.
+     */
+    Index(Index&& other) = default;
+
+    Index& operator=(const Index& other) = default;
+    Index& operator=(Index&& other) = default;
+
     /**
      * Destruct an existing index object.
      */
@@ -44,7 +44,7 @@ class Tree;
  * This is the base class for every repository object, i.e. blob, commit,
  * tag and tree. Every object is identified with it's git2::OId.
  */
-class Object : public helper::Git2PtrWrapper<git_object, git_object_free>
+class Object : public helper::Git2PtrWrapper<git_object, git_object_free, git_object_dup>
 {
 public:
     /**
@@ -61,6 +61,14 @@ public:
      */
     Object(const Object& other);
 
+    /**
+     * Move constructor; takes over the underlaying data structure.
+     */
+    Object(Object&& other) = default;
+
+    Object& operator=(const Object& other) = default;
+    Object& operator=(Object&& other) = default;
+
     /**
      * Convert into a commit object.
      *
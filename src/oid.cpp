@@ -21,57 +21,62 @@
 
 #include "exception.hpp"
 
-namespace git2
-{
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
 
+// Define GIT2PP_NO_SIMD to force the portable hex kernels, GIT2PP_NO_AVX2
+// to stay with the SSE2 ones.
+#if !defined(GIT2PP_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define GIT2PP_HEX_SSE2 1
+#include <emmintrin.h>
+#if !defined(GIT2PP_NO_AVX2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GIT2PP_HEX_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
 
-OId::OId(const git_oid *oid):
-_oid((size_t)GIT_OID_RAWSZ, (unsigned char)0)
+namespace git2
 {
-	if(oid!=NULL)
-	{
-		_oid.assign((unsigned char*)oid, (unsigned char*)oid+GIT_OID_RAWSZ);
-	}
-}
 
 
-OId::OId(const OId& oid):
-_oid(oid._oid)
-{
-}
+static_assert(std::is_trivially_copyable<OId>::value, "OId must stay trivially copyable");
 
-OId::~OId()
+OId::OId(const git_oid *oid):
+_length(GIT_OID_HEXSZ)
 {
+	if(oid!=NULL)
+		std::memcpy(_oid.id, oid->id, GIT_OID_RAWSZ);
+	else
+		std::memset(_oid.id, 0, GIT_OID_RAWSZ);
 }
 
 bool OId::isValid() const
 {
-	return ( !_oid.empty() &&
-	         (_oid.size() <= GIT_OID_RAWSZ) &&
-	         (_oid != std::vector<unsigned char>((size_t)GIT_OID_RAWSZ, (unsigned char)0))
-	         );
+	return _length>0 && !isZero();
 }
 
 void OId::fromHex(const std::vector<char>& hex)
 {
 	size_t len = std::min(hex.size(), (size_t)GIT_OID_HEXSZ);
-	 Exception::git2_assert(git_oid_fromstrn(data(), &hex.front(), len));
-	_oid.resize(len / 2);
+	Exception::git2_assert(git_oid_fromstrn(data(), hex.data(), len));
+	_length = (unsigned char)len;
 }
 
 void OId::fromString(const std::string& str)
 {
 	size_t len = std::min(str.size(), (size_t)GIT_OID_HEXSZ);
-	 Exception::git2_assert(git_oid_fromstrn(data(), str.c_str(), len));
-	_oid.resize(len / 2);
+	Exception::git2_assert(git_oid_fromstrn(data(), str.c_str(), len));
+	_length = (unsigned char)len;
 }
 
 void OId::fromRawData(const std::vector<unsigned char>& raw)
 {
-	if(raw.size()<GIT_OID_RAWSZ)
-		_oid = raw;
-	else
-		_oid.assign(raw.begin(), raw.begin()+GIT_OID_RAWSZ);
+	size_t len = std::min(raw.size(), (size_t)GIT_OID_RAWSZ);
+	std::memset(_oid.id, 0, GIT_OID_RAWSZ);
+	if(len>0)
+		std::memcpy(_oid.id, raw.data(), len);
+	_length = (unsigned char)(len * 2);
 }
 
 bool OId::isZero() const
@@ -102,61 +107,227 @@ OId OId::rawDataToOid(const std::vector<unsigned char>& raw)
 
 std::string OId::format() const
 {
-	std::vector<char> buffer((size_t)GIT_OID_HEXSZ+1, (char)0);
-	git_oid_fmt(buffer.data(), constData());
-	return std::string(buffer.data());
+	char buffer[GIT_OID_HEXSZ];
+	formatMany(this, 1, buffer);
+	return std::string(buffer, GIT_OID_HEXSZ);
 }
 
 std::string OId::pathFormat() const
 {
-	std::vector<char> buffer((size_t)GIT_OID_HEXSZ+1, (char)0);
-	git_oid_pathfmt(buffer.data(), constData());
-	return std::string(buffer.data());
+	char buffer[GIT_OID_HEXSZ+1];
+	git_oid_pathfmt(buffer, constData());
+	return std::string(buffer, GIT_OID_HEXSZ+1);
+}
+
+//
+// Hex kernels
+//
+
+namespace
+{
+
+#ifndef GIT2PP_HEX_SSE2
+
+const char hex_digits[] = "0123456789abcdef";
+
+// Nibble value of each char, 0xff when not an hexadecimal digit.
+struct HexTable
+{
+	unsigned char value[256];
+	HexTable()
+	{
+		std::memset(value, 0xff, sizeof(value));
+		for(int n=0; n<10; ++n)
+			value['0'+n] = n;
+		for(int n=0; n<6; ++n)
+			value['a'+n] = value['A'+n] = 10+n;
+	}
+};
+
+const HexTable hex_table;
+
+void format_scalar(const unsigned char* raw, char* out)
+{
+	for(size_t n=0; n<GIT_OID_RAWSZ; ++n)
+	{
+		out[2*n]   = hex_digits[raw[n] >> 4];
+		out[2*n+1] = hex_digits[raw[n] & 0x0f];
+	}
+}
+
+bool parse_scalar(const char* hex, unsigned char* raw)
+{
+	unsigned char bad = 0;
+	for(size_t n=0; n<GIT_OID_RAWSZ; ++n)
+	{
+		unsigned char hi = hex_table.value[(unsigned char)hex[2*n]];
+		unsigned char lo = hex_table.value[(unsigned char)hex[2*n+1]];
+		bad |= hi | lo;
+		raw[n] = (unsigned char)((hi << 4) | (lo & 0x0f));
+	}
+	return (bad & 0xf0) == 0;
+}
+
+#endif // !GIT2PP_HEX_SSE2
+
+#ifdef GIT2PP_HEX_SSE2
+
+// Convert nibbles (one per byte) to lower case hex digits.
+inline __m128i nibbles_to_hex_sse2(__m128i n)
+{
+	__m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(n, _mm_set1_epi8(9)), _mm_set1_epi8('a'-'0'-10));
+	return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')), alpha);
 }
 
-git_oid* OId::data()
+// Convert hex digits to nibbles, one per byte, and flag invalid chars in bad.
+inline __m128i hex_to_nibbles_sse2(__m128i c, __m128i& bad)
 {
-	return reinterpret_cast<git_oid*>(&_oid.front());
+	__m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+	__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0'-1)), _mm_cmplt_epi8(c, _mm_set1_epi8('9'+1)));
+	__m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a'-1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('f'+1)));
+	bad = _mm_or_si128(bad, _mm_andnot_si128(_mm_or_si128(digit, alpha), _mm_set1_epi8(-1)));
+	return _mm_or_si128(_mm_and_si128(digit, _mm_sub_epi8(c, _mm_set1_epi8('0'))),
+	                    _mm_and_si128(alpha, _mm_sub_epi8(lower, _mm_set1_epi8('a'-10))));
 }
-	
-const git_oid* OId::constData() const
+
+// Merge pairs of nibbles (as little endian 16 bits words) into bytes, one per word.
+inline __m128i nibble_pairs_to_words_sse2(__m128i n)
 {
-	return reinterpret_cast<const git_oid*>(&_oid.front());
+	return _mm_or_si128(_mm_slli_epi16(_mm_and_si128(n, _mm_set1_epi16(0x00ff)), 4), _mm_srli_epi16(n, 8));
 }
 
-int OId::length() const
+void format_sse2(const unsigned char* raw, char* out)
 {
-	return _oid.size() * 2;
+	__m128i mask = _mm_set1_epi8(0x0f);
+
+	__m128i b  = _mm_loadu_si128((const __m128i*)raw);
+	__m128i hi = _mm_and_si128(_mm_srli_epi16(b, 4), mask);
+	__m128i lo = _mm_and_si128(b, mask);
+	_mm_storeu_si128((__m128i*)out, nibbles_to_hex_sse2(_mm_unpacklo_epi8(hi, lo)));
+	_mm_storeu_si128((__m128i*)(out+16), nibbles_to_hex_sse2(_mm_unpackhi_epi8(hi, lo)));
+
+	int32_t tail;
+	std::memcpy(&tail, raw+16, sizeof(tail));
+	b  = _mm_cvtsi32_si128(tail);
+	hi = _mm_and_si128(_mm_srli_epi16(b, 4), mask);
+	lo = _mm_and_si128(b, mask);
+	_mm_storel_epi64((__m128i*)(out+32), nibbles_to_hex_sse2(_mm_unpacklo_epi8(hi, lo)));
 }
 
-bool operator ==(const OId &oid1, const OId &oid2)
+bool parse_sse2(const char* hex, unsigned char* raw)
 {
-	return git_oid_cmp(oid1.constData(), oid2.constData()) == 0;
+	__m128i bad = _mm_setzero_si128(), badTail = _mm_setzero_si128();
+	__m128i w0 = nibble_pairs_to_words_sse2(hex_to_nibbles_sse2(_mm_loadu_si128((const __m128i*)hex), bad));
+	__m128i w1 = nibble_pairs_to_words_sse2(hex_to_nibbles_sse2(_mm_loadu_si128((const __m128i*)(hex+16)), bad));
+	__m128i w2 = nibble_pairs_to_words_sse2(hex_to_nibbles_sse2(_mm_loadl_epi64((const __m128i*)(hex+32)), badTail));
+	// Only 8 chars are loaded in the last vector.
+	if(_mm_movemask_epi8(bad) != 0 || (_mm_movemask_epi8(badTail) & 0xff) != 0)
+		return false;
+
+	_mm_storeu_si128((__m128i*)raw, _mm_packus_epi16(w0, w1));
+	int32_t tail = _mm_cvtsi128_si32(_mm_packus_epi16(w2, w2));
+	std::memcpy(raw+16, &tail, sizeof(tail));
+	return true;
 }
 
-bool operator !=(const OId &oid1, const OId &oid2)
+#endif // GIT2PP_HEX_SSE2
+
+#ifdef GIT2PP_HEX_AVX2
+
+__attribute__((target("avx2")))
+void format_avx2(const unsigned char* raw, char* out)
 {
-	return git_oid_cmp(oid1.constData(), oid2.constData()) != 0;
+	// Widen the 16 first bytes to words and put the high nibble in the low byte.
+	__m256i w  = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)raw));
+	__m256i n  = _mm256_or_si256(_mm256_srli_epi16(w, 4), _mm256_slli_epi16(_mm256_and_si256(w, _mm256_set1_epi16(0x0f)), 8));
+	__m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(n, _mm256_set1_epi8(9)), _mm256_set1_epi8('a'-'0'-10));
+	_mm256_storeu_si256((__m256i*)out, _mm256_add_epi8(_mm256_add_epi8(n, _mm256_set1_epi8('0')), alpha));
+
+	int32_t tail;
+	std::memcpy(&tail, raw+16, sizeof(tail));
+	__m128i mask = _mm_set1_epi8(0x0f);
+	__m128i b  = _mm_cvtsi32_si128(tail);
+	__m128i hi = _mm_and_si128(_mm_srli_epi16(b, 4), mask);
+	__m128i lo = _mm_and_si128(b, mask);
+	_mm_storel_epi64((__m128i*)(out+32), nibbles_to_hex_sse2(_mm_unpacklo_epi8(hi, lo)));
 }
 
-bool operator >(const OId &oid1, const OId &oid2)
+__attribute__((target("avx2")))
+bool parse_avx2(const char* hex, unsigned char* raw)
 {
-	return git_oid_cmp(oid1.constData(), oid2.constData()) > 0;
+	__m256i c     = _mm256_loadu_si256((const __m256i*)hex);
+	__m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+	__m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0'-1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9'+1), c));
+	__m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a'-1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('f'+1), lower));
+	if(_mm256_movemask_epi8(_mm256_or_si256(digit, alpha)) != -1)
+		return false;
+	__m256i n = _mm256_or_si256(_mm256_and_si256(digit, _mm256_sub_epi8(c, _mm256_set1_epi8('0'))),
+	                            _mm256_and_si256(alpha, _mm256_sub_epi8(lower, _mm256_set1_epi8('a'-10))));
+	__m256i w = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(n, _mm256_set1_epi16(0x00ff)), 4), _mm256_srli_epi16(n, 8));
+	// packus works per 128 bits lane, gather the two useful quad words.
+	__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(w, w), 0x08);
+
+	__m128i badTail = _mm_setzero_si128();
+	__m128i w2 = nibble_pairs_to_words_sse2(hex_to_nibbles_sse2(_mm_loadl_epi64((const __m128i*)(hex+32)), badTail));
+	if((_mm_movemask_epi8(badTail) & 0xff) != 0)
+		return false;
+
+	_mm_storeu_si128((__m128i*)raw, _mm256_castsi256_si128(packed));
+	int32_t tail = _mm_cvtsi128_si32(_mm_packus_epi16(w2, w2));
+	std::memcpy(raw+16, &tail, sizeof(tail));
+	return true;
 }
 
-bool operator <(const OId &oid1, const OId &oid2)
+bool has_avx2()
 {
-	return git_oid_cmp(oid1.constData(), oid2.constData()) < 0;
+	static const bool avx2 = (__builtin_cpu_init(), __builtin_cpu_supports("avx2") != 0);
+	return avx2;
 }
 
-bool operator >=(const OId &oid1, const OId &oid2)
+#endif // GIT2PP_HEX_AVX2
+
+} // namespace
+
+void OId::formatMany(const OId* oids, size_t count, char* out, size_t stride)
 {
-	return git_oid_cmp(oid1.constData(), oid2.constData()) >= 0;
+#ifdef GIT2PP_HEX_AVX2
+	if(has_avx2())
+	{
+		for(size_t n=0; n<count; ++n)
+			format_avx2(oids[n]._oid.id, out + n*stride);
+		return;
+	}
+#endif
+	for(size_t n=0; n<count; ++n)
+	{
+#ifdef GIT2PP_HEX_SSE2
+		format_sse2(oids[n]._oid.id, out + n*stride);
+#else
+		format_scalar(oids[n]._oid.id, out + n*stride);
+#endif
+	}
 }
 
-bool operator <=(const OId &oid1, const OId &oid2)
+void OId::hexToOidMany(const char* hex, size_t count, OId* out, size_t stride)
 {
-	return git_oid_cmp(oid1.constData(), oid2.constData()) <= 0;
+	for(size_t n=0; n<count; ++n)
+	{
+		const char* str = hex + n*stride;
+		OId& oid = out[n];
+#if defined(GIT2PP_HEX_AVX2)
+		bool ok = has_avx2() ? parse_avx2(str, oid._oid.id) : parse_sse2(str, oid._oid.id);
+#elif defined(GIT2PP_HEX_SSE2)
+		bool ok = parse_sse2(str, oid._oid.id);
+#else
+		bool ok = parse_scalar(str, oid._oid.id);
+#endif
+		if(!ok)
+		{
+			// Let libgit2 report the error.
+			Exception::git2_assert(git_oid_fromstrn(oid.data(), str, GIT_OID_HEXSZ));
+		}
+		oid._length = GIT_OID_HEXSZ;
+	}
 }
 
 bool operator == (const OId &oid, const std::string &str)
@@ -22,6 +22,9 @@
 
 #include <git2.h>
 
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -31,6 +34,11 @@ namespace git2
 
 /**
  * This class represent a Git SHA1 id, i.e. 40 hexadecimal digits.
+ *
+ * The raw bytes are stored inline, so an OId never allocates and is
+ * trivially copyable. A shortened OId (a prefix) keeps its significant
+ * length, in hexadecimal digits, in a small length field; the unused
+ * trailing bytes are always zero.
  */
 class OId
 {
@@ -38,12 +46,6 @@ public:
 	/** Constructor */
 	OId(const git_oid *oid = NULL);
 
-	/** Copy constructor */
-	OId(const OId& oid);
-
-	/** Destructor */
-	~OId();
-
     /**
      * Checks if this is a valid Git OId.
 	 * An OId is invalid if it is empty or 0x0000... (20 byte).
@@ -52,15 +54,15 @@ public:
     bool isValid() const;
 	
 
-    git_oid* data();
-    const git_oid* constData() const;
+    git_oid* data() {return &_oid;}
+    const git_oid* constData() const {return &_oid;}
 
 	/**
 	 * Returns the length of the OId as a number of hexadecimal characters.
 	 *
 	 * The full length of a OId is 40, but OId represented by this class may be shorter.
      */
-	int length() const;
+	int length() const {return _length;}
 
     /**
      * Set the value of the object parsing a hex array.
@@ -152,41 +154,101 @@ public:
      */
     static OId rawDataToOid(const std::vector<unsigned char>& raw);
 
+    /**
+     * Format an array of OIds into hex strings, without allocating.
+     *
+     * Each id is written as 40 hexadecimal digits, without terminating
+     * NUL, at out + n*stride. The bytes between two ids are left untouched
+     * so separators, like new lines, may be written beforehand.
+     *
+     * Uses SSE2 or AVX2 kernels when available.
+     *
+     * @param oids Array of count ids.
+     * @param count Number of ids to format.
+     * @param out Buffer of at least (count-1)*stride+40 chars.
+     * @param stride Distance between the starts of two ids in out, at least 40.
+     */
+    static void formatMany(const OId* oids, size_t count, char* out, size_t stride = GIT_OID_HEXSZ);
+
+    /**
+     * Parse an array of hex formatted ids into OIds, without allocating.
+     *
+     * Each id must be made of 40 hexadecimal digits, in either case, and
+     * start at hex + n*stride. Shortened ids are not supported, use
+     * fromString() for them.
+     *
+     * Uses SSE2 or AVX2 kernels when available.
+     *
+     * @param hex Buffer of at least (count-1)*stride+40 chars.
+     * @param count Number of ids to parse.
+     * @param out Array of count ids receiving the result.
+     * @param stride Distance between the starts of two ids in hex, at least 40.
+     * @throws Exception if an id is not valid; the ids before it are parsed.
+     */
+    static void hexToOidMany(const char* hex, size_t count, OId* out, size_t stride = GIT_OID_HEXSZ);
+
 	// TODO Should implement oid shorten related functions ?
 	
 private:
-	std::vector<unsigned char> _oid;
+	git_oid       _oid;
+	unsigned char _length; //!< Significant length in hexadecimal digits.
 };
 
 /**
  * Compare two OIds.
+ *
+ * Equality is checked without branching by XOR-ing the raw words.
  */
-bool operator ==(const OId &oid1, const OId &oid2);
+inline bool operator ==(const OId &oid1, const OId &oid2)
+{
+	uint64_t a[2], b[2];
+	uint32_t ta, tb;
+	std::memcpy(a, oid1.constData()->id, 16);
+	std::memcpy(b, oid2.constData()->id, 16);
+	std::memcpy(&ta, oid1.constData()->id+16, 4);
+	std::memcpy(&tb, oid2.constData()->id+16, 4);
+	return ((a[0]^b[0]) | (a[1]^b[1]) | (uint64_t)(ta^tb)) == 0;
+}
 
 /**
  * Compare two OIds.
  */
-bool operator !=(const OId &oid1, const OId &oid2);
+inline bool operator !=(const OId &oid1, const OId &oid2)
+{
+	return !(oid1 == oid2);
+}
 
 /**
  * Compare two OIds.
  */
-bool operator >(const OId &oid1, const OId &oid2);
+inline bool operator >(const OId &oid1, const OId &oid2)
+{
+	return std::memcmp(oid1.constData()->id, oid2.constData()->id, GIT_OID_RAWSZ) > 0;
+}
 
 /**
  * Compare two OIds.
  */
-bool operator <(const OId &oid1, const OId &oid2);
+inline bool operator <(const OId &oid1, const OId &oid2)
+{
+	return std::memcmp(oid1.constData()->id, oid2.constData()->id, GIT_OID_RAWSZ) < 0;
+}
 
 /**
  * Compare two OIds.
  */
-bool operator >=(const OId &oid1, const OId &oid2);
+inline bool operator >=(const OId &oid1, const OId &oid2)
+{
+	return std::memcmp(oid1.constData()->id, oid2.constData()->id, GIT_OID_RAWSZ) >= 0;
+}
 
 /**
  * Compare two OIds.
  */
-bool operator <=(const OId &oid1, const OId &oid2);
+inline bool operator <=(const OId &oid1, const OId &oid2)
+{
+	return std::memcmp(oid1.constData()->id, oid2.constData()->id, GIT_OID_RAWSZ) <= 0;
+}
 
 /**
  * Compare an OId with a string.
@@ -200,5 +262,27 @@ bool operator == (const OId &oid, const char* str);
 
 
 } // namespace git2
+
+namespace std
+{
+
+/**
+ * Hash of an OId.
+ *
+ * The SHA-1 is already uniformly distributed, so the leading raw word is
+ * used as is.
+ */
+template<>
+struct hash<git2::OId>
+{
+	size_t operator()(const git2::OId& oid) const
+	{
+		size_t h;
+		std::memcpy(&h, oid.constData()->id, sizeof(h));
+		return h;
+	}
+};
+
+} // namespace std
 #endif // _GIT2PP_OID_HPP_
 
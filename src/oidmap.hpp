@@ -0,0 +1,379 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#ifndef _GIT2PP_OIDMAP_HPP_
+#define _GIT2PP_OIDMAP_HPP_
+
+#include <git2.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "oid.hpp"
+
+namespace git2
+{
+
+namespace helper
+{
+
+/**
+ * Value storage of an OIdHashTable, one slot per table bucket.
+ */
+template<class Value>
+class OIdValueStore
+{
+public:
+	void resize(size_t n){_values.clear(); _values.resize(n);}
+	Value& at(size_t n){return _values[n];}
+	const Value& at(size_t n)const{return _values[n];}
+	void move(size_t from, size_t to){_values[to] = std::move(_values[from]); _values[from] = Value();}
+	void moveFrom(OIdValueStore& other, size_t from, size_t to){_values[to] = std::move(other._values[from]);}
+	void reset(size_t n){_values[n] = Value();}
+	void swap(OIdValueStore& other){_values.swap(other._values);}
+private:
+	std::vector<Value> _values;
+};
+
+/**
+ * Sets do not store any value.
+ */
+template<>
+class OIdValueStore<void>
+{
+public:
+	void resize(size_t){}
+	void move(size_t, size_t){}
+	void moveFrom(OIdValueStore&, size_t, size_t){}
+	void reset(size_t){}
+	void swap(OIdValueStore&){}
+};
+
+/**
+ * Open-addressing hash table keyed by object ids.
+ *
+ * Keys are stored as raw git_oid (20 bytes) next to a one byte control
+ * array holding a 7 bits fingerprint of each occupied bucket, so a probe
+ * rarely touches a key that does not match. Buckets are probed linearly
+ * and erasing uses backward shifting, so there are no tombstones.
+ *
+ * Keys are compared on their 20 raw bytes: a shortened OId is looked up
+ * as its zero-padded full value.
+ */
+template<class Value>
+class OIdHashTable
+{
+public:
+	OIdHashTable():_size(0), _mask(0){}
+
+	/**
+	 * Number of elements.
+	 */
+	size_t size()const{return _size;}
+
+	/**
+	 * Check if the table is empty.
+	 */
+	bool empty()const{return _size==0;}
+
+	/**
+	 * Number of buckets.
+	 */
+	size_t bucketCount()const{return _ctrl.size();}
+
+	/**
+	 * Remove all the elements, keeping the allocated buckets.
+	 */
+	void clear()
+	{
+		std::fill(_ctrl.begin(), _ctrl.end(), (uint8_t)0);
+		_values.resize(_ctrl.size());
+		_size = 0;
+	}
+
+	/**
+	 * Allocate enough buckets to hold count elements without rehashing.
+	 */
+	void reserve(size_t count)
+	{
+		size_t cap = 16;
+		while(cap - cap/4 < count)
+			cap *= 2;
+		if(cap > _ctrl.size())
+			rehash(cap);
+	}
+
+	/**
+	 * Check if the table contains the given id.
+	 */
+	bool contains(const OId& oid)const
+	{
+		bool found;
+		lookup(*oid.constData(), found);
+		return found;
+	}
+
+	/**
+	 * Remove the given id from the table.
+	 *
+	 * @return True if the id was present.
+	 */
+	bool erase(const OId& oid)
+	{
+		bool found;
+		size_t slot = lookup(*oid.constData(), found);
+		if(!found)
+			return false;
+
+		// Backward shift the following entries of the cluster.
+		size_t hole = slot;
+		for(size_t next = (hole+1) & _mask; _ctrl[next]!=0; next = (next+1) & _mask)
+		{
+			size_t home = bucketOf(_keys[next]);
+			if(((next - home) & _mask) >= ((next - hole) & _mask))
+			{
+				_ctrl[hole] = _ctrl[next];
+				_keys[hole] = _keys[next];
+				_values.move(next, hole);
+				hole = next;
+			}
+		}
+		_ctrl[hole] = 0;
+		_values.reset(hole);
+		--_size;
+		return true;
+	}
+
+protected:
+	static uint64_t hashOf(const git_oid& id)
+	{
+		uint64_t h;
+		std::memcpy(&h, id.id, sizeof(h));
+		return h;
+	}
+
+	static uint8_t tagOf(const git_oid& id)
+	{
+		return 0x80 | (id.id[8] & 0x7f);
+	}
+
+	size_t bucketOf(const git_oid& id)const
+	{
+		return hashOf(id) & _mask;
+	}
+
+	/**
+	 * Find the bucket of an id, or the empty bucket where it would be inserted.
+	 */
+	size_t lookup(const git_oid& id, bool& found)const
+	{
+		found = false;
+		if(_ctrl.empty())
+			return 0;
+		uint8_t tag = tagOf(id);
+		for(size_t slot = bucketOf(id); ; slot = (slot+1) & _mask)
+		{
+			uint8_t c = _ctrl[slot];
+			if(c==0)
+				return slot;
+			if(c==tag && std::memcmp(_keys[slot].id, id.id, GIT_OID_RAWSZ)==0)
+			{
+				found = true;
+				return slot;
+			}
+		}
+	}
+
+	/**
+	 * Find the bucket of an id, inserting it if not present.
+	 */
+	size_t insertKey(const git_oid& id, bool& inserted)
+	{
+		if(_size+1 > _ctrl.size() - _ctrl.size()/4)
+			rehash(_ctrl.empty() ? 16 : _ctrl.size()*2);
+
+		bool found;
+		size_t slot = lookup(id, found);
+		inserted = !found;
+		if(inserted)
+		{
+			_ctrl[slot] = tagOf(id);
+			_keys[slot] = id;
+			++_size;
+		}
+		return slot;
+	}
+
+	void rehash(size_t cap)
+	{
+		std::vector<uint8_t> ctrl(cap, 0);
+		std::vector<git_oid> keys(cap);
+		OIdValueStore<Value> values;
+		values.resize(cap);
+
+		size_t mask = cap - 1;
+		for(size_t n=0; n<_ctrl.size(); ++n)
+		{
+			if(_ctrl[n]==0)
+				continue;
+			size_t slot = hashOf(_keys[n]) & mask;
+			while(ctrl[slot]!=0)
+				slot = (slot+1) & mask;
+			ctrl[slot] = _ctrl[n];
+			keys[slot] = _keys[n];
+			values.moveFrom(_values, n, slot);
+		}
+
+		_ctrl.swap(ctrl);
+		_keys.swap(keys);
+		_values.swap(values);
+		_mask = mask;
+	}
+
+	template<class Function>
+	void foreachSlot(Function f)const
+	{
+		for(size_t n=0; n<_ctrl.size(); ++n)
+		{
+			if(_ctrl[n]!=0)
+				f(n);
+		}
+	}
+
+	std::vector<uint8_t> _ctrl;
+	std::vector<git_oid> _keys;
+	OIdValueStore<Value> _values;
+	size_t _size;
+	size_t _mask;
+};
+
+} // namespace helper
+
+
+/**
+ * Set of object ids.
+ *
+ * Suited to the seen-sets of history and tree traversals: each element
+ * costs 21 bytes plus the load factor slack, and nothing is allocated per
+ * element.
+ */
+class OIdSet : public helper::OIdHashTable<void>
+{
+public:
+	/**
+	 * Add an id to the set.
+	 *
+	 * @return True if the id was not already in the set.
+	 */
+	bool insert(const OId& oid)
+	{
+		bool inserted;
+		insertKey(*oid.constData(), inserted);
+		return inserted;
+	}
+
+	/**
+	 * Call a function for each id of the set, in unspecified order.
+	 *
+	 * @param f Function called as f(const OId&).
+	 */
+	template<class Function>
+	void foreach(Function f)const
+	{
+		foreachSlot([&](size_t n){f(OId(&_keys[n]));});
+	}
+};
+
+/**
+ * Map from object ids to values.
+ *
+ * Values are stored in a separate array aligned with the buckets, so they
+ * must be default constructible and movable.
+ */
+template<class Value>
+class OIdMap : public helper::OIdHashTable<Value>
+{
+public:
+	/**
+	 * Access the value of an id, inserting a default one if not present.
+	 */
+	Value& operator[](const OId& oid)
+	{
+		bool inserted;
+		return this->_values.at(this->insertKey(*oid.constData(), inserted));
+	}
+
+	/**
+	 * Add an id and its value if the id is not already present.
+	 *
+	 * @return True if inserted, false if the id was already present (its
+	 * value is left unchanged).
+	 */
+	bool insert(const OId& oid, const Value& value)
+	{
+		bool inserted;
+		size_t slot = this->insertKey(*oid.constData(), inserted);
+		if(inserted)
+			this->_values.at(slot) = value;
+		return inserted;
+	}
+
+	/**
+	 * Look up the value of an id.
+	 *
+	 * @return Pointer to the value, or nullptr if not present. The pointer
+	 * is invalidated by the next insertion or erasure.
+	 */
+	Value* find(const OId& oid)
+	{
+		bool found;
+		size_t slot = this->lookup(*oid.constData(), found);
+		return found ? &this->_values.at(slot) : nullptr;
+	}
+
+	const Value* find(const OId& oid)const
+	{
+		bool found;
+		size_t slot = this->lookup(*oid.constData(), found);
+		return found ? &this->_values.at(slot) : nullptr;
+	}
+
+	/**
+	 * Call a function for each entry of the map, in unspecified order.
+	 *
+	 * @param f Function called as f(const OId&, Value&).
+	 */
+	template<class Function>
+	void foreach(Function f)
+	{
+		this->foreachSlot([&](size_t n){f(OId(&this->_keys[n]), this->_values.at(n));});
+	}
+
+	template<class Function>
+	void foreach(Function f)const
+	{
+		this->foreachSlot([&](size_t n){f(OId(&this->_keys[n]), this->_values.at(n));});
+	}
+};
+
+} // namespace git2
+#endif // _GIT2PP_OIDMAP_HPP_
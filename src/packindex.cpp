@@ -0,0 +1,256 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#include "packindex.hpp"
+
+#include "exception.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace git2
+{
+namespace helper
+{
+
+namespace
+{
+
+const int max_alternate_depth = 5;
+const uint32_t pack_index_signature = 0xff744f63; // "\377tOc"
+
+void throw_odb_error(const std::string& msg)
+{
+	giterr_set_str(GITERR_ODB, msg.c_str());
+	throw Exception(GIT_ERROR);
+}
+
+void add_object_dir(const std::string& path, int depth, std::vector<std::string>& dirs)
+{
+	std::string dirPath = path;
+	if(!dirPath.empty() && dirPath[dirPath.size()-1]=='/')
+		dirPath.erase(dirPath.size()-1);
+	if(std::find(dirs.begin(), dirs.end(), dirPath)!=dirs.end())
+		return;
+	dirs.push_back(dirPath);
+	if(depth>=max_alternate_depth)
+		return;
+
+	std::ifstream alternates((dirPath + "/info/alternates").c_str());
+	std::string line;
+	while(std::getline(alternates, line))
+	{
+		if(line.empty() || line[0]=='#')
+			continue;
+		add_object_dir(line[0]=='/' ? line : dirPath + "/" + line, depth+1, dirs);
+	}
+}
+
+/**
+ * Pack indexes of a pack directory, as last listed.
+ */
+struct PackDir
+{
+	time_t mtime;   //!< Modification time of the directory when listed.
+	time_t scanned; //!< Time of the listing.
+	std::vector<std::shared_ptr<const PackIndex>> indexes;
+};
+
+std::mutex pack_dirs_mutex;
+std::map<std::string, PackDir> pack_dirs;
+
+} // namespace
+
+
+std::vector<std::string> list_dir(const std::string& path)
+{
+	std::vector<std::string> names;
+	DIR* dir = ::opendir(path.c_str());
+	if(dir==NULL)
+		return names;
+	while(struct dirent* ent = ::readdir(dir))
+	{
+		if(ent->d_name[0]!='.')
+			names.push_back(ent->d_name);
+	}
+	::closedir(dir);
+	return names;
+}
+
+std::vector<std::string> object_dirs(const std::string& objectsDir)
+{
+	std::vector<std::string> dirs;
+	add_object_dir(objectsDir, 0, dirs);
+	return dirs;
+}
+
+
+//
+// PackIndex
+//
+
+PackIndex::PackIndex(const std::string& path):
+_path(path),
+_packPath(path.substr(0, path.size()-4) + ".pack"),
+_map(MAP_FAILED),
+_size(0)
+{
+	int fd = ::open(path.c_str(), O_RDONLY);
+	struct stat st;
+	if(fd>=0 && ::fstat(fd, &st)==0 && st.st_size>0)
+	{
+		_size = st.st_size;
+		_map = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	if(fd>=0)
+		::close(fd);
+	if(_map==MAP_FAILED)
+		throw_odb_error("cannot read pack index '" + path + "'");
+
+	const unsigned char* data = static_cast<const unsigned char*>(_map);
+	_v2 = _size>=8 && read_be32(data)==pack_index_signature;
+	if(_v2 && read_be32(data+4)!=2)
+	{
+		::munmap(_map, _size);
+		throw_odb_error("unsupported pack index version in '" + path + "'");
+	}
+
+	// Version 2 stores the ids in one sorted table, version 1 in
+	// (offset, id) records.
+	const size_t header = _v2 ? 8 : 0;
+	_stride = _v2 ? GIT_OID_RAWSZ : 4+GIT_OID_RAWSZ;
+	_fanout = data+header;
+	_count = _size>=header+256*4 ? read_be32(_fanout+255*4) : 0;
+	_ids = _fanout+256*4+(_v2 ? 0 : 4);
+	bool valid = _size>=header+256*4 && header+256*4+(uint64_t)_count*(_v2 ? GIT_OID_RAWSZ+4+4 : 4+GIT_OID_RAWSZ)+2*GIT_OID_RAWSZ<=_size;
+	for(int n=0; valid && n<255; ++n)
+		valid = read_be32(_fanout+n*4)<=read_be32(_fanout+(n+1)*4);
+	if(!valid)
+	{
+		::munmap(_map, _size);
+		throw_odb_error("corrupted pack index '" + path + "'");
+	}
+}
+
+PackIndex::~PackIndex()
+{
+	::munmap(_map, _size);
+}
+
+uint64_t PackIndex::offset(size_t pos) const
+{
+	if(!_v2)
+		return read_be32(_ids+pos*_stride-4);
+
+	// Offsets above 2GB are in the table of large offsets.
+	const unsigned char* small = _ids + _count*(GIT_OID_RAWSZ+4);
+	const unsigned char* large = small + _count*4;
+	uint32_t value = read_be32(small+pos*4);
+	if(!(value & 0x80000000))
+		return value;
+	const unsigned char* big = large+(uint64_t)(value & 0x7fffffff)*8;
+	if(big+8>static_cast<const unsigned char*>(_map)+_size-2*GIT_OID_RAWSZ)
+		throw_odb_error("corrupted pack index '" + _path + "'");
+	return read_be64(big);
+}
+
+const unsigned char* PackIndex::packChecksum() const
+{
+	return static_cast<const unsigned char*>(_map)+_size-2*GIT_OID_RAWSZ;
+}
+
+size_t PackIndex::lowerBound(const unsigned char* oid, size_t from) const
+{
+	size_t first = oid[0]==0 ? 0 : read_be32(_fanout+(oid[0]-1)*4);
+	size_t last = read_be32(_fanout+oid[0]*4);
+	first = std::max(first, from);
+	while(first<last)
+	{
+		size_t middle = first + (last-first)/2;
+		if(std::memcmp(id(middle), oid, GIT_OID_RAWSZ)<0)
+			first = middle+1;
+		else
+			last = middle;
+	}
+	return first;
+}
+
+bool PackIndex::find(const git_oid& oid, size_t& pos) const
+{
+	pos = lowerBound(oid.id);
+	return pos<_count && std::memcmp(id(pos), oid.id, GIT_OID_RAWSZ)==0;
+}
+
+
+std::vector<std::shared_ptr<const PackIndex>> pack_indexes(const std::string& objectsDir)
+{
+	std::vector<std::shared_ptr<const PackIndex>> res;
+	std::lock_guard<std::mutex> lock(pack_dirs_mutex);
+	for(const std::string& dir : object_dirs(objectsDir))
+	{
+		const std::string packDir = dir + "/pack/";
+		struct stat st;
+		if(::stat(packDir.c_str(), &st)!=0)
+		{
+			pack_dirs.erase(packDir);
+			continue;
+		}
+
+		// A directory modified during the second of the last listing may
+		// have been updated after it, so it is listed again.
+		PackDir& cached = pack_dirs[packDir];
+		if(cached.indexes.empty() || st.st_mtime!=cached.mtime || st.st_mtime>=cached.scanned)
+		{
+			time_t now = std::time(NULL);
+			std::vector<std::shared_ptr<const PackIndex>> indexes;
+			for(const std::string& name : list_dir(packDir))
+			{
+				struct stat packSt;
+				if(name.size()<4 || name.compare(name.size()-4, 4, ".idx")!=0 ||
+				   ::stat((packDir + name.substr(0, name.size()-4) + ".pack").c_str(), &packSt)!=0)
+					continue;
+
+				// Packs are named after their content, so a known index
+				// is still valid.
+				const std::string path = packDir + name;
+				std::vector<std::shared_ptr<const PackIndex>>::const_iterator known = std::find_if(cached.indexes.begin(), cached.indexes.end(),
+					[&](const std::shared_ptr<const PackIndex>& index){ return index->packPath()==path.substr(0, path.size()-4) + ".pack"; });
+				indexes.push_back(known!=cached.indexes.end() ? *known : std::make_shared<const PackIndex>(path));
+			}
+			cached.indexes.swap(indexes);
+			cached.mtime = st.st_mtime;
+			cached.scanned = now;
+		}
+		res.insert(res.end(), cached.indexes.begin(), cached.indexes.end());
+	}
+	return res;
+}
+
+} // namespace helper
+} // namespace git2
@@ -0,0 +1,162 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#ifndef _GIT2PP_PACKINDEX_HPP_
+#define _GIT2PP_PACKINDEX_HPP_
+
+#include <git2.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace git2
+{
+
+/**
+ * Internal helpers to read the files of an object database directly.
+ */
+namespace helper
+{
+
+inline uint32_t read_be32(const unsigned char* buffer)
+{
+	return ((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) | ((uint32_t)buffer[2] << 8) | (uint32_t)buffer[3];
+}
+
+inline uint64_t read_be64(const unsigned char* buffer)
+{
+	return ((uint64_t)read_be32(buffer) << 32) | read_be32(buffer+4);
+}
+
+inline void write_be32(std::vector<unsigned char>& buffer, uint32_t value)
+{
+	buffer.push_back(value >> 24);
+	buffer.push_back(value >> 16);
+	buffer.push_back(value >> 8);
+	buffer.push_back(value);
+}
+
+inline void write_be64(std::vector<unsigned char>& buffer, uint64_t value)
+{
+	write_be32(buffer, value >> 32);
+	write_be32(buffer, value & 0xffffffff);
+}
+
+/**
+ * List the names of the entries of a directory, except the hidden ones.
+ *
+ * @return The names; empty if the directory cannot be read.
+ */
+std::vector<std::string> list_dir(const std::string& path);
+
+/**
+ * List an objects directory and its alternates, recursively.
+ *
+ * @return The directories, without trailing slash, the given one first.
+ */
+std::vector<std::string> object_dirs(const std::string& objectsDir);
+
+/**
+ * Pack index (.idx file, version 1 or 2) mapped in memory.
+ */
+class PackIndex
+{
+public:
+	/**
+	 * Map a pack index.
+	 *
+	 * @throws Exception if the file cannot be read or is corrupted.
+	 */
+	explicit PackIndex(const std::string& path);
+	~PackIndex();
+
+	PackIndex(const PackIndex&) = delete;
+	PackIndex& operator=(const PackIndex&) = delete;
+
+	/**
+	 * Path of the pack described by the index.
+	 */
+	const std::string& packPath() const {return _packPath;}
+
+	/**
+	 * Number of objects in the pack.
+	 */
+	size_t count() const {return _count;}
+
+	/**
+	 * Raw id of the object at a position, ids being sorted.
+	 */
+	const unsigned char* id(size_t pos) const {return _ids + pos*_stride;}
+
+	/**
+	 * Offset in the pack of the object at a position.
+	 *
+	 * @throws Exception if the index is corrupted.
+	 */
+	uint64_t offset(size_t pos) const;
+
+	/**
+	 * Checksum of the pack, as recorded in the index.
+	 */
+	const unsigned char* packChecksum() const;
+
+	/**
+	 * Position of the first id not lower than oid.
+	 *
+	 * @param from Position known not to be past the result, so that sorted
+	 * ids can be searched in a single forward pass.
+	 */
+	size_t lowerBound(const unsigned char* oid, size_t from = 0) const;
+
+	/**
+	 * Find the position of an object.
+	 *
+	 * @return true if the object is in the pack.
+	 */
+	bool find(const git_oid& oid, size_t& pos) const;
+
+private:
+	std::string _path;
+	std::string _packPath;
+	void* _map;
+	size_t _size;
+	bool _v2;
+	const unsigned char* _fanout;
+	const unsigned char* _ids;
+	size_t _stride;
+	size_t _count;
+};
+
+/**
+ * Get the pack indexes of an objects directory and of its alternates.
+ *
+ * The indexes stay mapped in a cache shared by the whole process, so that
+ * each index is parsed once. A pack directory is listed again only when
+ * it changed, e.g. after a fetch or a repack.
+ *
+ * @throws Exception if a pack index cannot be read.
+ */
+std::vector<std::shared_ptr<const PackIndex>> pack_indexes(const std::string& objectsDir);
+
+} // namespace helper
+
+} // namespace git2
+#endif // _GIT2PP_PACKINDEX_HPP_
@@ -0,0 +1,374 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#include "prefixindex.hpp"
+
+#include "exception.hpp"
+#include "packindex.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <sys/stat.h>
+
+namespace git2
+{
+
+namespace
+{
+
+struct OIdLess
+{
+	bool operator()(const git_oid& a, const git_oid& b) const
+	{
+		return std::memcmp(a.id, b.id, GIT_OID_RAWSZ) < 0;
+	}
+};
+
+bool oid_equal(const git_oid& a, const git_oid& b)
+{
+	return std::memcmp(a.id, b.id, GIT_OID_RAWSZ) == 0;
+}
+
+void sort_unique(std::vector<git_oid>& ids)
+{
+	std::sort(ids.begin(), ids.end(), OIdLess());
+	ids.erase(std::unique(ids.begin(), ids.end(), oid_equal), ids.end());
+}
+
+/**
+ * Number of leading hexadecimal digits shared by two ids.
+ */
+int common_hex_digits(const git_oid& a, const git_oid& b)
+{
+	for(int n=0; n<GIT_OID_RAWSZ; ++n)
+	{
+		unsigned char diff = a.id[n] ^ b.id[n];
+		if(diff!=0)
+			return 2*n + ((diff & 0xf0) ? 0 : 1);
+	}
+	return GIT_OID_HEXSZ;
+}
+
+/**
+ * Check if an id starts with the length first hexadecimal digits of prefix.
+ */
+bool has_prefix(const git_oid& id, const git_oid& prefix, int length)
+{
+	return common_hex_digits(id, prefix) >= length;
+}
+
+bool stat_path(const std::string& path, struct stat& st)
+{
+	return ::stat(path.c_str(), &st) == 0;
+}
+
+void throw_odb_error(const std::string& msg, int err = GIT_ERROR)
+{
+	giterr_set_str(GITERR_ODB, msg.c_str());
+	throw Exception(err);
+}
+
+/**
+ * Append the object ids listed by a pack index.
+ */
+void read_pack_index(const std::string& path, std::vector<git_oid>& ids)
+{
+	helper::PackIndex index(path);
+	size_t first = ids.size();
+	ids.resize(first + index.count());
+	for(size_t n=0; n<index.count(); ++n)
+		std::memcpy(ids[first+n].id, index.id(n), GIT_OID_RAWSZ);
+}
+
+} // namespace
+
+
+OIdPrefixIndex::OIdPrefixIndex():
+_lastScan(0)
+{
+}
+
+OIdPrefixIndex::OIdPrefixIndex(const std::string& objectsDir):
+_lastScan(0)
+{
+	for(const std::string& path : helper::object_dirs(objectsDir))
+	{
+		_dirs.push_back(ObjectDir());
+		_dirs.back().path = path;
+		std::fill(_dirs.back().looseMTime, _dirs.back().looseMTime+256, (time_t)-1);
+	}
+	refresh();
+}
+
+bool OIdPrefixIndex::refreshPacks(ObjectDir& dir, std::vector<git_oid>& added)
+{
+	std::string packDir = dir.path + "/pack/";
+	std::map<std::string, PackState> packs;
+	bool removed = false;
+
+	for(const std::string& name : helper::list_dir(packDir))
+	{
+		if(name.size()<4 || name.compare(name.size()-4, 4, ".idx")!=0)
+			continue;
+		struct stat st;
+		if(!stat_path(packDir + name, st) || !stat_path(packDir + name.substr(0, name.size()-4) + ".pack", st))
+			continue;
+		stat_path(packDir + name, st);
+
+		PackState state = {(int64_t)st.st_size, st.st_mtime};
+		packs[name] = state;
+
+		std::map<std::string, PackState>::const_iterator known = dir.packs.find(name);
+		if(known==dir.packs.end())
+			read_pack_index(packDir + name, added);
+		else if(known->second.size!=state.size || known->second.mtime!=state.mtime)
+			removed = true;
+	}
+
+	for(const std::pair<const std::string, PackState>& known : dir.packs)
+	{
+		if(packs.find(known.first)==packs.end())
+			removed = true;
+	}
+
+	dir.packs.swap(packs);
+	return removed;
+}
+
+bool OIdPrefixIndex::refreshLoose(ObjectDir& dir)
+{
+	static const char hex[] = "0123456789abcdef";
+	bool changed = false;
+
+	for(int n=0; n<256; ++n)
+	{
+		char prefix[3] = {hex[n >> 4], hex[n & 0x0f], 0};
+		std::string path = dir.path + "/" + prefix;
+
+		struct stat st;
+		if(!stat_path(path, st))
+		{
+			changed |= !dir.loose[n].empty();
+			dir.loose[n].clear();
+			dir.looseMTime[n] = -1;
+			continue;
+		}
+
+		// A directory modified during the last scan second may have been
+		// updated after it, so it is scanned again.
+		if(st.st_mtime==dir.looseMTime[n] && st.st_mtime<_lastScan)
+			continue;
+		dir.looseMTime[n] = st.st_mtime;
+
+		std::vector<git_oid> ids;
+		for(const std::string& name : helper::list_dir(path))
+		{
+			if(name.size()!=GIT_OID_HEXSZ-2)
+				continue;
+			std::string str = prefix + name;
+			git_oid oid;
+			if(git_oid_fromstrn(&oid, str.c_str(), str.size())==GIT_OK)
+				ids.push_back(oid);
+			else
+				giterr_clear();
+		}
+		sort_unique(ids);
+
+		if(ids.size()!=dir.loose[n].size() ||
+		   !std::equal(ids.begin(), ids.end(), dir.loose[n].begin(), oid_equal))
+		{
+			dir.loose[n].swap(ids);
+			changed = true;
+		}
+	}
+	return changed;
+}
+
+void OIdPrefixIndex::rebuildPacked()
+{
+	_packed.clear();
+	for(const ObjectDir& dir : _dirs)
+	{
+		for(const std::pair<const std::string, PackState>& pack : dir.packs)
+			read_pack_index(dir.path + "/pack/" + pack.first, _packed);
+	}
+	sort_unique(_packed);
+}
+
+void OIdPrefixIndex::rebuildLoose()
+{
+	_loose.clear();
+	for(const ObjectDir& dir : _dirs)
+	{
+		for(int n=0; n<256; ++n)
+			_loose.insert(_loose.end(), dir.loose[n].begin(), dir.loose[n].end());
+	}
+	sort_unique(_loose);
+}
+
+void OIdPrefixIndex::refresh()
+{
+	time_t now = ::time(NULL);
+
+	std::vector<git_oid> added;
+	bool rebuild = false, looseChanged = false;
+	for(ObjectDir& dir : _dirs)
+	{
+		rebuild |= refreshPacks(dir, added);
+		looseChanged |= refreshLoose(dir);
+	}
+
+	if(rebuild)
+	{
+		rebuildPacked();
+	}
+	else if(!added.empty())
+	{
+		sort_unique(added);
+		std::vector<git_oid> merged;
+		merged.reserve(_packed.size() + added.size());
+		std::merge(_packed.begin(), _packed.end(), added.begin(), added.end(), std::back_inserter(merged), OIdLess());
+		merged.erase(std::unique(merged.begin(), merged.end(), oid_equal), merged.end());
+		_packed.swap(merged);
+	}
+
+	if(looseChanged)
+		rebuildLoose();
+
+	_lastScan = now;
+}
+
+size_t OIdPrefixIndex::size() const
+{
+	// Loose objects may also be packed, count them once.
+	size_t count = _packed.size();
+	for(const git_oid& oid : _loose)
+	{
+		if(!std::binary_search(_packed.begin(), _packed.end(), oid, OIdLess()))
+			++count;
+	}
+	return count;
+}
+
+int OIdPrefixIndex::shortestUniquePrefix(const OId& oid, int minLength) const
+{
+	int length;
+	shortestUniquePrefixes(&oid, 1, &length, minLength);
+	return length;
+}
+
+void OIdPrefixIndex::shortestUniquePrefixes(const OId* oids, size_t count, int* lengths, int minLength) const
+{
+	std::vector<size_t> order(count);
+	for(size_t n=0; n<count; ++n)
+		order[n] = n;
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b){return oids[a] < oids[b];});
+
+	const std::vector<git_oid>* tables[2] = {&_packed, &_loose};
+	std::vector<git_oid>::const_iterator from[2] = {_packed.begin(), _loose.begin()};
+
+	for(size_t idx : order)
+	{
+		const git_oid& id = *oids[idx].constData();
+		int common = 0;
+		for(int t=0; t<2; ++t)
+		{
+			const std::vector<git_oid>& ids = *tables[t];
+			// Queries are sorted, so the search restarts where the last one ended.
+			std::vector<git_oid>::const_iterator it = std::lower_bound(from[t], ids.end(), id, OIdLess());
+			from[t] = it;
+
+			if(it!=ids.begin())
+				common = std::max(common, common_hex_digits(*(it-1), id));
+			if(it!=ids.end() && oid_equal(*it, id))
+				++it;
+			if(it!=ids.end())
+				common = std::max(common, common_hex_digits(*it, id));
+		}
+		lengths[idx] = std::min(std::max(common+1, minLength), (int)GIT_OID_HEXSZ);
+	}
+}
+
+size_t OIdPrefixIndex::countMatches(const std::vector<git_oid>& ids, std::vector<git_oid>::const_iterator& from,
+		const OId& prefix, git_oid* match) const
+{
+	// The trailing bytes of a shortened OId are zero, so it sorts before its matches.
+	from = std::lower_bound(from, ids.end(), *prefix.constData(), OIdLess());
+	std::vector<git_oid>::const_iterator it = from;
+	size_t count = 0;
+	for(; it!=ids.end() && count<2 && has_prefix(*it, *prefix.constData(), prefix.length()); ++it, ++count)
+		match[count] = *it;
+	return count;
+}
+
+OId OIdPrefixIndex::resolve(const OId& prefix) const
+{
+	OId oid;
+	if(resolveMany(&prefix, 1, &oid)==1)
+		return oid;
+
+	if(prefix.length()<GIT_OID_MINPREFIXLEN)
+		throw_odb_error("id prefix is too short", GIT_EAMBIGUOUS);
+
+	git_oid matches[2];
+	std::vector<git_oid>::const_iterator packed = _packed.begin(), loose = _loose.begin();
+	if(countMatches(_packed, packed, prefix, matches)+countMatches(_loose, loose, prefix, matches)==0)
+		throw_odb_error("no match for id prefix " + prefix.format().substr(0, prefix.length()), GIT_ENOTFOUND);
+	throw_odb_error("ambiguous id prefix " + prefix.format().substr(0, prefix.length()), GIT_EAMBIGUOUS);
+	return oid;
+}
+
+size_t OIdPrefixIndex::resolveMany(const OId* prefixes, size_t count, OId* oids) const
+{
+	std::vector<size_t> order(count);
+	for(size_t n=0; n<count; ++n)
+		order[n] = n;
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b){return prefixes[a] < prefixes[b];});
+
+	// Queries are sorted, so the searches restart where the last ones ended.
+	std::vector<git_oid>::const_iterator fromPacked = _packed.begin(), fromLoose = _loose.begin();
+	size_t resolved = 0;
+	for(size_t n : order)
+	{
+		oids[n] = OId();
+		if(prefixes[n].length()<GIT_OID_MINPREFIXLEN)
+			continue;
+
+		git_oid packed[2], loose[2];
+		size_t inPacked = countMatches(_packed, fromPacked, prefixes[n], packed);
+		size_t inLoose  = countMatches(_loose, fromLoose, prefixes[n], loose);
+
+		// An object may be both loose and packed.
+		const git_oid* match = NULL;
+		if(inPacked==1 && (inLoose==0 || (inLoose==1 && oid_equal(packed[0], loose[0]))))
+			match = &packed[0];
+		else if(inPacked==0 && inLoose==1)
+			match = &loose[0];
+
+		if(match!=NULL)
+		{
+			oids[n] = OId(match);
+			++resolved;
+		}
+	}
+	return resolved;
+}
+
+} // namespace git2
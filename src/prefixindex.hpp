@@ -0,0 +1,160 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#ifndef _GIT2PP_PREFIXINDEX_HPP_
+#define _GIT2PP_PREFIXINDEX_HPP_
+
+#include <git2.h>
+
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "oid.hpp"
+
+namespace git2
+{
+
+/**
+ * Sorted index of all the object ids of an object directory, used to
+ * abbreviate and resolve shortened OIds.
+ *
+ * The index is built straight from the pack index (.idx) files
+ * and the loose objects, including the alternates, without inflating any
+ * object. Ids are kept in two sorted arrays: a large one for the packs,
+ * only merged when new packs appear, and a small one for the loose
+ * objects. Each query is a couple of binary searches, i.e. O(log n).
+ *
+ * The index is a snapshot: call refresh() after new objects have been
+ * written, or Database::refresh(OIdPrefixIndex&) to refresh it along with
+ * the object database. Only new packs and the loose object directories
+ * that changed are read again.
+ */
+class OIdPrefixIndex
+{
+public:
+	/**
+	 * Create an empty index.
+	 */
+	OIdPrefixIndex();
+
+	/**
+	 * Build the index of an object directory.
+	 *
+	 * @param objectsDir Path of the "objects" directory of a repository.
+	 * @throws Exception
+	 */
+	explicit OIdPrefixIndex(const std::string& objectsDir);
+
+	/**
+	 * Update the index with the objects added since the last build.
+	 *
+	 * New packs are merged in the index and changed loose object
+	 * directories are scanned again. If a known pack disappeared (e.g.
+	 * after a repack), the pack part is rebuilt.
+	 *
+	 * @throws Exception
+	 */
+	void refresh();
+
+	/**
+	 * Number of distinct object ids in the index.
+	 */
+	size_t size() const;
+
+	/**
+	 * Compute the length of the shortest unique abbreviation of an id.
+	 *
+	 * The id does not need to be in the index: the result is the length
+	 * of the shortest prefix which does not match any other indexed id.
+	 *
+	 * @param oid Full object id.
+	 * @param minLength Minimal length to return, in hexadecimal digits.
+	 * @return Length in hexadecimal digits, between minLength and 40.
+	 */
+	int shortestUniquePrefix(const OId& oid, int minLength = 7) const;
+
+	/**
+	 * Compute the shortest unique abbreviation lengths of many ids.
+	 *
+	 * The ids are processed in sorted order to keep the searches local.
+	 *
+	 * @param oids Array of count full object ids.
+	 * @param count Number of ids.
+	 * @param lengths Array of count ints receiving the lengths.
+	 * @param minLength Minimal length to return, in hexadecimal digits.
+	 */
+	void shortestUniquePrefixes(const OId* oids, size_t count, int* lengths, int minLength = 7) const;
+
+	/**
+	 * Resolve a shortened id to the full id of the object.
+	 *
+	 * @param prefix Shortened id, its length() is the prefix length.
+	 * @return The full object id.
+	 * @throws Exception GIT_ENOTFOUND if no object matches, GIT_EAMBIGUOUS
+	 * if several objects match.
+	 */
+	OId resolve(const OId& prefix) const;
+
+	/**
+	 * Resolve many shortened ids.
+	 *
+	 * The ids are processed in sorted order to keep the searches local.
+	 *
+	 * @param prefixes Array of count shortened ids.
+	 * @param count Number of ids.
+	 * @param oids Array of count ids receiving the full ids; an id which
+	 * does not match exactly one object is set to the null (zero) OId.
+	 * @return Number of resolved ids.
+	 */
+	size_t resolveMany(const OId* prefixes, size_t count, OId* oids) const;
+
+private:
+	struct PackState
+	{
+		int64_t size;
+		time_t mtime;
+	};
+
+	struct ObjectDir
+	{
+		std::string path;
+		std::map<std::string, PackState> packs;
+		std::vector<git_oid> loose[256];
+		time_t looseMTime[256];
+	};
+
+	bool refreshPacks(ObjectDir& dir, std::vector<git_oid>& added);
+	bool refreshLoose(ObjectDir& dir);
+	void rebuildPacked();
+	void rebuildLoose();
+
+	size_t countMatches(const std::vector<git_oid>& ids, std::vector<git_oid>::const_iterator& from,
+		const OId& prefix, git_oid* match) const;
+
+	std::vector<ObjectDir> _dirs;
+	std::vector<git_oid> _packed;
+	std::vector<git_oid> _loose;
+	time_t _lastScan;
+};
+
+} // namespace git2
+#endif // _GIT2PP_PREFIXINDEX_HPP_
@@ -0,0 +1,766 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#include "reachability.hpp"
+
+#include "commit.hpp"
+#include "exception.hpp"
+#include "packindex.hpp"
+#include "tree.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace git2
+{
+
+namespace
+{
+
+const uint32_t no_position = 0xffffffff;
+const uint64_t ewah_run_max = 0xffffffffULL;
+const uint64_t ewah_literal_max = 0x7fffffffULL;
+
+const uint32_t bitmap_signature = 0x4249544d; // "BITM"
+const uint16_t bitmap_full_dag  = 0x1;
+
+using helper::read_be32;
+using helper::read_be64;
+using helper::write_be32;
+
+void throw_bitmap_error(const std::string& msg, int err = GIT_ERROR)
+{
+	giterr_set_str(GITERR_ODB, msg.c_str());
+	throw Exception(err);
+}
+
+size_t popcount(uint64_t word)
+{
+	return __builtin_popcountll(word);
+}
+
+size_t words_for(size_t bits)
+{
+	return (bits+63)/64;
+}
+
+int type_index(git_otype type)
+{
+	switch(type)
+	{
+	case GIT_OBJ_COMMIT: return 0;
+	case GIT_OBJ_TREE:   return 1;
+	case GIT_OBJ_BLOB:   return 2;
+	case GIT_OBJ_TAG:    return 3;
+	default:             return -1;
+	}
+}
+
+bool read_file(const std::string& path, std::vector<unsigned char>& data)
+{
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if(!file)
+		return false;
+	data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	return true;
+}
+
+} // namespace
+
+
+//
+// EwahBitmap
+//
+
+EwahBitmap::EwahBitmap():
+_bitSize(0)
+{
+}
+
+EwahBitmap::EwahBitmap(const std::vector<uint64_t>& words, size_t bitSize):
+_bitSize(bitSize)
+{
+	size_t count = std::min(words.size(), words_for(bitSize));
+	size_t n = 0;
+	while(n<count)
+	{
+		size_t marker = _buffer.size();
+		_buffer.push_back(0);
+
+		uint64_t run = 0;
+		bool bit = words[n]==~0ULL;
+		if(words[n]==0 || bit)
+		{
+			uint64_t clean = bit ? ~0ULL : 0;
+			while(n<count && words[n]==clean && run<ewah_run_max)
+			{
+				++run;
+				++n;
+			}
+		}
+
+		uint64_t literals = 0;
+		while(n<count && words[n]!=0 && words[n]!=~0ULL && literals<ewah_literal_max)
+		{
+			_buffer.push_back(words[n]);
+			++literals;
+			++n;
+		}
+
+		_buffer[marker] = (bit ? 1 : 0) | (run << 1) | (literals << 33);
+	}
+}
+
+EwahBitmap EwahBitmap::read(const unsigned char* data, size_t size, size_t& used)
+{
+	if(size<8)
+		throw_bitmap_error("truncated EWAH bitmap");
+	EwahBitmap bitmap;
+	bitmap._bitSize = read_be32(data);
+	size_t count = read_be32(data+4);
+	if(size<8+count*8+4)
+		throw_bitmap_error("truncated EWAH bitmap");
+
+	bitmap._buffer.resize(count);
+	for(size_t n=0; n<count; ++n)
+		bitmap._buffer[n] = read_be64(data+8+n*8);
+
+	// Check the markers, so that iterating never leaves the buffer.
+	for(size_t n=0; n<count; )
+	{
+		uint64_t literals = bitmap._buffer[n] >> 33;
+		if(literals > count-n-1)
+			throw_bitmap_error("invalid EWAH bitmap");
+		n += 1+literals;
+	}
+
+	// The trailing position of the last marker is not needed.
+	used = 8+count*8+4;
+	return bitmap;
+}
+
+void EwahBitmap::write(std::vector<unsigned char>& out) const
+{
+	write_be32(out, _bitSize);
+	write_be32(out, _buffer.size());
+	size_t last = 0;
+	for(size_t n=0; n<_buffer.size(); n += 1+(_buffer[n] >> 33))
+		last = n;
+	for(uint64_t word : _buffer)
+	{
+		write_be32(out, word >> 32);
+		write_be32(out, word & 0xffffffff);
+	}
+	write_be32(out, last);
+}
+
+/**
+ * Call f(first, count, clean, literal) for each sequence of words: either
+ * count clean words (all bits equal to clean), or count literal words
+ * starting at literal.
+ */
+template<class Function>
+void EwahBitmap::foreachWord(Function f) const
+{
+	size_t word = 0;
+	for(size_t n=0; n<_buffer.size(); )
+	{
+		uint64_t marker = _buffer[n++];
+		uint64_t run = (marker >> 1) & ewah_run_max;
+		uint64_t literals = marker >> 33;
+		if(run>0)
+		{
+			if(!f(word, run, (marker & 1) ? ~0ULL : 0, (const uint64_t*)nullptr))
+				return;
+			word += run;
+		}
+		if(literals>0)
+		{
+			if(!f(word, literals, 0, &_buffer[n]))
+				return;
+			word += literals;
+			n += literals;
+		}
+	}
+}
+
+bool EwahBitmap::test(size_t bit) const
+{
+	if(bit>=_bitSize)
+		return false;
+	size_t target = bit/64;
+	bool res = false;
+	foreachWord([&](size_t first, size_t count, uint64_t clean, const uint64_t* literal){
+		if(target>=first+count)
+			return true;
+		uint64_t word = literal!=nullptr ? literal[target-first] : clean;
+		res = (word >> (bit%64)) & 1;
+		return false;
+	});
+	return res;
+}
+
+size_t EwahBitmap::count() const
+{
+	// Ignore the bits past the bit size in the last word.
+	size_t words = words_for(_bitSize);
+	uint64_t lastMask = _bitSize%64 ? (1ULL << (_bitSize%64))-1 : ~0ULL;
+	size_t res = 0;
+	foreachWord([&](size_t first, size_t count, uint64_t clean, const uint64_t* literal){
+		for(size_t n=0; n<count && first+n<words; ++n)
+		{
+			uint64_t word = literal!=nullptr ? literal[n] : clean;
+			res += popcount(first+n+1==words ? word & lastMask : word);
+		}
+		return first+count<words;
+	});
+	return res;
+}
+
+void EwahBitmap::orInto(std::vector<uint64_t>& words) const
+{
+	if(words.size()<words_for(_bitSize))
+		words.resize(words_for(_bitSize), 0);
+	size_t limit = words.size();
+	foreachWord([&](size_t first, size_t count, uint64_t clean, const uint64_t* literal){
+		for(size_t n=0; n<count && first+n<limit; ++n)
+			words[first+n] |= literal!=nullptr ? literal[n] : clean;
+		return true;
+	});
+}
+
+void EwahBitmap::xorInto(std::vector<uint64_t>& words) const
+{
+	if(words.size()<words_for(_bitSize))
+		words.resize(words_for(_bitSize), 0);
+	size_t limit = words.size();
+	foreachWord([&](size_t first, size_t count, uint64_t clean, const uint64_t* literal){
+		for(size_t n=0; n<count && first+n<limit; ++n)
+			words[first+n] ^= literal!=nullptr ? literal[n] : clean;
+		return true;
+	});
+}
+
+std::vector<uint64_t> EwahBitmap::decompress() const
+{
+	std::vector<uint64_t> words(words_for(_bitSize), 0);
+	orInto(words);
+	return words;
+}
+
+
+//
+// ReachableObjects::Storage
+//
+
+/**
+ * Objects known to a ReachabilityIndex and the bitmaps of the commits.
+ *
+ * Pack objects come first, in pack order as Git's bitmaps require, then
+ * the objects added when building bitmaps.
+ */
+struct ReachableObjects::Storage
+{
+	struct Entry
+	{
+		EwahBitmap bitmap;
+		uint32_t xorBase; //!< Entry the bitmap is XORed with, or no_position.
+	};
+
+	size_t size() const
+	{
+		return packed.size() + added.size();
+	}
+
+	uint32_t position(const git_oid& oid) const
+	{
+		std::vector<git_oid>::const_iterator it = std::lower_bound(packed.begin(), packed.end(), oid,
+			[](const git_oid& a, const git_oid& b){return std::memcmp(a.id, b.id, GIT_OID_RAWSZ) < 0;});
+		if(it!=packed.end() && std::memcmp(it->id, oid.id, GIT_OID_RAWSZ)==0)
+			return packedPosition[it-packed.begin()];
+		const uint32_t* pos = addedPosition.find(OId(&oid));
+		return pos!=nullptr ? *pos : no_position;
+	}
+
+	const git_oid& oidAt(uint32_t pos) const
+	{
+		return pos<packed.size() ? packed[packedAt[pos]] : added[pos-packed.size()];
+	}
+
+	uint32_t add(const git_oid& oid, git_otype type)
+	{
+		uint32_t pos = size();
+		added.push_back(oid);
+		addedPosition.insert(OId(&oid), pos);
+		int index = type_index(type);
+		if(index>=0)
+		{
+			if(types[index].size()<=pos/64)
+				types[index].resize(pos/64+1, 0);
+			types[index][pos/64] |= 1ULL << (pos%64);
+		}
+		return pos;
+	}
+
+	bool test(uint32_t entry, uint32_t bit) const
+	{
+		bool res = false;
+		for(; entry!=no_position; entry = entries[entry].xorBase)
+			res ^= entries[entry].bitmap.test(bit);
+		return res;
+	}
+
+	void orEntry(uint32_t entry, std::vector<uint64_t>& words) const
+	{
+		if(entries[entry].xorBase==no_position)
+		{
+			entries[entry].bitmap.orInto(words);
+			return;
+		}
+		std::vector<uint64_t> plain;
+		decompress(entry, plain);
+		if(words.size()<plain.size())
+			words.resize(plain.size(), 0);
+		for(size_t n=0; n<plain.size(); ++n)
+			words[n] |= plain[n];
+	}
+
+	void decompress(uint32_t entry, std::vector<uint64_t>& words) const
+	{
+		words.assign(words_for(size()), 0);
+		for(; entry!=no_position; entry = entries[entry].xorBase)
+			entries[entry].bitmap.xorInto(words);
+	}
+
+	std::vector<git_oid> packed;           //!< Pack objects, sorted.
+	std::vector<uint32_t> packedPosition;  //!< Bit position of each sorted pack object.
+	std::vector<uint32_t> packedAt;        //!< Sorted index of each pack position.
+	std::vector<git_oid> added;
+	OIdMap<uint32_t> addedPosition;
+	std::vector<uint64_t> types[4];        //!< Commits, trees, blobs and tags.
+
+	std::vector<Entry> entries;
+	OIdMap<uint32_t> entryOf;              //!< Entry of each commit with a bitmap.
+};
+
+
+namespace
+{
+
+typedef ReachableObjects::Storage Storage;
+
+/**
+ * Collect the objects reachable from commits into a plain bitmap, using
+ * the bitmaps of the commits met on the way.
+ */
+class ObjectWalker
+{
+public:
+	/**
+	 * @param storage Known objects and bitmaps.
+	 * @param growing When not null (and equal to storage), unknown objects
+	 * are added to it, otherwise they are collected in extra.
+	 */
+	ObjectWalker(const Storage& storage, Storage* growing, git_repository* repo, std::vector<uint64_t>& bits, OIdMap<git_otype>& extra):
+	_storage(storage),
+	_growing(growing),
+	_repo(repo),
+	_bits(bits),
+	_extra(extra)
+	{
+	}
+
+	void walk(const git_oid& tip)
+	{
+		std::vector<git_oid> commits(1, tip);
+		while(!commits.empty())
+		{
+			git_oid id = commits.back();
+			commits.pop_back();
+			if(isMarked(id))
+				continue;
+
+			if(const uint32_t* entry = _storage.entryOf.find(OId(&id)))
+			{
+				_storage.orEntry(*entry, _bits);
+				continue;
+			}
+
+			git_commit* commit;
+			Exception::git2_assert(git_commit_lookup(&commit, _repo, &id));
+			Commit owner(commit);
+			mark(id, GIT_OBJ_COMMIT);
+			for(unsigned int n=0; n<git_commit_parentcount(commit); ++n)
+				commits.push_back(*git_commit_parent_id(commit, n));
+			walkTree(*git_commit_tree_id(commit));
+		}
+	}
+
+private:
+	void walkTree(const git_oid& root)
+	{
+		std::vector<git_oid> trees(1, root);
+		while(!trees.empty())
+		{
+			git_oid id = trees.back();
+			trees.pop_back();
+			// A marked tree has all its content marked.
+			if(!mark(id, GIT_OBJ_TREE))
+				continue;
+
+			git_tree* tree;
+			Exception::git2_assert(git_tree_lookup(&tree, _repo, &id));
+			Tree owner(tree);
+			for(size_t n=0; n<git_tree_entrycount(tree); ++n)
+			{
+				const git_tree_entry* entry = git_tree_entry_byindex(tree, n);
+				git_otype type = git_tree_entry_type(entry);
+				if(type==GIT_OBJ_TREE)
+					trees.push_back(*git_tree_entry_id(entry));
+				else if(type==GIT_OBJ_BLOB)
+					mark(*git_tree_entry_id(entry), GIT_OBJ_BLOB);
+				// Submodule commits are not in the repository.
+			}
+		}
+	}
+
+	bool isMarked(const git_oid& id) const
+	{
+		uint32_t pos = _storage.position(id);
+		if(pos!=no_position)
+			return pos/64<_bits.size() && ((_bits[pos/64] >> (pos%64)) & 1);
+		return _extra.contains(OId(&id));
+	}
+
+	/**
+	 * @return True if the object was not marked yet.
+	 */
+	bool mark(const git_oid& id, git_otype type)
+	{
+		uint32_t pos = _storage.position(id);
+		if(pos==no_position && _growing!=nullptr)
+			pos = _growing->add(id, type);
+		if(pos==no_position)
+			return _extra.insert(OId(&id), type);
+
+		if(_bits.size()<=pos/64)
+			_bits.resize(pos/64+1, 0);
+		uint64_t mask = 1ULL << (pos%64);
+		if(_bits[pos/64] & mask)
+			return false;
+		_bits[pos/64] |= mask;
+		return true;
+	}
+
+	const Storage& _storage;
+	Storage* _growing;
+	git_repository* _repo;
+	std::vector<uint64_t>& _bits;
+	OIdMap<git_otype>& _extra;
+};
+
+/**
+ * Read the object ids and pack offsets of a pack index.
+ */
+void read_pack_index(const std::string& path, std::vector<git_oid>& oids, std::vector<uint64_t>& offsets, unsigned char* checksum)
+{
+	helper::PackIndex index(path);
+	oids.resize(index.count());
+	offsets.resize(index.count());
+	for(size_t n=0; n<index.count(); ++n)
+	{
+		std::memcpy(oids[n].id, index.id(n), GIT_OID_RAWSZ);
+		offsets[n] = index.offset(n);
+	}
+	std::memcpy(checksum, index.packChecksum(), GIT_OID_RAWSZ);
+}
+
+} // namespace
+
+
+//
+// ReachableObjects
+//
+
+ReachableObjects::ReachableObjects()
+{
+}
+
+bool ReachableObjects::contains(const OId& oid) const
+{
+	uint32_t pos = _storage ? _storage->position(*oid.constData()) : no_position;
+	if(pos!=no_position)
+		return pos/64<_bits.size() && ((_bits[pos/64] >> (pos%64)) & 1);
+	return _extra.contains(oid);
+}
+
+size_t ReachableObjects::count() const
+{
+	size_t res = _extra.size();
+	for(uint64_t word : _bits)
+		res += popcount(word);
+	return res;
+}
+
+size_t ReachableObjects::count(git_otype type) const
+{
+	int index = type_index(type);
+	if(index<0)
+		return 0;
+
+	size_t res = 0;
+	if(_storage)
+	{
+		const std::vector<uint64_t>& types = _storage->types[index];
+		for(size_t n=0; n<_bits.size() && n<types.size(); ++n)
+			res += popcount(_bits[n] & types[n]);
+	}
+	_extra.foreach([&](const OId&, const git_otype& t){
+		if(t==type)
+			++res;
+	});
+	return res;
+}
+
+std::vector<OId> ReachableObjects::objects() const
+{
+	std::vector<OId> res;
+	res.reserve(count());
+	for(size_t n=0; n<_bits.size(); ++n)
+	{
+		for(uint64_t word = _bits[n]; word!=0; word &= word-1)
+			res.push_back(OId(&_storage->oidAt(n*64 + __builtin_ctzll(word))));
+	}
+	_extra.foreach([&](const OId& oid, const git_otype&){
+		res.push_back(oid);
+	});
+	return res;
+}
+
+ReachableObjects ReachableObjects::operator|(const ReachableObjects& other) const
+{
+	ReachableObjects res(*this);
+	if(!res._storage)
+		res._storage = other._storage;
+	if(res._bits.size()<other._bits.size())
+		res._bits.resize(other._bits.size(), 0);
+	for(size_t n=0; n<other._bits.size(); ++n)
+		res._bits[n] |= other._bits[n];
+	other._extra.foreach([&](const OId& oid, const git_otype& type){
+		res._extra.insert(oid, type);
+	});
+	return res;
+}
+
+ReachableObjects ReachableObjects::operator&(const ReachableObjects& other) const
+{
+	ReachableObjects res;
+	res._storage = _storage ? _storage : other._storage;
+	res._bits.resize(std::min(_bits.size(), other._bits.size()));
+	for(size_t n=0; n<res._bits.size(); ++n)
+		res._bits[n] = _bits[n] & other._bits[n];
+	_extra.foreach([&](const OId& oid, const git_otype& type){
+		if(other._extra.contains(oid))
+			res._extra.insert(oid, type);
+	});
+	return res;
+}
+
+ReachableObjects ReachableObjects::operator-(const ReachableObjects& other) const
+{
+	ReachableObjects res;
+	res._storage = _storage ? _storage : other._storage;
+	res._bits = _bits;
+	for(size_t n=0; n<res._bits.size() && n<other._bits.size(); ++n)
+		res._bits[n] &= ~other._bits[n];
+	_extra.foreach([&](const OId& oid, const git_otype& type){
+		if(!other._extra.contains(oid))
+			res._extra.insert(oid, type);
+	});
+	return res;
+}
+
+
+//
+// ReachabilityIndex
+//
+
+ReachabilityIndex::ReachabilityIndex():
+_storage(std::make_shared<Storage>())
+{
+}
+
+ReachabilityIndex::ReachabilityIndex(const Repository& repo, std::shared_ptr<const Storage> storage):
+_repo(repo),
+_storage(storage)
+{
+}
+
+ReachabilityIndex ReachabilityIndex::open(const Repository& repo)
+{
+	std::string packDir = repo.path() + "objects/pack/";
+	std::string name;
+	for(const std::string& file : helper::list_dir(packDir))
+	{
+		// Multi-pack index bitmaps are not supported.
+		if(file.compare(0, 5, "pack-")==0 && file.size()>7 && file.compare(file.size()-7, 7, ".bitmap")==0)
+		{
+			name = file.substr(0, file.size()-7);
+			break;
+		}
+	}
+	if(name.empty())
+		throw_bitmap_error("no pack bitmap found", GIT_ENOTFOUND);
+
+	std::shared_ptr<Storage> storage = std::make_shared<Storage>();
+
+	// Bitmaps index objects by their position in the pack.
+	std::vector<uint64_t> offsets;
+	unsigned char packChecksum[GIT_OID_RAWSZ];
+	read_pack_index(packDir + name + ".idx", storage->packed, offsets, packChecksum);
+	size_t count = storage->packed.size();
+	storage->packedAt.resize(count);
+	for(size_t n=0; n<count; ++n)
+		storage->packedAt[n] = n;
+	std::sort(storage->packedAt.begin(), storage->packedAt.end(), [&](uint32_t a, uint32_t b){return offsets[a]<offsets[b];});
+	storage->packedPosition.resize(count);
+	for(size_t n=0; n<count; ++n)
+		storage->packedPosition[storage->packedAt[n]] = n;
+
+	std::string path = packDir + name + ".bitmap";
+	std::vector<unsigned char> data;
+	if(!read_file(path, data))
+		throw_bitmap_error("cannot read bitmap '" + path + "'");
+	if(data.size()<32 || read_be32(data.data())!=bitmap_signature || data[4]!=0 || data[5]!=1)
+		throw_bitmap_error("unsupported bitmap '" + path + "'");
+	if(!(((data[6] << 8) | data[7]) & bitmap_full_dag))
+		throw_bitmap_error("bitmap '" + path + "' does not cover the full history");
+	if(std::memcmp(data.data()+12, packChecksum, GIT_OID_RAWSZ)!=0)
+		throw_bitmap_error("bitmap '" + path + "' does not match its pack");
+
+	size_t entries = read_be32(data.data()+8);
+	size_t offset = 32, used;
+	for(int n=0; n<4; ++n)
+	{
+		storage->types[n] = EwahBitmap::read(data.data()+offset, data.size()-offset, used).decompress();
+		storage->types[n].resize(words_for(count), 0);
+		offset += used;
+	}
+
+	storage->entries.resize(entries);
+	for(size_t n=0; n<entries; ++n)
+	{
+		if(data.size()-offset<6)
+			throw_bitmap_error("truncated bitmap '" + path + "'");
+		uint32_t commit = read_be32(data.data()+offset);
+		size_t xorOffset = data[offset+4];
+		offset += 6;
+		if(commit>=count || xorOffset>n)
+			throw_bitmap_error("invalid bitmap '" + path + "'");
+
+		Storage::Entry& entry = storage->entries[n];
+		entry.bitmap = EwahBitmap::read(data.data()+offset, data.size()-offset, used);
+		entry.xorBase = xorOffset>0 ? n-xorOffset : no_position;
+		offset += used;
+		storage->entryOf.insert(OId(&storage->packed[commit]), n);
+	}
+
+	return ReachabilityIndex(repo, storage);
+}
+
+ReachabilityIndex ReachabilityIndex::build(const Repository& repo, const std::vector<OId>& tips)
+{
+	std::shared_ptr<Storage> storage = std::make_shared<Storage>();
+	for(const OId& tip : tips)
+	{
+		if(storage->entryOf.contains(tip))
+			continue;
+
+		std::vector<uint64_t> bits;
+		OIdMap<git_otype> extra;
+		ObjectWalker walker(*storage, storage.get(), repo.data(), bits, extra);
+		walker.walk(*tip.constData());
+
+		Storage::Entry entry;
+		entry.bitmap = EwahBitmap(bits, storage->size());
+		entry.xorBase = no_position;
+		storage->entries.push_back(entry);
+		storage->entryOf.insert(tip, storage->entries.size()-1);
+	}
+	return ReachabilityIndex(repo, storage);
+}
+
+size_t ReachabilityIndex::objectCount() const
+{
+	return _storage->size();
+}
+
+size_t ReachabilityIndex::bitmapCount() const
+{
+	return _storage->entries.size();
+}
+
+bool ReachabilityIndex::hasBitmap(const OId& commit) const
+{
+	return _storage->entryOf.contains(commit);
+}
+
+ReachableObjects ReachabilityIndex::reachable(const OId& tip) const
+{
+	ReachableObjects res;
+	res._storage = _storage;
+	if(const uint32_t* entry = _storage->entryOf.find(tip))
+	{
+		_storage->decompress(*entry, res._bits);
+		return res;
+	}
+
+	ObjectWalker walker(*_storage, nullptr, _repo.data(), res._bits, res._extra);
+	walker.walk(*tip.constData());
+	return res;
+}
+
+bool ReachabilityIndex::contains(const OId& tip, const OId& object) const
+{
+	if(const uint32_t* entry = _storage->entryOf.find(tip))
+	{
+		// A bitmap covers all the objects reachable from its commit.
+		uint32_t pos = _storage->position(*object.constData());
+		return pos!=no_position && _storage->test(*entry, pos);
+	}
+	return reachable(tip).contains(object);
+}
+
+size_t ReachabilityIndex::countReachable(const OId& tip) const
+{
+	const uint32_t* entry = _storage->entryOf.find(tip);
+	if(entry!=nullptr && _storage->entries[*entry].xorBase==no_position)
+		return _storage->entries[*entry].bitmap.count();
+	return reachable(tip).count();
+}
+
+ReachableObjects ReachabilityIndex::difference(const OId& tip, const OId& excluded) const
+{
+	return reachable(tip) - reachable(excluded);
+}
+
+} // namespace git2
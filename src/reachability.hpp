@@ -0,0 +1,266 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#ifndef _GIT2PP_REACHABILITY_HPP_
+#define _GIT2PP_REACHABILITY_HPP_
+
+#include <git2.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "oid.hpp"
+#include "oidmap.hpp"
+#include "repository.hpp"
+
+namespace git2
+{
+
+/**
+ * Bitmap compressed with EWAH (Enhanced Word-Aligned Hybrid), the
+ * compression used by Git's .bitmap files.
+ *
+ * The bitmap is a sequence of marker words, each one followed by literal
+ * words. A marker tells how many 64-bit words of only zeros or only ones
+ * come next, then how many literal words follow it.
+ */
+class EwahBitmap
+{
+public:
+	EwahBitmap();
+
+	/**
+	 * Compress a plain bitmap.
+	 *
+	 * @param words Plain bitmap, bit n being bit n%64 of word n/64.
+	 * @param bitSize Number of significant bits.
+	 */
+	EwahBitmap(const std::vector<uint64_t>& words, size_t bitSize);
+
+	/**
+	 * Read a bitmap serialized in Git's format (big-endian).
+	 *
+	 * @param data Serialized bitmap.
+	 * @param size Available bytes.
+	 * @param used Receives the number of bytes read.
+	 * @throws Exception if the data is truncated or invalid.
+	 */
+	static EwahBitmap read(const unsigned char* data, size_t size, size_t& used);
+
+	/**
+	 * Serialize the bitmap in Git's format.
+	 */
+	void write(std::vector<unsigned char>& out) const;
+
+	/**
+	 * Number of significant bits.
+	 */
+	size_t bitSize() const {return _bitSize;}
+
+	/**
+	 * Size of the compressed bitmap, in 64-bit words.
+	 */
+	size_t compressedWords() const {return _buffer.size();}
+
+	/**
+	 * Check if a bit is set, without decompressing the bitmap.
+	 */
+	bool test(size_t bit) const;
+
+	/**
+	 * Count the set bits, without decompressing the bitmap.
+	 */
+	size_t count() const;
+
+	/**
+	 * OR the bitmap into a plain one, which grows if needed.
+	 */
+	void orInto(std::vector<uint64_t>& words) const;
+
+	/**
+	 * XOR the bitmap into a plain one, which grows if needed.
+	 */
+	void xorInto(std::vector<uint64_t>& words) const;
+
+	/**
+	 * Decompress into a plain bitmap.
+	 */
+	std::vector<uint64_t> decompress() const;
+
+private:
+	template<class Function>
+	void foreachWord(Function f) const;
+
+	std::vector<uint64_t> _buffer;
+	size_t _bitSize;
+};
+
+
+/**
+ * Set of objects, typically the objects reachable from a commit, as
+ * computed by ReachabilityIndex.
+ *
+ * The objects known to the index are stored as a plain bitmap, so set
+ * operations are word-wise bit operations. Objects unknown to the index
+ * (written after it) are stored apart.
+ */
+class ReachableObjects
+{
+public:
+	ReachableObjects();
+
+	/**
+	 * Check if an object is in the set.
+	 */
+	bool contains(const OId& oid) const;
+
+	/**
+	 * Number of objects in the set.
+	 */
+	size_t count() const;
+
+	/**
+	 * Number of objects of a given type in the set.
+	 */
+	size_t count(git_otype type) const;
+
+	/**
+	 * List the objects of the set.
+	 */
+	std::vector<OId> objects() const;
+
+	/**
+	 * Union, intersection and difference of two sets of the same index.
+	 */
+	ReachableObjects operator|(const ReachableObjects& other) const;
+	ReachableObjects operator&(const ReachableObjects& other) const;
+	ReachableObjects operator-(const ReachableObjects& other) const;
+
+	struct Storage;
+
+private:
+	friend class ReachabilityIndex;
+
+	std::shared_ptr<const Storage> _storage;
+	std::vector<uint64_t> _bits;
+	OIdMap<git_otype> _extra; //!< Objects which are not in the index, with their type.
+};
+
+
+/**
+ * Reachability bitmaps: for some commits, the set of all the objects
+ * (commits, trees, blobs and tags) reachable from them.
+ *
+ * The bitmaps are either read from the .bitmap file Git writes next to a
+ * pack (`git repack -adb`), or built in memory for selected tips.
+ *
+ * Queries on a commit with a bitmap are bit operations. For other
+ * commits, the history is walked down to the commits with a bitmap,
+ * whose bitmaps are then merged.
+ *
+ * A ReachabilityIndex is immutable and can be used from several threads
+ * at once, as long as the repository itself is.
+ */
+class ReachabilityIndex
+{
+public:
+	/**
+	 * Create an empty index, with which every query walks the history.
+	 */
+	ReachabilityIndex();
+
+	/**
+	 * Load the reachability bitmap of the packs of a repository.
+	 *
+	 * @throws Exception GIT_ENOTFOUND if no pack has a bitmap.
+	 */
+	static ReachabilityIndex open(const Repository& repo);
+
+	/**
+	 * Build the reachability bitmaps of some commits.
+	 *
+	 * The tips are processed in order and each one reuses the bitmaps of
+	 * the previous ones, so give the oldest tips first.
+	 *
+	 * @param repo Repository of the commits.
+	 * @param tips Commits to build a bitmap for.
+	 * @throws Exception
+	 */
+	static ReachabilityIndex build(const Repository& repo, const std::vector<OId>& tips);
+
+	/**
+	 * Number of objects known to the index.
+	 */
+	size_t objectCount() const;
+
+	/**
+	 * Number of commits with a bitmap.
+	 */
+	size_t bitmapCount() const;
+
+	/**
+	 * Check if a commit has a bitmap.
+	 */
+	bool hasBitmap(const OId& commit) const;
+
+	/**
+	 * Compute the set of objects reachable from a commit.
+	 *
+	 * @throws Exception
+	 */
+	ReachableObjects reachable(const OId& tip) const;
+
+	/**
+	 * Check if an object is reachable from a commit, e.g. if a commit is
+	 * contained in a release branch.
+	 *
+	 * When the tip has a bitmap, this tests one bit of it.
+	 *
+	 * @throws Exception
+	 */
+	bool contains(const OId& tip, const OId& object) const;
+
+	/**
+	 * Count the objects reachable from a commit, like
+	 * `git rev-list --objects --count`.
+	 *
+	 * @throws Exception
+	 */
+	size_t countReachable(const OId& tip) const;
+
+	/**
+	 * Compute the objects reachable from a commit and not from another one,
+	 * like `git rev-list --objects excluded..tip`.
+	 *
+	 * @throws Exception
+	 */
+	ReachableObjects difference(const OId& tip, const OId& excluded) const;
+
+private:
+	typedef ReachableObjects::Storage Storage;
+
+	ReachabilityIndex(const Repository& repo, std::shared_ptr<const Storage> storage);
+
+	Repository _repo;
+	std::shared_ptr<const Storage> _storage;
+};
+
+} // namespace git2
+#endif // _GIT2PP_REACHABILITY_HPP_
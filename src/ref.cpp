@@ -37,7 +37,7 @@ _Class(ref)
 }
 
 Reference::Reference(const Reference& other):
-_Class(other.data())
+_Class(other)
 {
 }
 
@@ -78,7 +78,12 @@ bool Reference::isRemote() const
 
 std::string Reference::name() const
 {
-    return std::string(git_reference_name(data()));
+    return nameView().str();
+}
+
+StringView Reference::nameView() const
+{
+    return StringView(git_reference_name(data()));
 }
 
 std::string Reference::symbolicTarget()const
@@ -183,7 +188,7 @@ _Class(reflog)
 }
 
 RefLog::RefLog(const RefLog& other):
-_Class(other.data())
+_Class(other)
 {
 }
 
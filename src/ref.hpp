@@ -25,6 +25,7 @@
 #include <memory>
 
 #include "common.hpp"
+#include "stringview.hpp"
 
 
 namespace git2
@@ -54,6 +55,14 @@ public:
 	 */
 	Reference(const Reference& other);
 
+	/**
+	 * Move constructor; takes over the underlaying data structure.
+	 */
+	Reference(Reference&& other) = default;
+
+	Reference& operator=(const Reference& other) = default;
+	Reference& operator=(Reference&& other) = default;
+
 	/**
 	 * Get the OID pointed to by a reference.
 	 *
@@ -76,6 +85,13 @@ public:
 	 */
 	std::string name() const;
 
+	/**
+	 * Get the full name of a reference without copying it.
+	 *
+	 * The view is valid as long as the reference object is alive.
+	 */
+	StringView nameView() const;
+
 	/**
 	 * Get full name to the reference pointed to by a symbolic reference.
 	 *
@@ -289,6 +305,14 @@ public:
 	 */
 	RefLog(const RefLog& other);
 
+	/**
+	 * Move constructor; takes over the underlaying data structure.
+	 */
+	RefLog(RefLog&& other) = default;
+
+	RefLog& operator=(const RefLog& other) = default;
+	RefLog& operator=(RefLog&& other) = default;
+
 	/**
 	 * Destructor.
 	 */
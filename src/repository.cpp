@@ -22,20 +22,31 @@
 #include "blob.hpp"
 #include "branch.hpp"
 #include "commit.hpp"
+#include "commitgraph.hpp"
 #include "common.hpp"
 #include "config.hpp"
 #include "database.hpp"
 #include "exception.hpp"
 #include "index.hpp"
 #include "oid.hpp"
+#include "prefixindex.hpp"
+#include "reachability.hpp"
 #include "ref.hpp"
 #include "remote.hpp"
 #include "revwalk.hpp"
 #include "signature.hpp"
 #include "status.hpp"
 #include "tag.hpp"
+#include "threadpool.hpp"
 #include "tree.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <thread>
+
+#include <sys/stat.h>
+
 
 #ifdef GIT_WIN32
 #define GIT2PP_PATH_DIRECTORY_SEPARATOR '\\'
@@ -447,6 +458,11 @@ Database Repository::database() const
 	return Database(odb);
 }
 
+OIdPrefixIndex Repository::prefixIndex() const
+{
+	return OIdPrefixIndex(path() + "objects");
+}
+
 Index Repository::index() const
 {
 	git_index *idx;
@@ -628,11 +644,148 @@ RevWalk Repository::createRevWalk()
 
 std::pair<size_t, size_t> Repository::aheadBehind(const OId& local, const OId& upstream)const
 {
+	const char *path = git_repository_path(data());
+	const std::string graph = path != NULL ? std::string(path) + "objects/info/commit-graph" : std::string();
+	struct stat st;
+	if(path != NULL && ::stat(graph.c_str(), &st)==0)
+		return CommitGraph::open(*this, graph).aheadBehind(local, upstream);
+
 	std::pair<size_t, size_t> res;
 	Exception::git2_assert(git_graph_ahead_behind(&res.first, &res.second, data(), local.constData(), upstream.constData()));
 	return res;
 }
 
+std::vector<std::pair<size_t, size_t>> Repository::aheadBehindMany(
+	const std::vector<std::pair<OId, OId>>& pairs, ThreadPool& pool)const
+{
+	std::vector<std::pair<size_t, size_t>> res(pairs.size());
+
+	// Distinct pairs, keyed by (upstream, local) to keep the pairs of an
+	// upstream together, and the job of every input pair, if any, with
+	// whether it is asked the other way round.
+	typedef std::map<std::pair<OId, OId>, size_t> PairMap;
+	PairMap known;
+	std::vector<std::pair<PairMap::iterator, bool>> slots(pairs.size(),
+		std::make_pair(known.end(), false));
+	for(size_t i = 0; i < pairs.size(); ++i)
+	{
+		const OId& local = pairs[i].first;
+		const OId& upstream = pairs[i].second;
+		if(local == upstream)
+			continue;
+		PairMap::iterator reverse = known.find(std::make_pair(local, upstream));
+		if(reverse != known.end())
+			slots[i] = std::make_pair(reverse, true);
+		else
+			slots[i] = std::make_pair(known.insert(std::make_pair(
+				std::make_pair(upstream, local), 0)).first, false);
+	}
+
+	std::vector<PairMap::const_iterator> jobs;
+	jobs.reserve(known.size());
+	for(PairMap::iterator it = known.begin(); it != known.end(); ++it)
+	{
+		it->second = jobs.size();
+		jobs.push_back(it);
+	}
+
+	std::vector<std::pair<size_t, size_t>> counts(jobs.size());
+	const char *path = git_repository_path(data());
+	const std::string graphPath = path != NULL ? std::string(path) + "objects/info/commit-graph" : std::string();
+	struct stat st;
+	const bool hasGraph = path != NULL && ::stat(graphPath.c_str(), &st)==0;
+	const CommitGraph shared = hasGraph ? CommitGraph::open(*this, graphPath) : CommitGraph();
+
+	// Work units: the runs of jobs of an upstream, each split in at most as
+	// many parts as there are workers; the jobs of a part share the walk of
+	// their upstream.
+	std::vector<std::pair<size_t, size_t>> units;
+	for(size_t begin = 0, end; begin < jobs.size(); begin = end)
+	{
+		for(end = begin; end < jobs.size() && jobs[end]->first.first == jobs[begin]->first.first; ++end)
+			;
+		const size_t parts = std::min<size_t>(pool.size(), end - begin);
+		for(size_t part = 0; part < parts; ++part)
+			units.push_back(std::make_pair(begin + (end - begin) * part / parts,
+				begin + (end - begin) * (part + 1) / parts));
+	}
+
+	std::atomic<size_t> next(0);
+	pool.run([&](unsigned int worker)
+	{
+		if(worker != 0 && path == NULL)
+			return;
+		Repository repo;
+		CommitGraph graph;
+		try
+		{
+			for(size_t unit; (unit = next++) < units.size(); )
+			{
+				if(!repo.ok())
+				{
+					repo = worker == 0 ? *this : Repository::open(path);
+					graph = shared.forRepository(repo);
+				}
+				const size_t begin = units[unit].first, end = units[unit].second;
+				if(hasGraph)
+				{
+					std::vector<OId> locals;
+					for(size_t job = begin; job < end; ++job)
+						locals.push_back(jobs[job]->first.second);
+					const std::vector<std::pair<size_t, size_t>> part = graph.aheadBehind(locals, jobs[begin]->first.first);
+					std::copy(part.begin(), part.end(), counts.begin() + begin);
+					continue;
+				}
+				for(size_t job = begin; job < end; ++job)
+				{
+					const std::pair<OId, OId>& key = jobs[job]->first;
+					Exception::git2_assert(git_graph_ahead_behind(
+						&counts[job].first, &counts[job].second, repo.data(),
+						key.second.constData(), key.first.constData()));
+				}
+			}
+		}
+		catch(...)
+		{
+			next = units.size();
+			throw;
+		}
+	});
+
+	for(size_t i = 0; i < pairs.size(); ++i)
+	{
+		if(slots[i].first == known.end())
+			continue;
+		const std::pair<size_t, size_t>& count = counts[slots[i].first->second];
+		res[i] = slots[i].second ? std::make_pair(count.second, count.first) : count;
+	}
+	return res;
+}
+
+std::vector<std::pair<size_t, size_t>> Repository::aheadBehindMany(
+	const std::vector<std::pair<OId, OId>>& pairs, unsigned int threads)const
+{
+	if(threads == 0)
+		threads = std::thread::hardware_concurrency();
+	ThreadPool pool(std::max<size_t>(1, std::min<size_t>(threads, pairs.size())));
+	return aheadBehindMany(pairs, pool);
+}
+
+CommitGraph Repository::commitGraph() const
+{
+	return CommitGraph(*this);
+}
+
+ReachabilityIndex Repository::reachabilityIndex() const
+{
+	return ReachabilityIndex::open(*this);
+}
+
+ReachabilityIndex Repository::reachabilityIndex(const std::vector<OId>& tips) const
+{
+	return ReachabilityIndex::build(*this, tips);
+}
+
 void Repository::addIgnoreRule(const std::string& rules)
 {
 	Exception::git2_assert(git_ignore_add_rule(data(), rules.c_str()));
@@ -718,218 +871,126 @@ bool Repository::shallow()const
 	return git_repository_is_shallow(data())!=0;
 }
 
-// DiffList Repository::diffTreeToTree(Tree oldTree, Tree newTree)
-// {
-// 	git_diff_list *diff;
-// 	Exception::git2_assert(git_diff_tree_to_tree(&diff, data(), oldTree.data(), newTree.data(), NULL));
-// 	return DiffList(diff);
-// }
+namespace
+{
 
-// DiffList Repository::diffTreeToTree(Tree oldTree, Tree newTree, uint32_t flags, uint16_t contextLines, uint16_t interhunkLines,
-// 		const std::string& oldPrefix , const std::string& newPrefix, const std::vector<std::string>& pathspec, git_off_t maxSize,
-// 		DiffNotifyCallbackFunction notify)
-// {
-// 	git_diff_options options = {
-// 		GIT_DIFF_OPTIONS_VERSION,
-// 		flags,
-// 		contextLines,
-// 		interhunkLines,
-// 		oldPrefix.c_str(),
-// 		newPrefix.c_str(),
-// 		{
-// 			pathspec.size()>0 ? new char*[pathspec.size()] : NULL,
-// 			pathspec.size()
-// 		},
-// 		maxSize,
-// 		[](const git_diff_list *diff_so_far, const git_diff_delta *delta_to_add, const char *matched_pathspec, void *payload)->int
-// 		{
-// 			DiffNotifyCallbackFunction* callback = (DiffNotifyCallbackFunction*)payload;
-// 			if(callback!=nullptr)
-// 				return (*callback)(DiffList(const_cast<git_diff_list*>(diff_so_far)), DiffDelta(const_cast<git_diff_delta*>(delta_to_add)), std::string(matched_pathspec));
-// 			else
-// 				return 0;
-// 		},
-// 		(void*)&notify
-// 	};
-// 	if(pathspec.size()>0)
-// 	{
-// 		for(size_t n=0; n<pathspec.size(); ++n)
-// 		{
-// 			options.pathspec.strings[n] = const_cast<char*>(pathspec[n].data());
-// 		}
-// 	}
-
-// 	git_diff_list *diff;
-// 	int res = git_diff_tree_to_tree(&diff, data(), oldTree.data(), newTree.data(), &options);
-
-// 	if(pathspec.size()>0)
-// 	{
-// 		delete options.pathspec.strings;
-// 	}
-
-// 	Exception::git2_assert(res);
-// 	return DiffList(diff);
-// }
+DiffOptions makeDiffOptions(uint32_t flags, uint16_t contextLines, uint16_t interhunkLines,
+		const std::string& oldPrefix , const std::string& newPrefix, const std::vector<std::string>& pathspec, git_off_t maxSize,
+		DiffNotifyCallbackFunction notify)
+{
+	DiffOptions options(flags);
+	options.setContextLines(contextLines);
+	options.setInterhunkLines(interhunkLines);
+	options.setOldPrefix(oldPrefix);
+	options.setNewPrefix(newPrefix);
+	options.setPathspec(pathspec);
+	options.setMaxSize(maxSize);
+	options.setNotify(notify);
+	return options;
+}
 
-// DiffList Repository::diffTreeToIndex(Tree oldTree, Index index)
-// {
-// 	git_diff_list *diff;
-// 	Exception::git2_assert(git_diff_tree_to_index(&diff, data(), oldTree.data(), index.data(), NULL));
-// 	return DiffList(diff);
-// }
+} // namespace
 
-// DiffList Repository::diffTreeToIndex(Tree oldTree, Index index, uint32_t flags, uint16_t contextLines, uint16_t interhunkLines,
-// 		const std::string& oldPrefix , const std::string& newPrefix, const std::vector<std::string>& pathspec, git_off_t maxSize,
-// 		DiffNotifyCallbackFunction notify)
-// {
-// 	git_diff_options options = {
-// 		GIT_DIFF_OPTIONS_VERSION,
-// 		flags,
-// 		contextLines,
-// 		interhunkLines,
-// 		oldPrefix.c_str(),
-// 		newPrefix.c_str(),
-// 		{
-// 			pathspec.size()>0 ? new char*[pathspec.size()] : NULL,
-// 			pathspec.size()
-// 		},
-// 		maxSize,
-// 		[](const git_diff_list *diff_so_far, const git_diff_delta *delta_to_add, const char *matched_pathspec, void *payload)->int
-// 		{
-// 			DiffNotifyCallbackFunction* callback = (DiffNotifyCallbackFunction*)payload;
-// 			if(callback!=nullptr)
-// 				return (*callback)(DiffList(const_cast<git_diff_list*>(diff_so_far)), DiffDelta(const_cast<git_diff_delta*>(delta_to_add)), std::string(matched_pathspec));
-// 			else
-// 				return 0;
-// 		},
-// 		(void*)&notify
-// 	};
-// 	if(pathspec.size()>0)
-// 	{
-// 		for(size_t n=0; n<pathspec.size(); ++n)
-// 		{
-// 			options.pathspec.strings[n] = const_cast<char*>(pathspec[n].data());
-// 		}
-// 	}
-
-// 	git_diff_list *diff;
-// 	int res = git_diff_tree_to_index(&diff, data(), oldTree.data(), index.data(), &options);
-
-// 	if(pathspec.size()>0)
-// 	{
-// 		delete options.pathspec.strings;
-// 	}
-
-// 	Exception::git2_assert(res);
-// 	return DiffList(diff);
-// }
+DiffList Repository::diffTreeToTree(const Tree& oldTree, const Tree& newTree)const
+{
+	git_diff *diff;
+	Exception::git2_assert(git_diff_tree_to_tree(&diff, data(), oldTree.data(), newTree.data(), NULL));
+	return DiffList(diff);
+}
 
-// DiffList Repository::diffIndexToWorkdir(Index index)
-// {
-// 	git_diff_list *diff;
-// 	Exception::git2_assert(git_diff_index_to_workdir(&diff, data(), index.data(), NULL));
-// 	return DiffList(diff);
-// }
+DiffList Repository::diffTreeToTree(const Tree& oldTree, const Tree& newTree, const DiffOptions& options)const
+{
+	git_diff *diff;
+	Exception::git2_assert(git_diff_tree_to_tree(&diff, data(), oldTree.data(), newTree.data(), options.data()));
+	return DiffList(diff);
+}
 
+DiffList Repository::diffTreeToTree(const Tree& oldTree, const Tree& newTree, uint32_t flags, uint16_t contextLines, uint16_t interhunkLines,
+		const std::string& oldPrefix , const std::string& newPrefix, const std::vector<std::string>& pathspec, git_off_t maxSize,
+		DiffNotifyCallbackFunction notify)const
+{
+	return diffTreeToTree(oldTree, newTree, makeDiffOptions(flags, contextLines, interhunkLines, oldPrefix, newPrefix, pathspec, maxSize, notify));
+}
 
-// DiffList Repository::diffIndexToWorkdir(Index index, uint32_t flags, uint16_t contextLines, uint16_t interhunkLines,
-// 		const std::string& oldPrefix , const std::string& newPrefix, const std::vector<std::string>& pathspec, git_off_t maxSize,
-// 		DiffNotifyCallbackFunction notify)
-// {
-// 	git_diff_options options = {
-// 		GIT_DIFF_OPTIONS_VERSION,
-// 		flags,
-// 		contextLines,
-// 		interhunkLines,
-// 		oldPrefix.c_str(),
-// 		newPrefix.c_str(),
-// 		{
-// 			pathspec.size()>0 ? new char*[pathspec.size()] : NULL,
-// 			pathspec.size()
-// 		},
-// 		maxSize,
-// 		[](const git_diff_list *diff_so_far, const git_diff_delta *delta_to_add, const char *matched_pathspec, void *payload)->int
-// 		{
-// 			DiffNotifyCallbackFunction* callback = (DiffNotifyCallbackFunction*)payload;
-// 			if(callback!=nullptr)
-// 				return (*callback)(DiffList(const_cast<git_diff_list*>(diff_so_far)), DiffDelta(const_cast<git_diff_delta*>(delta_to_add)), std::string(matched_pathspec));
-// 			else
-// 				return 0;
-// 		},
-// 		(void*)&notify
-// 	};
-// 	if(pathspec.size()>0)
-// 	{
-// 		for(size_t n=0; n<pathspec.size(); ++n)
-// 		{
-// 			options.pathspec.strings[n] = const_cast<char*>(pathspec[n].data());
-// 		}
-// 	}
-
-// 	git_diff_list *diff;
-// 	int res = git_diff_index_to_workdir(&diff, data(), index.data(), &options);
-
-// 	if(pathspec.size()>0)
-// 	{
-// 		delete options.pathspec.strings;
-// 	}
-
-// 	Exception::git2_assert(res);
-// 	return DiffList(diff);
-// }
+DiffList Repository::diffTreeToIndex(const Tree& oldTree, const Index& index)const
+{
+	git_diff *diff;
+	Exception::git2_assert(git_diff_tree_to_index(&diff, data(), oldTree.data(), index.data(), NULL));
+	return DiffList(diff);
+}
 
-// DiffList Repository::diffTreeToWorkdir(Tree oldTree)
-// {
-// 	git_diff_list *diff;
-// 	Exception::git2_assert(git_diff_tree_to_workdir(&diff, data(), oldTree.data(), NULL));
-// 	return DiffList(diff);
-// }
+DiffList Repository::diffTreeToIndex(const Tree& oldTree, const Index& index, const DiffOptions& options)const
+{
+	git_diff *diff;
+	Exception::git2_assert(git_diff_tree_to_index(&diff, data(), oldTree.data(), index.data(), options.data()));
+	return DiffList(diff);
+}
 
-// DiffList Repository::diffTreeToWorkdir(Tree oldTree, uint32_t flags, uint16_t contextLines, uint16_t interhunkLines,
-// 		const std::string& oldPrefix , const std::string& newPrefix, const std::vector<std::string>& pathspec, git_off_t maxSize,
-// 		DiffNotifyCallbackFunction notify)
-// {
-// 	git_diff_options options = {
-// 		GIT_DIFF_OPTIONS_VERSION,
-// 		flags,
-// 		contextLines,
-// 		interhunkLines,
-// 		oldPrefix.c_str(),
-// 		newPrefix.c_str(),
-// 		{
-// 			pathspec.size()>0 ? new char*[pathspec.size()] : NULL,
-// 			pathspec.size()
-// 		},
-// 		maxSize,
-// 		[](const git_diff_list *diff_so_far, const git_diff_delta *delta_to_add, const char *matched_pathspec, void *payload)->int
-// 		{
-// 			DiffNotifyCallbackFunction* callback = (DiffNotifyCallbackFunction*)payload;
-// 			if(callback!=nullptr)
-// 				return (*callback)(DiffList(const_cast<git_diff_list*>(diff_so_far)), DiffDelta(const_cast<git_diff_delta*>(delta_to_add)), std::string(matched_pathspec));
-// 			else
-// 				return 0;
-// 		},
-// 		(void*)&notify
-// 	};
-// 	if(pathspec.size()>0)
-// 	{
-// 		for(size_t n=0; n<pathspec.size(); ++n)
-// 		{
-// 			options.pathspec.strings[n] = const_cast<char*>(pathspec[n].data());
-// 		}
-// 	}
-
-// 	git_diff_list *diff;
-// 	int res = git_diff_tree_to_workdir(&diff, data(), oldTree.data(), &options);
-
-// 	if(pathspec.size()>0)
-// 	{
-// 		delete options.pathspec.strings;
-// 	}
-
-// 	Exception::git2_assert(res);
-// 	return DiffList(diff);
-// }
+DiffList Repository::diffTreeToIndex(const Tree& oldTree, const Index& index, uint32_t flags, uint16_t contextLines, uint16_t interhunkLines,
+		const std::string& oldPrefix , const std::string& newPrefix, const std::vector<std::string>& pathspec, git_off_t maxSize,
+		DiffNotifyCallbackFunction notify)const
+{
+	return diffTreeToIndex(oldTree, index, makeDiffOptions(flags, contextLines, interhunkLines, oldPrefix, newPrefix, pathspec, maxSize, notify));
+}
+
+DiffList Repository::diffIndexToWorkdir(const Index& index)const
+{
+	git_diff *diff;
+	Exception::git2_assert(git_diff_index_to_workdir(&diff, data(), index.data(), NULL));
+	return DiffList(diff);
+}
+
+DiffList Repository::diffIndexToWorkdir(const Index& index, const DiffOptions& options)const
+{
+	git_diff *diff;
+	Exception::git2_assert(git_diff_index_to_workdir(&diff, data(), index.data(), options.data()));
+	return DiffList(diff);
+}
+
+DiffList Repository::diffIndexToWorkdir(const Index& index, uint32_t flags, uint16_t contextLines, uint16_t interhunkLines,
+		const std::string& oldPrefix , const std::string& newPrefix, const std::vector<std::string>& pathspec, git_off_t maxSize,
+		DiffNotifyCallbackFunction notify)const
+{
+	return diffIndexToWorkdir(index, makeDiffOptions(flags, contextLines, interhunkLines, oldPrefix, newPrefix, pathspec, maxSize, notify));
+}
+
+DiffList Repository::diffTreeToWorkdir(const Tree& oldTree)const
+{
+	git_diff *diff;
+	Exception::git2_assert(git_diff_tree_to_workdir(&diff, data(), oldTree.data(), NULL));
+	return DiffList(diff);
+}
+
+DiffList Repository::diffTreeToWorkdir(const Tree& oldTree, const DiffOptions& options)const
+{
+	git_diff *diff;
+	Exception::git2_assert(git_diff_tree_to_workdir(&diff, data(), oldTree.data(), options.data()));
+	return DiffList(diff);
+}
+
+DiffList Repository::diffTreeToWorkdir(const Tree& oldTree, uint32_t flags, uint16_t contextLines, uint16_t interhunkLines,
+		const std::string& oldPrefix , const std::string& newPrefix, const std::vector<std::string>& pathspec, git_off_t maxSize,
+		DiffNotifyCallbackFunction notify)const
+{
+	return diffTreeToWorkdir(oldTree, makeDiffOptions(flags, contextLines, interhunkLines, oldPrefix, newPrefix, pathspec, maxSize, notify));
+}
+
+bool Repository::commitStats(const std::string& range, DiffStatsCallbackFunction callback)const
+{
+	git_revwalk *out;
+	Exception::git2_assert(git_revwalk_new(&out, data()));
+	RevWalk walk(out);
+	walk.setSorting(RevWalk::Topological | RevWalk::Time);
+	walk.pushRange(range);
+	for(const Commit& commit : walk.commits())
+	{
+		Tree parentTree = commit.parentCount() > 0 ? commit.parent(0).tree() : Tree();
+		DiffList diff = diffTreeToTree(parentTree, commit.tree());
+		if(!callback(commit.oid(), diff.stats(*this)))
+			return false;
+	}
+	return true;
+}
 
 void Repository::checkoutHead(unsigned int strategy, bool disableFilters,
 		unsigned int dirMode, unsigned int fileMode,
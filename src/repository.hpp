@@ -41,15 +41,19 @@ namespace git2
 class Blob;
 class Branch;
 class Commit;
+class CommitGraph;
 class Config;
 class Database;
 class Index;
 class Object;
 class OId;
+class OIdPrefixIndex;
 class Tag;
+class ThreadPool;
 class Tree;
 class Reference;
 class RefLog;
+class ReachabilityIndex;
 class Remote;
 class Repository;
 class RevWalk;
@@ -83,6 +87,14 @@ public:
 	 */
 	Repository(const Repository& repo);
 
+	/**
+	 * Move constructor; takes over the underlaying data structure.
+	 */
+	Repository(Repository&& other) = default;
+
+	Repository& operator=(const Repository& other) = default;
+	Repository& operator=(Repository&& other) = default;
+
 /**
  * @name Creation
  * @{
@@ -612,6 +624,18 @@ public:
 	 */
 	Database database() const;
 
+	/**
+	 * Build an index of the ids of all the objects of this repository,
+	 * to abbreviate and resolve shortened OIds.
+	 *
+	 * The index reads the `.git/objects` directory and its alternates
+	 * directly, it does not follow a custom ODB.
+	 *
+	 * @return Prefix index of the repository objects.
+	 * @throws Exception
+	 */
+	OIdPrefixIndex prefixIndex() const;
+
 	// TODO Implement git_repository_refdb
 
 	/**
@@ -888,11 +912,83 @@ public:
 	 * the other as its upstream, the `ahead` and `behind` values will be
 	 * what git would report for the branches.
 	 *
+	 * When the repository has a commit-graph file (`git commit-graph
+	 * write`), the commits are counted from it, as CommitGraph::aheadBehind()
+	 * does; the file is mapped once and shared by the following calls, see
+	 * CommitGraph::open(). Otherwise every commit is read from the object
+	 * database; keep a commitGraph() for repeated queries on large
+	 * histories.
+	 *
 	 * @param local the commit for local
 	 * @param upstream the commit for upstream
 	 */
 	std::pair<size_t, size_t> aheadBehind(const OId& local, const OId& upstream)const;
 
+	/**
+	 * Count the unique commits of many pairs of commits, in parallel.
+	 *
+	 * Each distinct pair is counted once, whichever way round it is given.
+	 * The pairs of an upstream are split in at most one run per worker, so
+	 * that the common history stays in the object cache of the worker
+	 * repository.
+	 *
+	 * When the repository has a commit-graph file, it is opened once and
+	 * shared by the workers, which count with generation-pruned walks over
+	 * it. Each run is counted as CommitGraph::aheadBehind(locals, upstream)
+	 * does, walking the ancestors of the upstream once.
+	 *
+	 * Worker 0 uses this repository, the other workers open the repository
+	 * again from its path. Workers of an in-memory repository stay idle.
+	 *
+	 * @param pairs (local, upstream) commits, see aheadBehind().
+	 * @param pool Workers to count with.
+	 * @return (ahead, behind) counts, in the order of the pairs.
+	 * @throws Exception
+	 */
+	std::vector<std::pair<size_t, size_t>> aheadBehindMany(
+		const std::vector<std::pair<OId, OId>>& pairs, ThreadPool& pool)const;
+
+	/**
+	 * Count the unique commits of many pairs of commits, in parallel.
+	 *
+	 * @param pairs (local, upstream) commits, see aheadBehind().
+	 * @param threads Number of threads, 0 for one per hardware thread.
+	 * @return (ahead, behind) counts, in the order of the pairs.
+	 * @throws Exception
+	 */
+	std::vector<std::pair<size_t, size_t>> aheadBehindMany(
+		const std::vector<std::pair<OId, OId>>& pairs, unsigned int threads = 0)const;
+
+	/**
+	 * Open the commit-graph file of this repository, or build the commit
+	 * table if there is none.
+	 *
+	 * The table built without a commit-graph file is not cached: every
+	 * call reads all the commits reachable from the references again.
+	 *
+	 * @return Commit table of the repository.
+	 * @throws Exception
+	 */
+	CommitGraph commitGraph() const;
+
+	/**
+	 * Load the reachability bitmap Git wrote for the packs of this
+	 * repository (`git repack -adb`).
+	 *
+	 * @return Reachability index of the repository.
+	 * @throws Exception GIT_ENOTFOUND if no pack has a bitmap.
+	 */
+	ReachabilityIndex reachabilityIndex() const;
+
+	/**
+	 * Build reachability bitmaps for some commits, e.g. release branches.
+	 *
+	 * @param tips Commits to build a bitmap for, oldest first.
+	 * @return Reachability index of the commits.
+	 * @throws Exception
+	 */
+	ReachabilityIndex reachabilityIndex(const std::vector<OId>& tips) const;
+
 /** @} */
 
 /**
@@ -1115,22 +1211,21 @@ public:
 	 *
 	 * The first tree will be used for the "old_file" side of the delta and the
 	 * second tree will be used for the "new_file" side of the delta.  You can
-	 * pass NULL to indicate an empty tree, although it is an error to pass
-	 * NULL for both the `old_tree` and `new_tree`.
+	 * pass a default constructed tree to indicate an empty tree, although it
+	 * is an error to pass empty trees for both `oldTree` and `newTree`.
 	 *
-	 * @param diff Output pointer to a git_diff_list pointer to be allocated.
-	 * @param repo The repository containing the trees.
 	 * @param oldTree A Tree object to diff from, or default constructed empty tree.
 	 * @param newTree A Tree object to diff to, or default constructed empty tree.
-	 *
-	 * TODO add option parameter description
+	 * @param options Options of the diff.
+	 * @throws Exception
 	 */
-	DiffList diffTreeToTree(Tree oldTree, Tree newTree);
-	DiffList diffTreeToTree(Tree oldTree, Tree newTree,
+	DiffList diffTreeToTree(const Tree& oldTree, const Tree& newTree)const;
+	DiffList diffTreeToTree(const Tree& oldTree, const Tree& newTree, const DiffOptions& options)const;
+	DiffList diffTreeToTree(const Tree& oldTree, const Tree& newTree,
 			uint32_t flags, uint16_t contextLines = 3, uint16_t interhunkLines = 0,
 			const std::string& oldPrefix = "a", const std::string& newPrefix = "b",
 			const std::vector<std::string>& pathspec = std::vector<std::string>() , git_off_t max_size = 512*1024*1024,
-			DiffNotifyCallbackFunction notify = DiffNotifyCallbackFunction());
+			DiffNotifyCallbackFunction notify = DiffNotifyCallbackFunction())const;
 
 	/**
 	 * Create a diff list between a tree and repository index.
@@ -1143,15 +1238,16 @@ public:
 	 *
 	 * @param oldTree A Tree object to diff from, or default constructed empty tree.
 	 * @param index The index to diff with; repo index used if default constructed empty index.
-	 *
-	 * TODO add option parameter description
+	 * @param options Options of the diff.
+	 * @throws Exception
 	 */
-	DiffList diffTreeToIndex(Tree oldTree, Index index);
-	DiffList diffTreeToIndex(Tree oldTree, Index index,
+	DiffList diffTreeToIndex(const Tree& oldTree, const Index& index)const;
+	DiffList diffTreeToIndex(const Tree& oldTree, const Index& index, const DiffOptions& options)const;
+	DiffList diffTreeToIndex(const Tree& oldTree, const Index& index,
 			uint32_t flags, uint16_t contextLines = 3, uint16_t interhunkLines = 0,
 			const std::string& oldPrefix = "a", const std::string& newPrefix = "b",
 			const std::vector<std::string>& pathspec = std::vector<std::string>() , git_off_t max_size = 512*1024*1024,
-			DiffNotifyCallbackFunction notify = DiffNotifyCallbackFunction());
+			DiffNotifyCallbackFunction notify = DiffNotifyCallbackFunction())const;
 
 	/**
 	 * Create a diff list between the repository index and the workdir directory.
@@ -1165,15 +1261,16 @@ public:
 	 * working directory will be used for the "new_file" side of the delta.
 	 *
 	 * @param index The index to diff from; repo index used if default constructed empty index.
-	 *
-	 * TODO add option parameter description
+	 * @param options Options of the diff.
+	 * @throws Exception
 	 */
-	DiffList diffIndexToWorkdir(Index index);
-	DiffList diffIndexToWorkdir(Index index,
+	DiffList diffIndexToWorkdir(const Index& index)const;
+	DiffList diffIndexToWorkdir(const Index& index, const DiffOptions& options)const;
+	DiffList diffIndexToWorkdir(const Index& index,
 			uint32_t flags, uint16_t contextLines = 3, uint16_t interhunkLines = 0,
 			const std::string& oldPrefix = "a", const std::string& newPrefix = "b",
 			const std::vector<std::string>& pathspec = std::vector<std::string>() , git_off_t max_size = 512*1024*1024,
-			DiffNotifyCallbackFunction notify = DiffNotifyCallbackFunction());
+			DiffNotifyCallbackFunction notify = DiffNotifyCallbackFunction())const;
 
 	/**
 	 * Create a diff list between a tree and the working directory.
@@ -1191,7 +1288,7 @@ public:
 	 * equivalent in core git.
 	 *
 	 * To emulate `git diff <treeish>`, call both `diffTreeToIndex` and
-	 * `diffIndexToWorkdir`, then call `DiffList::_merge` on the results.
+	 * `diffIndexToWorkdir`, then call `DiffList::merge` on the results.
 	 * That will yield a `DiffList` that matches the git output.
 	 *
 	 * If this seems confusing, take the case of a file with a staged deletion
@@ -1200,17 +1297,30 @@ public:
 	 * show status 'deleted' since there is a pending deletion in the index.
 	 *
 	 * @param oldTree A Tree object to diff from, or default construct for empty tree.
-	 *
-	 * TODO add option parameter description
+	 * @param options Options of the diff.
+	 * @throws Exception
 	 */
-	DiffList diffTreeToWorkdir(Tree oldTree);
-	DiffList diffTreeToWorkdir(Tree oldTree,
+	DiffList diffTreeToWorkdir(const Tree& oldTree)const;
+	DiffList diffTreeToWorkdir(const Tree& oldTree, const DiffOptions& options)const;
+	DiffList diffTreeToWorkdir(const Tree& oldTree,
 			uint32_t flags, uint16_t contextLines = 3, uint16_t interhunkLines = 0,
 			const std::string& oldPrefix = "a", const std::string& newPrefix = "b",
 			const std::vector<std::string>& pathspec = std::vector<std::string>() , git_off_t max_size = 512*1024*1024,
-			DiffNotifyCallbackFunction notify = DiffNotifyCallbackFunction());
-
+			DiffNotifyCallbackFunction notify = DiffNotifyCallbackFunction())const;
 
+	/**
+	 * Count the added and deleted lines of every commit of a range,
+	 * like `git log --numstat <from>..<to>`.
+	 *
+	 * Each commit is compared to its first parent, root commits to the
+	 * empty tree. Commits are visited from the newest.
+	 *
+	 * @param range Range of the form <commit>..<commit>.
+	 * @param callback Callback receiving the counts of each commit.
+	 * @return true if completly terminated and false if user terminated.
+	 * @throws Exception
+	 */
+	bool commitStats(const std::string& range, DiffStatsCallbackFunction callback)const;
 
 /** @} */
 
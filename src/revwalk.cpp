@@ -34,7 +34,7 @@ _Class(revwalk)
 }
 
 RevWalk::RevWalk( const RevWalk& other ):
-_Class(other.data())
+_Class(other)
 {
 }
 
@@ -115,7 +115,53 @@ void RevWalk::hideHead() const
 bool RevWalk::next(OId& oid) const
 {
     int err = git_revwalk_next(oid.data(), data());
-    return (err == GIT_OK);
+    if (err == GIT_ITEROVER)
+        return false;
+    Exception::git2_assert(err);
+    return true;
+}
+
+size_t RevWalk::nextBatch(OId* oids, size_t count) const
+{
+    git_revwalk *walk = data();
+    for (size_t n = 0; n < count; ++n)
+    {
+        git_oid oid;
+        int err = git_revwalk_next(&oid, walk);
+        if (err == GIT_ITEROVER)
+            return n;
+        Exception::git2_assert(err);
+        oids[n] = OId(&oid);
+    }
+    return count;
+}
+
+//
+// RevWalk::iterator
+//
+
+RevWalk::iterator::iterator(const RevWalk* walk):
+_walk(walk)
+{
+    ++*this;
+}
+
+RevWalk::iterator& RevWalk::iterator::operator++()
+{
+    if (_walk != nullptr && !_walk->next(_oid))
+        _walk = nullptr;
+    return *this;
+}
+
+const Commit& RevWalk::CommitRange::iterator::operator*() const
+{
+    if (!_commit.ok())
+    {
+        git_commit *commit;
+        Exception::git2_assert(git_commit_lookup(&commit, _repo, _it->constData()));
+        _commit = Commit(commit);
+    }
+    return _commit;
 }
 
 void RevWalk::setSorting(SortModes sm)
@@ -22,10 +22,14 @@
 
 #include <git2.h>
 
+#include <cstddef>
+#include <iterator>
 #include <memory>
 #include <string>
 
 #include "common.hpp"
+#include "commit.hpp"
+#include "oid.hpp"
 
 namespace git2
 {
@@ -60,6 +64,10 @@ public:
     RevWalk(git_revwalk* revwalk);
 
     RevWalk( const RevWalk& other );
+    RevWalk(RevWalk&& other) = default;
+
+    RevWalk& operator=(const RevWalk& other) = default;
+    RevWalk& operator=(RevWalk&& other) = default;
 
     /**
      * Delete a revwalk previously allocated.
@@ -219,15 +227,128 @@ public:
      * Get the oid of the next commit from the revision traversal.
      *
      * @param oid The oid of the next object in the revisions tree if it was found; otherwise it is undefined.
-     * @return True if the object was found.
+     * @return True if the object was found, false at the end of the walk.
+     * @throws Exception if the walk failed.
      */
     bool next(OId& oid) const;
 
+    /**
+     * Get the oids of the next commits from the revision traversal.
+     *
+     * Pulls up to count oids at once, e.g. to page through a log.
+     *
+     * @param oids Array receiving the oids.
+     * @param count Maximum number of oids to pull.
+     * @return Number of oids written into oids, less than count only at
+     * the end of the walk.
+     * @throws Exception if the walk failed; the content of oids is then undefined.
+     */
+    size_t nextBatch(OId* oids, size_t count) const;
+
+    /**
+     * Input iterator over the oids of a revision traversal.
+     *
+     * Incrementing the iterator advances the walk itself, so only one
+     * iterator of a walk can be used at a time.
+     */
+    class iterator
+    {
+    public:
+        typedef std::input_iterator_tag iterator_category;
+        typedef OId value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const OId* pointer;
+        typedef const OId& reference;
+
+        iterator():_walk(nullptr){}
+        explicit iterator(const RevWalk* walk);
+
+        const OId& operator*() const {return _oid;}
+        const OId* operator->() const {return &_oid;}
+        iterator& operator++();
+        void operator++(int) {++*this;}
+
+        bool operator==(const iterator& other) const {return _walk==other._walk;}
+        bool operator!=(const iterator& other) const {return _walk!=other._walk;}
+
+    private:
+        const RevWalk* _walk; //!< Walk, or null at the end.
+        OId _oid;
+    };
+
+    /**
+     * Range of the commits of a revision traversal.
+     *
+     * The commits are looked up lazily, when an iterator is dereferenced.
+     */
+    class CommitRange
+    {
+    public:
+        class iterator
+        {
+        public:
+            typedef std::input_iterator_tag iterator_category;
+            typedef Commit value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const Commit* pointer;
+            typedef const Commit& reference;
+
+            iterator():_repo(nullptr){}
+            iterator(const RevWalk::iterator& it, git_repository* repo):_it(it),_repo(repo){}
+
+            const OId& oid() const {return *_it;}
+            const Commit& operator*() const;
+            const Commit* operator->() const {return &**this;}
+            iterator& operator++() {++_it; _commit = Commit(); return *this;}
+            void operator++(int) {++*this;}
+
+            bool operator==(const iterator& other) const {return _it==other._it;}
+            bool operator!=(const iterator& other) const {return _it!=other._it;}
+
+        private:
+            RevWalk::iterator _it;
+            git_repository* _repo; //!< Repository to look the commits up in.
+            mutable Commit _commit; //!< Commit of the current oid, once looked up.
+        };
+
+        explicit CommitRange(const RevWalk* walk):_walk(walk){}
+
+        iterator begin() const {return iterator(RevWalk::iterator(_walk), git_revwalk_repository(_walk->data()));}
+        iterator end() const {return iterator();}
+
+    private:
+        const RevWalk* _walk;
+    };
+
+    /**
+     * Start the traversal and iterate over the oids, e.g. in a range-for:
+     * @code
+     * for(const OId& oid : walk) ...
+     * @endcode
+     *
+     * @throws Exception if the walk failed.
+     */
+    iterator begin() const {return iterator(this);}
+    iterator end() const {return iterator();}
+
+    /**
+     * Range over the commits of the traversal, each commit being looked up
+     * when reached:
+     * @code
+     * for(const Commit& commit : walk.commits()) ...
+     * @endcode
+     */
+    CommitRange commits() const {return CommitRange(this);}
+
     /**
      * Change the sorting mode when iterating through the
      * repository's contents.
      * Changing the sorting mode resets the walker.
      *
+     * A topological walk reads every walked commit before returning the
+     * first one; CommitGraph::topologicalOrder() gives the same order
+     * from the commit-graph without reading the commits.
+     *
      * @param sortMode The sorting mode @see SortModes.
      */
     void setSorting(SortModes sortMode);
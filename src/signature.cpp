@@ -50,12 +50,22 @@ SignatureBuilder::~SignatureBuilder()
 
 std::string SignatureBuilder::name() const
 {
-	return std::string(_sign->name);
+	return nameView().str();
 }
 
 std::string SignatureBuilder::email() const
 {
-	return std::string(_sign->email);
+	return emailView().str();
+}
+
+StringView SignatureBuilder::nameView() const
+{
+	return StringView(_sign->name);
+}
+
+StringView SignatureBuilder::emailView() const
+{
+	return StringView(_sign->email);
 }
 
 time_t SignatureBuilder::when() const
@@ -98,12 +108,22 @@ Signature::~Signature()
 
 std::string Signature::name() const
 {
-	return std::string(_sign->name);
+	return nameView().str();
 }
 
 std::string Signature::email() const
 {
-	return std::string(_sign->email);
+	return emailView().str();
+}
+
+StringView Signature::nameView() const
+{
+	return StringView(_sign->name);
+}
+
+StringView Signature::emailView() const
+{
+	return StringView(_sign->email);
 }
 
 time_t Signature::when() const
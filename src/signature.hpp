@@ -24,6 +24,8 @@
 
 #include <string>
 
+#include "stringview.hpp"
+
 
 namespace git2
 {
@@ -86,6 +88,20 @@ public:
      */
     std::string email() const;
 
+    /**
+     * Return the 'name' from this signature without copying it.
+     *
+     * The view is valid as long as the signature data is alive.
+     */
+    StringView nameView() const;
+
+    /**
+     * Return the 'email' from this signature without copying it.
+     *
+     * The view is valid as long as the signature data is alive.
+     */
+    StringView emailView() const;
+
     /**
      * Return the time stamp from this signature
      */
@@ -147,6 +163,20 @@ public:
      */
     std::string email() const;
 
+    /**
+     * Return the 'name' from this signature without copying it.
+     *
+     * The view is valid as long as the signature data is alive.
+     */
+    StringView nameView() const;
+
+    /**
+     * Return the 'email' from this signature without copying it.
+     *
+     * The view is valid as long as the signature data is alive.
+     */
+    StringView emailView() const;
+
     /**
      * Return the time stamp from this signature
      */
@@ -0,0 +1,250 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#include "similarity.hpp"
+
+#include "blob.hpp"
+#include "repository.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+namespace git2
+{
+
+//
+// SimilaritySignature
+//
+
+SimilaritySignature::SimilaritySignature(const char* data, size_t size):
+_size(0)
+{
+	// FNV-1a of each chunk, ending after a newline or at 64 bytes.
+	const char* end = data + size;
+	while(data < end)
+	{
+		uint32_t hash = 2166136261u;
+		uint32_t bytes = 0;
+		for(; data < end && bytes < 64; ++data)
+		{
+			const char c = *data;
+			if(c=='\r' && data+1 < end && data[1]=='\n')
+				continue;
+			hash = (hash ^ (unsigned char)c) * 16777619u;
+			++bytes;
+			if(c=='\n')
+			{
+				++data;
+				break;
+			}
+		}
+		if(bytes > 0)
+		{
+			_chunks.push_back(Chunk{hash, bytes});
+			_size += bytes;
+		}
+	}
+
+	std::sort(_chunks.begin(), _chunks.end(), [](const Chunk& a, const Chunk& b){ return a.hash < b.hash; });
+	size_t count = 0;
+	for(const Chunk& chunk : _chunks)
+	{
+		if(count > 0 && _chunks[count-1].hash==chunk.hash)
+			_chunks[count-1].bytes += chunk.bytes;
+		else
+			_chunks[count++] = chunk;
+	}
+	_chunks.resize(count);
+	_chunks.shrink_to_fit();
+
+	// The chunk hashes are mixed so the sketch does not favour chunks
+	// whose hash happens to be small for any content, like short lines.
+	_sketch.reserve(count);
+	for(const Chunk& chunk : _chunks)
+		_sketch.push_back(chunk.hash * 0x9e3779b1u);
+	if(_sketch.size() > SketchSize)
+	{
+		std::nth_element(_sketch.begin(), _sketch.begin() + SketchSize, _sketch.end());
+		_sketch.resize(SketchSize);
+	}
+	std::sort(_sketch.begin(), _sketch.end());
+	_sketch.shrink_to_fit();
+}
+
+size_t SimilaritySignature::weight()const
+{
+	return sizeof(*this) + _chunks.capacity() * sizeof(Chunk) + _sketch.capacity() * sizeof(uint32_t);
+}
+
+int SimilaritySignature::similarity(const SimilaritySignature& other)const
+{
+	const size_t max = std::max(_size, other._size);
+	if(max==0)
+		return 100;
+
+	size_t common = 0;
+	std::vector<Chunk>::const_iterator a = _chunks.begin(), b = other._chunks.begin();
+	while(a!=_chunks.end() && b!=other._chunks.end())
+	{
+		if(a->hash < b->hash)
+			++a;
+		else if(b->hash < a->hash)
+			++b;
+		else
+		{
+			common += std::min(a->bytes, b->bytes);
+			++a, ++b;
+		}
+	}
+	return (int)(common * 100 / max);
+}
+
+//
+// SimilarityCache
+//
+
+namespace
+{
+
+typedef std::shared_ptr<const SimilaritySignature> SignaturePtr;
+
+int file_signature(void **out, const git_diff_file *, const char *fullpath, void *)
+{
+	std::ifstream stream(fullpath, std::ios::binary | std::ios::ate);
+	if(!stream)
+	{
+		giterr_set_str(GITERR_OS, (std::string("cannot open '") + fullpath + "'").c_str());
+		return -1;
+	}
+	const std::streamoff size = stream.tellg();
+	std::vector<char> content(size > 0 ? (size_t)size : 0);
+	stream.seekg(0);
+	stream.read(content.data(), content.size());
+	if(size < 0 || stream.gcount()!=(std::streamsize)content.size())
+	{
+		giterr_set_str(GITERR_OS, (std::string("cannot read '") + fullpath + "'").c_str());
+		return -1;
+	}
+	*out = new SignaturePtr(std::make_shared<SimilaritySignature>(content.data(), content.size()));
+	return 0;
+}
+
+int buffer_signature(void **out, const git_diff_file *file, const char *buf, size_t buflen, void *payload)
+{
+	SimilarityCache* cache = (SimilarityCache*)payload;
+	const bool hasId = (file->flags & GIT_DIFF_FLAG_VALID_ID)!=0 && !git_oid_iszero(&file->id);
+	SignaturePtr signature;
+	if(hasId)
+		signature = cache->find(OId(&file->id));
+	if(!signature)
+	{
+		signature = std::make_shared<SimilaritySignature>(buf, buflen);
+		if(hasId)
+			cache->insert(OId(&file->id), signature);
+	}
+	*out = new SignaturePtr(signature);
+	return 0;
+}
+
+void free_signature(void *sig, void *)
+{
+	delete (SignaturePtr*)sig;
+}
+
+int similarity(int *score, void *siga, void *sigb, void *)
+{
+	*score = (*(SignaturePtr*)siga)->similarity(**(SignaturePtr*)sigb);
+	return 0;
+}
+
+} // namespace
+
+SimilarityCache::SimilarityCache(size_t maxMemory):
+_budget(maxMemory),
+_memory(0)
+{
+	_metric.file_signature = file_signature;
+	_metric.buffer_signature = buffer_signature;
+	_metric.free_signature = free_signature;
+	_metric.similarity = similarity;
+	_metric.payload = this;
+}
+
+std::shared_ptr<const SimilaritySignature> SimilarityCache::find(const OId& oid)const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	const std::list<Item>::iterator* item = _index.find(oid);
+	if(item==NULL)
+		return SignaturePtr();
+	_items.splice(_items.begin(), _items, *item);
+	return (*item)->signature;
+}
+
+std::shared_ptr<const SimilaritySignature> SimilarityCache::signature(const Repository& repo, const OId& oid)
+{
+	SignaturePtr signature = find(oid);
+	if(!signature)
+	{
+		Blob blob = repo.lookupBlob(oid);
+		signature = std::make_shared<SimilaritySignature>((const char*)blob.rawContent(), blob.rawSize());
+		insert(oid, signature);
+	}
+	return signature;
+}
+
+void SimilarityCache::insert(const OId& oid, const std::shared_ptr<const SimilaritySignature>& signature)
+{
+	const size_t weight = signature->weight() + sizeof(Item);
+	if(weight > _budget)
+		return;
+	std::lock_guard<std::mutex> lock(_mutex);
+	if(_index.contains(oid))
+		return;
+	_items.push_front(Item{oid, signature, weight});
+	_index.insert(oid, _items.begin());
+	_memory += weight;
+	while(_memory > _budget)
+	{
+		_memory -= _items.back().weight;
+		_index.erase(_items.back().oid);
+		_items.pop_back();
+	}
+}
+
+void SimilarityCache::clear()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_index.clear();
+	_items.clear();
+	_memory = 0;
+}
+
+size_t SimilarityCache::size()const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _items.size();
+}
+
+size_t SimilarityCache::memory()const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _memory;
+}
+
+} // namespace git2
@@ -0,0 +1,176 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#ifndef _GIT2PP_SIMILARITY_HPP_
+#define _GIT2PP_SIMILARITY_HPP_
+
+#include <git2.h>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "oid.hpp"
+#include "oidmap.hpp"
+
+namespace git2
+{
+
+class Repository;
+
+/**
+ * Similarity signature of a file content, as git estimates renames.
+ *
+ * The content is cut in chunks at newlines or every 64 bytes, and the
+ * signature counts the bytes of the chunks by hash. Two files are as
+ * similar as the share of their bytes in common chunks.
+ */
+class SimilaritySignature
+{
+public:
+	/**
+	 * Number of chunk hashes of the sketch.
+	 */
+	static const size_t SketchSize = 16;
+
+	/**
+	 * Compute the signature of a content.
+	 *
+	 * Carriage returns before newlines are ignored.
+	 */
+	SimilaritySignature(const char* data, size_t size);
+
+	/**
+	 * Number of bytes of the content counted in the chunks.
+	 */
+	size_t size()const{return _size;}
+
+	/**
+	 * Memory used by the signature, in bytes.
+	 */
+	size_t weight()const;
+
+	/**
+	 * Similarity of two contents, from 0 to 100.
+	 */
+	int similarity(const SimilaritySignature& other)const;
+
+	/**
+	 * The smallest (mixed) chunk hashes of the content, up to SketchSize
+	 * of them, in increasing order.
+	 *
+	 * Similar contents are likely to have a hash of their sketch in
+	 * common, which makes the sketch a key to index files with.
+	 */
+	const std::vector<uint32_t>& sketch()const{return _sketch;}
+
+private:
+	struct Chunk
+	{
+		uint32_t hash;
+		uint32_t bytes;
+	};
+
+	std::vector<Chunk> _chunks;  // By increasing hash.
+	std::vector<uint32_t> _sketch;
+	size_t _size;
+};
+
+/**
+ * Similarity signatures of blobs by blob id, to share them between the
+ * rename detections of several diffs.
+ *
+ * The cache can be used from several threads at once. The least recently
+ * used signatures are evicted when they weigh more than its budget.
+ */
+class SimilarityCache
+{
+public:
+	/**
+	 * Create a cache.
+	 *
+	 * @param maxMemory Budget of the signatures, in bytes.
+	 */
+	explicit SimilarityCache(size_t maxMemory = 64*1024*1024);
+
+	SimilarityCache(const SimilarityCache&) = delete;
+	SimilarityCache& operator=(const SimilarityCache&) = delete;
+
+	/**
+	 * Signature of a blob, or null if not in the cache.
+	 */
+	std::shared_ptr<const SimilaritySignature> find(const OId& oid)const;
+
+	/**
+	 * Signature of a blob, computed and cached if not in the cache yet.
+	 *
+	 * @param repo Repository to load the blob from.
+	 * @param oid Id of the blob.
+	 * @throws Exception
+	 */
+	std::shared_ptr<const SimilaritySignature> signature(const Repository& repo, const OId& oid);
+
+	/**
+	 * Cache the signature of a blob.
+	 */
+	void insert(const OId& oid, const std::shared_ptr<const SimilaritySignature>& signature);
+
+	/**
+	 * Remove all the signatures.
+	 */
+	void clear();
+
+	/**
+	 * Number of cached signatures.
+	 */
+	size_t size()const;
+
+	/**
+	 * Memory used by the cached signatures, in bytes.
+	 */
+	size_t memory()const;
+
+	/**
+	 * Similarity metric for git_diff_find_similar, computing the
+	 * signatures with this cache.
+	 *
+	 * Whitespace options of the rename detection are not applied.
+	 */
+	git_diff_similarity_metric* metric(){return &_metric;}
+
+private:
+	struct Item
+	{
+		OId oid;
+		std::shared_ptr<const SimilaritySignature> signature;
+		size_t weight;
+	};
+
+	mutable std::mutex _mutex;
+	mutable std::list<Item> _items;  // Most recently used first.
+	OIdMap<std::list<Item>::iterator> _index;
+	size_t _budget;
+	size_t _memory;
+	git_diff_similarity_metric _metric;
+};
+
+} // namespace git2
+#endif // _GIT2PP_SIMILARITY_HPP_
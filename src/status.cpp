@@ -146,10 +146,18 @@ std::string StatusEntry::newPath() const
 
 std::string StatusEntry::path() const
 {
-    if (_entry->index_to_workdir->old_file.path) {
-        return std::string(_entry->index_to_workdir->old_file.path);
+    return pathView().str();
+}
+
+StringView StatusEntry::pathView() const
+{
+    const git_diff_delta *delta = _entry->index_to_workdir ? _entry->index_to_workdir : _entry->head_to_index;
+    if (delta == NULL)
+        return StringView();
+    if (delta->old_file.path) {
+        return StringView(delta->old_file.path);
     } else {
-        return std::string(_entry->index_to_workdir->new_file.path);
+        return StringView(delta->new_file.path);
     }
 }
 
@@ -164,7 +172,7 @@ _Class(statusList)
 }
 
 StatusList::StatusList(const StatusList &other):
-_Class(other.data())
+_Class(other)
 {
 }
 
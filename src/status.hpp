@@ -28,6 +28,7 @@
 #include "common.hpp"
 
 #include "diff.hpp"
+#include "stringview.hpp"
 
 namespace git2
 {
@@ -155,6 +156,13 @@ public:
      */
     std::string path() const;
 
+    /**
+     * Returns the path if set, otherwise an empty view, without copying it.
+     *
+     * The view is valid as long as the StatusList owning the entry is alive.
+     */
+    StringView pathView() const;
+
 private:
     const git_status_entry* _entry; //!< Internal pointer to the libgit2 status entry
 };
@@ -170,6 +178,10 @@ public:
     StatusList(git_status_list *statusList = NULL);
 
     StatusList(const StatusList& other);
+    StatusList(StatusList&& other) = default;
+
+    StatusList& operator=(const StatusList& other) = default;
+    StatusList& operator=(StatusList&& other) = default;
 
     /**
      * Returns the number of entries in the status list.
@@ -0,0 +1,119 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#ifndef _GIT2PP_STRINGVIEW_HPP_
+#define _GIT2PP_STRINGVIEW_HPP_
+
+#include <cstring>
+#include <ostream>
+#include <string>
+
+namespace git2
+{
+
+/**
+ * Read-only view on a string owned by someone else, typically by a
+ * libgit2 structure.
+ *
+ * A StringView never allocates nor copies the characters. It is only
+ * valid as long as the memory it points to: the accessors returning a
+ * StringView document which object owns the string.
+ */
+class StringView
+{
+public:
+	typedef const char* const_iterator;
+	static const size_t npos = static_cast<size_t>(-1);
+
+	StringView():_data(""),_size(0){}
+	StringView(const char* str):_data(str!=nullptr ? str : ""),_size(str!=nullptr ? std::strlen(str) : 0){}
+	StringView(const char* str, size_t size):_data(str),_size(size){}
+	StringView(const std::string& str):_data(str.data()),_size(str.size()){}
+
+	const char* data() const {return _data;}
+	size_t size() const {return _size;}
+	size_t length() const {return _size;}
+	bool empty() const {return _size==0;}
+
+	const_iterator begin() const {return _data;}
+	const_iterator end() const {return _data+_size;}
+
+	char operator[](size_t pos) const {return _data[pos];}
+
+	/**
+	 * Copy the viewed characters into a new string.
+	 */
+	std::string str() const {return std::string(_data, _size);}
+	explicit operator std::string() const {return str();}
+
+	/**
+	 * View on a part of the string, clamped to its end.
+	 */
+	StringView substr(size_t pos, size_t count = npos) const
+	{
+		if(pos>_size)
+			pos = _size;
+		if(count>_size-pos)
+			count = _size-pos;
+		return StringView(_data+pos, count);
+	}
+
+	int compare(const StringView& other) const
+	{
+		int res = std::memcmp(_data, other._data, _size<other._size ? _size : other._size);
+		if(res!=0)
+			return res;
+		return _size<other._size ? -1 : (_size>other._size ? 1 : 0);
+	}
+
+	bool startsWith(const StringView& prefix) const
+	{
+		return _size>=prefix._size && std::memcmp(_data, prefix._data, prefix._size)==0;
+	}
+
+	size_t find(char c, size_t pos = 0) const
+	{
+		if(pos>=_size)
+			return npos;
+		const void* found = std::memchr(_data+pos, c, _size-pos);
+		return found!=nullptr ? static_cast<const char*>(found)-_data : npos;
+	}
+
+private:
+	const char* _data;
+	size_t _size;
+};
+
+inline bool operator==(const StringView& a, const StringView& b)
+{
+	return a.size()==b.size() && std::memcmp(a.data(), b.data(), a.size())==0;
+}
+inline bool operator!=(const StringView& a, const StringView& b) {return !(a==b);}
+inline bool operator<(const StringView& a, const StringView& b) {return a.compare(b)<0;}
+inline bool operator>(const StringView& a, const StringView& b) {return a.compare(b)>0;}
+inline bool operator<=(const StringView& a, const StringView& b) {return a.compare(b)<=0;}
+inline bool operator>=(const StringView& a, const StringView& b) {return a.compare(b)>=0;}
+
+inline std::ostream& operator<<(std::ostream& os, const StringView& str)
+{
+	return os.write(str.data(), str.size());
+}
+
+} // namespace git2
+#endif // _GIT2PP_STRINGVIEW_HPP_
@@ -67,7 +67,12 @@ git_otype Tag::targetType() const
 
 std::string Tag::name() const
 {
-    return git_tag_name(data());
+    return nameView().str();
+}
+
+StringView Tag::nameView() const
+{
+    return StringView(git_tag_name(data()));
 }
 
 Signature Tag::tagger() const
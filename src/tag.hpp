@@ -23,6 +23,7 @@
 #include <git2.h>
 
 #include "object.hpp"
+#include "stringview.hpp"
 
 namespace git2
 {
@@ -55,6 +56,14 @@ public:
      */
     Tag(const Tag& other);
 
+    /**
+     * Move constructor; takes over the underlaying data structure.
+     */
+    Tag(Tag&& other) = default;
+
+    Tag& operator=(const Tag& other) = default;
+    Tag& operator=(Tag&& other) = default;
+
     /**
      * Get the id of a tag.
      * @return object identity for the tag.
@@ -82,6 +91,13 @@ public:
      */
     std::string name() const;
 
+    /**
+     * Get the name of a tag without copying it.
+     *
+     * The view is valid as long as the tag object is alive.
+     */
+    StringView nameView() const;
+
 	/**
 	 * Get the name of a tag
 	 */
@@ -0,0 +1,172 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#include "threadpool.hpp"
+
+#include <algorithm>
+
+namespace git2
+{
+
+namespace
+{
+
+/**
+ * Pool whose task the current thread runs, if any.
+ */
+thread_local const ThreadPool* current_pool = nullptr;
+
+/**
+ * Mark the current thread as running a task of a pool.
+ */
+class RunningTask
+{
+public:
+	explicit RunningTask(const ThreadPool* pool):
+	_previous(current_pool)
+	{
+		current_pool = pool;
+	}
+
+	~RunningTask()
+	{
+		current_pool = _previous;
+	}
+
+	RunningTask(const RunningTask&) = delete;
+	RunningTask& operator=(const RunningTask&) = delete;
+
+private:
+	const ThreadPool* _previous;
+};
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned int threads):
+_task(nullptr),
+_generation(0),
+_pending(0),
+_stop(false)
+{
+	if(threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	_threads.reserve(threads - 1);
+	for(unsigned int worker = 1; worker < threads; ++worker)
+		_threads.emplace_back(&ThreadPool::loop, this, worker);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_start.notify_all();
+	for(std::thread& thread : _threads)
+		thread.join();
+}
+
+unsigned int ThreadPool::size() const
+{
+	return _threads.size() + 1;
+}
+
+void ThreadPool::run(const std::function<void(unsigned int worker)>& task)
+{
+	// The workers are busy with the outer task: run the nested one inline.
+	if(current_pool == this)
+	{
+		task(0);
+		return;
+	}
+
+	std::lock_guard<std::mutex> running(_runMutex);
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_task = &task;
+		_pending = _threads.size();
+		_error = nullptr;
+		++_generation;
+	}
+	_start.notify_all();
+
+	try
+	{
+		RunningTask scope(this);
+		task(0);
+	}
+	catch(...)
+	{
+		fail();
+	}
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_done.wait(lock, [this]{ return _pending == 0; });
+	_task = nullptr;
+	if(_error)
+	{
+		std::exception_ptr error = _error;
+		_error = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+void ThreadPool::loop(unsigned int worker)
+{
+	uint64_t generation = 0;
+	for(;;)
+	{
+		const std::function<void(unsigned int)>* task;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_start.wait(lock, [&]{ return _stop || _generation != generation; });
+			if(_stop)
+				return;
+			generation = _generation;
+			task = _task;
+		}
+
+		try
+		{
+			RunningTask scope(this);
+			(*task)(worker);
+		}
+		catch(...)
+		{
+			fail();
+		}
+
+		bool last;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			last = --_pending == 0;
+		}
+		if(last)
+			_done.notify_one();
+	}
+}
+
+void ThreadPool::fail()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if(!_error)
+		_error = std::current_exception();
+}
+
+} // namespace git2
@@ -0,0 +1,101 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#ifndef _GIT2PP_THREADPOOL_HPP_
+#define _GIT2PP_THREADPOOL_HPP_
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace git2
+{
+
+/**
+ * Fixed set of worker threads running the same task in parallel.
+ *
+ * The calling thread takes part in every run as worker 0, so a pool of
+ * one thread runs its tasks inline and starts no thread at all.
+ *
+ * libgit2 objects, repositories included, must not be used from several
+ * threads at once: open a repository per worker, indexed by the worker
+ * number the task receives. libgit2 must be built thread-safe.
+ */
+class ThreadPool
+{
+public:
+	/**
+	 * Start a pool.
+	 *
+	 * @param threads Number of workers, 0 for one per hardware thread.
+	 */
+	explicit ThreadPool(unsigned int threads = 0);
+
+	/**
+	 * Stop and join the workers.
+	 */
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/**
+	 * Number of workers, the calling thread included.
+	 */
+	unsigned int size() const;
+
+	/**
+	 * Run a task on every worker and wait for all of them to return.
+	 *
+	 * Tasks share their work through their own means, typically an
+	 * atomic counter of the next item to process.
+	 *
+	 * Runs are not re-entrant: a run from a task of the same pool, on any
+	 * worker, runs the task inline as worker 0 only, on the calling
+	 * thread. Runs from other threads wait for the current run to end.
+	 *
+	 * @param task Task to run, called with the worker number, from 0 to
+	 * size() - 1.
+	 * @throws The first exception thrown by a worker, once all of them
+	 * returned.
+	 */
+	void run(const std::function<void(unsigned int worker)>& task);
+
+private:
+	void loop(unsigned int worker);
+	void fail();
+
+	std::vector<std::thread> _threads;
+	std::mutex _runMutex;
+	std::mutex _mutex;
+	std::condition_variable _start;
+	std::condition_variable _done;
+	const std::function<void(unsigned int)>* _task;
+	uint64_t _generation;
+	unsigned int _pending;
+	bool _stop;
+	std::exception_ptr _error;
+};
+
+} // namespace git2
+#endif // _GIT2PP_THREADPOOL_HPP_
@@ -23,9 +23,26 @@
 #include "oid.hpp"
 #include "repository.hpp"
 
+#include <algorithm>
+
 namespace git2
 {
 
+namespace
+{
+
+/**
+ * Subtree on the way to the paths being looked up, with its path from
+ * the root tree ("" for the root tree itself, "src/" for src).
+ */
+struct PathTree
+{
+    std::string path;
+    Tree tree;
+};
+
+} // namespace
+
 //
 // TreeEntry
 //
@@ -34,8 +51,9 @@ _entry(treeEntry)
 {
 }
 
-TreeEntry::TreeEntry(const TreeEntry& treeEntry):
-_entry(treeEntry._entry)
+TreeEntry::TreeEntry(git_tree_entry* treeEntry, bool owned):
+_entry(treeEntry),
+_owned(owned ? treeEntry : NULL)
 {
 }
 
@@ -56,7 +74,12 @@ bool TreeEntry::isNull() const
 
 std::string TreeEntry::name() const
 {
-    return git_tree_entry_name(_entry);
+    return nameView().str();
+}
+
+StringView TreeEntry::nameView() const
+{
+    return StringView(git_tree_entry_name(_entry));
 }
 
 OId TreeEntry::oid() const
@@ -116,6 +139,80 @@ TreeEntry Tree::entryByIndex(int idx) const
     return TreeEntry(git_tree_entry_byindex(data(), idx));
 }
 
+TreeEntry Tree::entryByPath(const StringView& path) const
+{
+    git_tree_entry *entry;
+    int err = git_tree_entry_bypath(&entry, data(), path.str().c_str());
+    if(err == GIT_ENOTFOUND)
+    {
+        giterr_clear();
+        return TreeEntry(NULL);
+    }
+    Exception::git2_assert(err);
+    return TreeEntry(entry, true);
+}
+
+std::vector<TreeEntry> Tree::entriesByPath(const std::vector<std::string>& paths) const
+{
+    std::vector<size_t> order(paths.size());
+    for(size_t idx = 0; idx < order.size(); ++idx)
+        order[idx] = idx;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b){ return paths[a] < paths[b]; });
+
+    // Subtrees from this tree to the directory of the previous path. Once
+    // sorted, the paths below a directory follow each other, so a subtree
+    // popped from the stack is not needed anymore.
+    std::vector<PathTree> stack;
+    stack.push_back(PathTree{std::string(), *this});
+
+    git_repository *repo = git_tree_owner(data());
+    std::vector<TreeEntry> entries(paths.size(), TreeEntry(NULL));
+    for(size_t idx : order)
+    {
+        // Like git_tree_entry_bypath(), a trailing slash requires a tree.
+        const std::string& path = paths[idx];
+        size_t end = path.size();
+        const bool wantTree = end > 0 && path[end - 1] == '/';
+        if(wantTree)
+            --end;
+
+        while(stack.size() > 1 && (stack.back().path.size() > end
+            || path.compare(0, stack.back().path.size(), stack.back().path) != 0))
+            stack.pop_back();
+
+        const git_tree_entry *entry = NULL;
+        for(size_t begin = stack.back().path.size();;)
+        {
+            const size_t slash = std::min(path.find('/', begin), end);
+            if(slash == begin)
+                break;
+
+            entry = git_tree_entry_byname(stack.back().tree.data(), path.substr(begin, slash - begin).c_str());
+            if(entry == NULL || slash == end)
+                break;
+            if(git_tree_entry_type(entry) != GIT_OBJ_TREE)
+            {
+                entry = NULL;
+                break;
+            }
+
+            git_tree *subtree;
+            Exception::git2_assert(git_tree_lookup(&subtree, repo, git_tree_entry_id(entry)));
+            stack.push_back(PathTree{path.substr(0, slash + 1), Tree(subtree)});
+            entry = NULL;
+            begin = slash + 1;
+        }
+
+        if(entry != NULL && (!wantTree || git_tree_entry_type(entry) == GIT_OBJ_TREE))
+        {
+            git_tree_entry *copy;
+            Exception::git2_assert(git_tree_entry_dup(&copy, entry));
+            entries[idx] = TreeEntry(copy, true);
+        }
+    }
+    return entries;
+}
+
 git_tree* Tree::data()const
 {
 	return reinterpret_cast<git_tree*>(Object::data());
@@ -23,8 +23,10 @@
 #include <git2.h>
 
 #include "object.hpp"
+#include "stringview.hpp"
 
 #include <string>
+#include <vector>
 
 namespace git2
 {
@@ -40,9 +42,20 @@ class TreeEntry
 {
 public:
     explicit TreeEntry(const git_tree_entry* treeEntry);
-    TreeEntry(const TreeEntry& treeEntry);
+
+    /**
+     * Creates a TreeEntry which owns treeEntry, like the entries returned by
+     * git_tree_entry_bypath(). The entry is freed with the last copy.
+     */
+    TreeEntry(git_tree_entry* treeEntry, bool owned);
+
+    TreeEntry(const TreeEntry& treeEntry) = default;
+    TreeEntry(TreeEntry&& treeEntry) = default;
     ~TreeEntry();
 
+    TreeEntry& operator=(const TreeEntry& treeEntry) = default;
+    TreeEntry& operator=(TreeEntry&& treeEntry) = default;
+
     /**
       * @return true when internal pointer is 0; otherwise false
       */
@@ -60,6 +73,13 @@ public:
      */
     std::string name() const;
 
+    /**
+     * Get the filename of a tree entry without copying it.
+     *
+     * The view is valid as long as the tree owning the entry is alive.
+     */
+    StringView nameView() const;
+
     /**
      * Get the id of the object pointed by the entry
      * @return the oid of the object
@@ -79,6 +99,7 @@ public:
 
 private:
     const git_tree_entry *_entry;
+    helper::Git2PtrWrapper<git_tree_entry, git_tree_entry_free> _owned;
 };
 
 /**
@@ -105,6 +126,14 @@ public:
      */
     Tree(const Tree& tree);
 
+    /**
+     * Move constructor; takes over the underlaying data structure.
+     */
+    Tree(Tree&& other) = default;
+
+    Tree& operator=(const Tree& other) = default;
+    Tree& operator=(Tree&& other) = default;
+
     /**
      * * Get the id of a tree.
      * * @return object identity for the tree.
@@ -131,6 +160,30 @@ public:
      */
     TreeEntry entryByIndex(int idx) const;
 
+    /**
+     * Lookup a tree entry by its path, like "src/main.cpp", loading the
+     * subtrees on the way
+     * @param path the path of the desired entry, relative to this tree
+     * @return the tree entry, which stays valid after the tree is freed;
+     * NULL if not found
+     * @throws Exception
+     */
+    TreeEntry entryByPath(const StringView& path) const;
+
+    /**
+     * Lookup many tree entries by their path at once.
+     *
+     * The paths are sorted first, so that the entries of a directory are
+     * looked up together: each subtree on the way is loaded once, however
+     * many paths go through it.
+     *
+     * @param paths the paths of the desired entries, relative to this tree
+     * @return the tree entries, in the order of the paths; NULL for the
+     * paths not found
+     * @throws Exception
+     */
+    std::vector<TreeEntry> entriesByPath(const std::vector<std::string>& paths) const;
+
     git_tree* data() const;
 };
 
@@ -0,0 +1,257 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#include "treebuilder.hpp"
+
+#include "exception.hpp"
+#include "oid.hpp"
+#include "repository.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <strings.h>
+
+namespace git2
+{
+
+namespace
+{
+
+void throw_invalid(const std::string& msg)
+{
+	giterr_set_str(GITERR_INVALID, msg.c_str());
+	throw Exception(GIT_ERROR);
+}
+
+/**
+ * Check a tree entry name the way git_treebuilder_insert() does.
+ */
+bool valid_name(const char* name, size_t length)
+{
+	if(length==0 || (length==1 && name[0]=='.') || (length==2 && name[0]=='.' && name[1]=='.'))
+		return false;
+	return !(length==4 && ::strncasecmp(name, ".git", 4)==0);
+}
+
+/**
+ * Check if a file of a directory can still clash with a later directory.
+ *
+ * The names following a file "foo" can still be followed by a directory
+ * "foo" only while they start with "foo" and a byte lower than '/', e.g.
+ * "foo.txt".
+ */
+bool may_precede(const std::string& file, const char* name, size_t length)
+{
+	return length>=file.size() && file.compare(0, file.size(), name, file.size())==0 &&
+		(length==file.size() || (unsigned char)name[file.size()]<'/');
+}
+
+} // namespace
+
+
+//
+// TreeBuilder
+//
+TreeBuilder::TreeBuilder(git_treebuilder *builder):
+_Class(builder)
+{
+}
+
+TreeBuilder::TreeBuilder(const Repository& repo, const Tree& source)
+{
+	git_treebuilder *builder;
+	Exception::git2_assert(git_treebuilder_new(&builder, repo.data(), source.data()));
+	_Class::operator=(_Class(builder));
+}
+
+TreeBuilder::TreeBuilder(const TreeBuilder& other):
+_Class(other)
+{
+}
+
+size_t TreeBuilder::entryCount() const
+{
+	return git_treebuilder_entrycount(data());
+}
+
+TreeEntry TreeBuilder::entryByName(const std::string& fileName) const
+{
+	return TreeEntry(git_treebuilder_get(data(), fileName.c_str()));
+}
+
+void TreeBuilder::insert(const std::string& fileName, const OId& oid, git_filemode_t mode)
+{
+	Exception::git2_assert(git_treebuilder_insert(NULL, data(), fileName.c_str(), oid.constData(), mode));
+}
+
+void TreeBuilder::remove(const std::string& fileName)
+{
+	Exception::git2_assert(git_treebuilder_remove(data(), fileName.c_str()));
+}
+
+void TreeBuilder::clear()
+{
+	git_treebuilder_clear(data());
+}
+
+OId TreeBuilder::write()
+{
+	git_oid oid;
+	Exception::git2_assert(git_treebuilder_write(&oid, data()));
+	return OId(&oid);
+}
+
+
+//
+// SortedTreeBuilder
+//
+SortedTreeBuilder::SortedTreeBuilder(const Repository& repo):
+_levels(1),
+_depth(1)
+{
+	git_odb *odb;
+	Exception::git2_assert(git_repository_odb(&odb, repo.data()));
+	_odb = helper::Git2PtrWrapper<git_odb, git_odb_free>(odb);
+}
+
+void SortedTreeBuilder::add(const StringView& path, const OId& oid, git_filemode_t mode)
+{
+	if(mode!=GIT_FILEMODE_BLOB && mode!=GIT_FILEMODE_BLOB_EXECUTABLE && mode!=GIT_FILEMODE_LINK && mode!=GIT_FILEMODE_COMMIT)
+		throw_invalid("invalid mode for tree entry '" + path.str() + "'");
+	for(size_t begin = 0;;)
+	{
+		size_t end = path.find('/', begin);
+		if(end==StringView::npos)
+			end = path.size();
+		if(!valid_name(path.data()+begin, end-begin))
+			throw_invalid("invalid path for tree entry '" + path.str() + "'");
+		if(end==path.size())
+			break;
+		begin = end+1;
+	}
+
+	// Length of the common part of the path and of the last one.
+	size_t common = 0;
+	const size_t length = std::min(path.size(), _last.size());
+	while(common<length && path[common]==_last[common])
+		++common;
+	if(!_last.empty())
+	{
+		if(common==path.size() || (common<_last.size() && (unsigned char)path[common]<(unsigned char)_last[common]))
+			throw_invalid("tree entry '" + path.str() + "' is not sorted after '" + _last + "'");
+	}
+
+	// Write the directories of the last path which are not the ones of
+	// this path, including the '/' following their name.
+	while(_depth>1 && _levels[_depth-1].end>=common)
+		close();
+
+	// Only the first new directory shares its parent with earlier entries.
+	size_t begin = _depth>1 ? _levels[_depth-1].end+1 : 0;
+	size_t end = path.find('/', begin);
+	if(end!=StringView::npos && hasFile(_levels[_depth-1], path.data()+begin, end-begin))
+		throw_invalid("tree entry '" + path.substr(0, end).str() + "' is both a file and a directory");
+
+	// Open the new directories.
+	for(; end!=StringView::npos; end = path.find('/', begin))
+	{
+		enter(_levels[_depth-1], path.data()+begin, end-begin, true);
+		if(_levels.size()==_depth)
+			_levels.emplace_back();
+		Level& level = _levels[_depth++];
+		level.begin = begin;
+		level.end = end;
+		level.buffer.clear();
+		level.files.clear();
+		begin = end+1;
+	}
+
+	enter(_levels[_depth-1], path.data()+begin, path.size()-begin, false);
+	append(_levels[_depth-1].buffer, mode, path.data()+begin, path.size()-begin, oid.constData());
+	_last.assign(path.data(), path.size());
+}
+
+OId SortedTreeBuilder::finish()
+{
+	while(_depth>1)
+		close();
+
+	git_oid oid;
+	write(_levels[0].buffer, &oid);
+	_levels[0].buffer.clear();
+	_levels[0].files.clear();
+	_last.clear();
+	return OId(&oid);
+}
+
+void SortedTreeBuilder::close()
+{
+	// Leave the builder as is if the tree cannot be written.
+	Level& level = _levels[_depth-1];
+	git_oid oid;
+	write(level.buffer, &oid);
+	append(_levels[_depth-2].buffer, GIT_FILEMODE_TREE, _last.data()+level.begin, level.end-level.begin, &oid);
+	--_depth;
+}
+
+bool SortedTreeBuilder::hasFile(const Level& level, const char* name, size_t length)
+{
+	for(std::vector<std::string>::const_reverse_iterator it = level.files.rbegin(); it!=level.files.rend(); ++it)
+	{
+		if(may_precede(*it, name, length))
+			return it->size()==length;
+	}
+	return false;
+}
+
+void SortedTreeBuilder::enter(Level& level, const char* name, size_t length, bool directory)
+{
+	while(!level.files.empty() && !may_precede(level.files.back(), name, length))
+		level.files.pop_back();
+	if(!directory)
+		level.files.emplace_back(name, length);
+}
+
+void SortedTreeBuilder::write(const std::vector<char>& buffer, git_oid* oid)
+{
+	// Hashing is cheaper than letting the database look the tree up.
+	Exception::git2_assert(git_odb_hash(oid, buffer.data(), buffer.size(), GIT_OBJ_TREE));
+	if(_written.contains(OId(oid)))
+		return;
+	Exception::git2_assert(git_odb_write(oid, _odb.data(), buffer.data(), buffer.size(), GIT_OBJ_TREE));
+	_written.insert(OId(oid));
+}
+
+void SortedTreeBuilder::append(std::vector<char>& buffer, git_filemode_t mode, const char* name, size_t length, const git_oid* oid)
+{
+	// "<octal mode> <name>\0<raw id>", the mode without leading zero.
+	char digits[8];
+	size_t count = 0;
+	for(unsigned int value = mode; value!=0; value >>= 3)
+		digits[count++] = '0' + (value & 7);
+	while(count>0)
+		buffer.push_back(digits[--count]);
+	buffer.push_back(' ');
+	buffer.insert(buffer.end(), name, name+length);
+	buffer.push_back('\0');
+	buffer.insert(buffer.end(), oid->id, oid->id+GIT_OID_RAWSZ);
+}
+
+} // namespace git2
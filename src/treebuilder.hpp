@@ -0,0 +1,191 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#ifndef _GIT2PP_TREEBUILDER_HPP_
+#define _GIT2PP_TREEBUILDER_HPP_
+
+#include <git2.h>
+
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "oidmap.hpp"
+#include "stringview.hpp"
+#include "tree.hpp"
+
+namespace git2
+{
+
+class OId;
+class Repository;
+
+/**
+ * In-memory representation of a tree object, to create or modify trees
+ * one directory at a time.
+ */
+class TreeBuilder : public helper::Git2PtrWrapper<git_treebuilder, git_treebuilder_free>
+{
+public:
+	/**
+	 * Creates a TreeBuilder that points to 'builder'. The pointer becomes
+	 * managed by this TreeBuilder, and must not be passed to another
+	 * TreeBuilder or freed outside this object.
+	 */
+	explicit TreeBuilder(git_treebuilder *builder = NULL);
+
+	/**
+	 * Create a tree builder.
+	 *
+	 * @param repo Repository to write the tree to.
+	 * @param source Tree to start from; an empty tree if null.
+	 * @throws Exception
+	 */
+	explicit TreeBuilder(const Repository& repo, const Tree& source = Tree());
+
+	TreeBuilder(const TreeBuilder& other);
+	TreeBuilder(TreeBuilder&& other) = default;
+
+	TreeBuilder& operator=(const TreeBuilder& other) = default;
+	TreeBuilder& operator=(TreeBuilder&& other) = default;
+
+	/**
+	 * Get the number of entries in the builder.
+	 */
+	size_t entryCount() const;
+
+	/**
+	 * Get an entry from the builder by its filename.
+	 *
+	 * @return The entry, valid until the builder is modified; NULL if not
+	 * found.
+	 */
+	TreeEntry entryByName(const std::string& fileName) const;
+
+	/**
+	 * Add or update an entry.
+	 *
+	 * @param fileName Name of the entry, without slash.
+	 * @param oid Id of the object of the entry.
+	 * @param mode Mode of the entry.
+	 * @throws Exception if the name or the mode is invalid.
+	 */
+	void insert(const std::string& fileName, const OId& oid, git_filemode_t mode);
+
+	/**
+	 * Remove an entry.
+	 *
+	 * @throws Exception GIT_ENOTFOUND if there is no such entry.
+	 */
+	void remove(const std::string& fileName);
+
+	/**
+	 * Remove all the entries.
+	 */
+	void clear();
+
+	/**
+	 * Write the content of the builder as a tree object.
+	 *
+	 * @return The id of the tree.
+	 * @throws Exception
+	 */
+	OId write();
+};
+
+/**
+ * Writer of a whole tree, subtrees included, from its entries given one
+ * at a time as full paths, like "src/main.cpp", sorted by path.
+ *
+ * Each tree is written as soon as the first path after it is given,
+ * deepest first, so only the trees of the directories of the current path
+ * are kept in memory. The trees are serialized directly: no index nor
+ * tree builder is involved, and identical subtrees are only written once.
+ *
+ * The paths must be in byte order, which is the order of the index and
+ * of `git ls-tree -r`; git orders the entries of each tree the same way.
+ *
+ * A SortedTreeBuilder is not thread safe.
+ */
+class SortedTreeBuilder
+{
+public:
+	/**
+	 * Create a builder writing to the object database of a repository.
+	 *
+	 * @throws Exception
+	 */
+	explicit SortedTreeBuilder(const Repository& repo);
+
+	SortedTreeBuilder(const SortedTreeBuilder&) = delete;
+	SortedTreeBuilder& operator=(const SortedTreeBuilder&) = delete;
+
+	/**
+	 * Add an entry.
+	 *
+	 * @param path Full path of the entry, without leading nor trailing
+	 * slash; greater than the previous one.
+	 * @param oid Id of the blob, or of the commit for a submodule.
+	 * @param mode Mode of the entry; trees cannot be added as such.
+	 * @throws Exception if the path or the mode is invalid, if the path
+	 * is out of order or names a directory which is also a file, and when
+	 * a tree cannot be written. The builder stays consistent, so that add()
+	 * can be called again.
+	 */
+	void add(const StringView& path, const OId& oid, git_filemode_t mode);
+
+	/**
+	 * Write the remaining trees and reset the builder for a new tree.
+	 *
+	 * @return The id of the root tree; the empty tree if nothing was added.
+	 * @throws Exception
+	 */
+	OId finish();
+
+	/**
+	 * Number of distinct trees written since the creation of the builder.
+	 */
+	size_t treeCount() const {return _written.size();}
+
+private:
+	/**
+	 * Directory of the last path, with its entries serialized so far.
+	 */
+	struct Level
+	{
+		size_t begin, end; //!< Position of the directory name in the last path.
+		std::vector<char> buffer;
+		std::vector<std::string> files; //!< Files a later directory could clash with.
+	};
+
+	void close();
+	static bool hasFile(const Level& level, const char* name, size_t length);
+	static void enter(Level& level, const char* name, size_t length, bool directory);
+	void write(const std::vector<char>& buffer, git_oid* oid);
+	void append(std::vector<char>& buffer, git_filemode_t mode, const char* name, size_t length, const git_oid* oid);
+
+	helper::Git2PtrWrapper<git_odb, git_odb_free> _odb;
+	OIdSet _written;
+	std::vector<Level> _levels;
+	size_t _depth;
+	std::string _last;
+};
+
+} // namespace git2
+#endif // _GIT2PP_TREEBUILDER_HPP_
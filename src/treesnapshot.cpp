@@ -0,0 +1,402 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#include "treesnapshot.hpp"
+
+#include "exception.hpp"
+#include "packindex.hpp"
+#include "tree.hpp"
+#include "treewalker.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace git2
+{
+
+namespace
+{
+
+const uint32_t snapshot_signature = 0x54534e50; // "TSNP"
+const uint32_t snapshot_version   = 1;
+
+const size_t header_size = 8 + GIT_OID_RAWSZ + 8;
+const size_t entry_size  = GIT_OID_RAWSZ + 12;
+
+using helper::read_be32;
+using helper::write_be32;
+
+void throw_snapshot_error(const std::string& msg, int err = GIT_ERROR)
+{
+	giterr_set_str(GITERR_OS, msg.c_str());
+	throw Exception(err);
+}
+
+/**
+ * Entry of a snapshot being built, its path being in the path pool.
+ */
+struct BuildEntry
+{
+	git_oid oid;
+	uint32_t mode;
+	size_t pathOffset;
+	size_t pathLength;
+};
+
+} // namespace
+
+
+const size_t TreeSnapshot::npos;
+
+/**
+ * Snapshot data, mapped from a file or built in memory, in the file
+ * format in both cases:
+ *
+ * - header: signature, version, root tree id, entry count and path pool
+ *   size, integers being big-endian;
+ * - entries sorted by path: id, path offset in the pool, path length and
+ *   mode;
+ * - path pool, the paths being in the order of the entries.
+ */
+struct TreeSnapshot::Storage
+{
+	Storage():
+	map(nullptr), mapSize(0), data(nullptr), size(0), count(0), entries(nullptr), paths(nullptr)
+	{
+	}
+
+	~Storage()
+	{
+		if(map!=nullptr)
+			::munmap(map, mapSize);
+	}
+
+	Storage(const Storage&) = delete;
+	Storage& operator=(const Storage&) = delete;
+
+	/**
+	 * Check the header and the entries of a snapshot.
+	 * @throws Exception if the data is not a valid snapshot.
+	 */
+	void parse(const unsigned char* buffer, size_t length, const std::string& path)
+	{
+		std::string error = "invalid tree snapshot '" + path + "': ";
+		if(length<header_size || read_be32(buffer)!=snapshot_signature)
+			throw_snapshot_error(error + "bad signature");
+		if(read_be32(buffer+4)!=snapshot_version)
+			throw_snapshot_error(error + "unsupported version");
+
+		uint64_t entryCount = read_be32(buffer+8+GIT_OID_RAWSZ);
+		uint64_t poolSize = read_be32(buffer+12+GIT_OID_RAWSZ);
+		if(header_size + entryCount*entry_size + poolSize != length)
+			throw_snapshot_error(error + "bad size");
+
+		data = buffer;
+		size = length;
+		count = entryCount;
+		entries = buffer + header_size;
+		paths = reinterpret_cast<const char*>(entries + count*entry_size);
+
+		for(size_t idx=0; idx<count; ++idx)
+		{
+			const unsigned char* entry = entries + idx*entry_size;
+			if((uint64_t)read_be32(entry+GIT_OID_RAWSZ) + read_be32(entry+GIT_OID_RAWSZ+4) > poolSize)
+				throw_snapshot_error(error + "bad path offset");
+		}
+	}
+
+	const git_oid* root() const {return reinterpret_cast<const git_oid*>(data+8);}
+	const git_oid* oid(size_t idx) const {return reinterpret_cast<const git_oid*>(entries+idx*entry_size);}
+	uint32_t mode(size_t idx) const {return read_be32(entries+idx*entry_size+GIT_OID_RAWSZ+8);}
+
+	StringView path(size_t idx) const
+	{
+		const unsigned char* entry = entries+idx*entry_size+GIT_OID_RAWSZ;
+		return StringView(paths+read_be32(entry), read_be32(entry+4));
+	}
+
+	/**
+	 * Position of the first entry whose path is not lower than a key.
+	 */
+	size_t lowerBound(const StringView& key) const
+	{
+		size_t first = 0, last = count;
+		while(first<last)
+		{
+			size_t middle = first + (last-first)/2;
+			if(path(middle)<key)
+				first = middle+1;
+			else
+				last = middle;
+		}
+		return first;
+	}
+
+	void* map;
+	size_t mapSize;
+	std::vector<unsigned char> buffer;
+
+	const unsigned char* data;
+	size_t size;
+	size_t count;
+	const unsigned char* entries;
+	const char* paths;
+};
+
+
+namespace
+{
+
+/**
+ * Collect the entries of a tree with their full path.
+ */
+TreeWalkCallbackFunction collect(std::vector<BuildEntry>& entries, std::vector<char>& pool)
+{
+	return [&](const std::string& root, const TreeEntry& entry)
+	{
+		BuildEntry built;
+		git_oid_cpy(&built.oid, git_tree_entry_id(entry.data()));
+		built.mode = git_tree_entry_filemode(entry.data());
+		built.pathOffset = pool.size();
+		pool.insert(pool.end(), root.begin(), root.end());
+		StringView name = entry.nameView();
+		pool.insert(pool.end(), name.begin(), name.end());
+		built.pathLength = pool.size() - built.pathOffset;
+		entries.push_back(built);
+		return 0;
+	};
+}
+
+/**
+ * Sort the collected entries by path and lay them out in the file format.
+ */
+std::shared_ptr<TreeSnapshot::Storage> layout(const Tree& tree, std::vector<BuildEntry>& entries, const std::vector<char>& pool)
+{
+	if(pool.size()>std::numeric_limits<uint32_t>::max() || entries.size()>std::numeric_limits<uint32_t>::max())
+		throw_snapshot_error("tree too large for a snapshot");
+
+	std::sort(entries.begin(), entries.end(), [&](const BuildEntry& a, const BuildEntry& b)
+	{
+		return StringView(pool.data()+a.pathOffset, a.pathLength) < StringView(pool.data()+b.pathOffset, b.pathLength);
+	});
+
+	std::shared_ptr<TreeSnapshot::Storage> storage = std::make_shared<TreeSnapshot::Storage>();
+	std::vector<unsigned char>& buffer = storage->buffer;
+	buffer.reserve(header_size + entries.size()*entry_size + pool.size());
+
+	write_be32(buffer, snapshot_signature);
+	write_be32(buffer, snapshot_version);
+	const git_oid* root = git_tree_id(tree.data());
+	buffer.insert(buffer.end(), root->id, root->id+GIT_OID_RAWSZ);
+	write_be32(buffer, entries.size());
+	write_be32(buffer, pool.size());
+
+	uint32_t offset = 0;
+	for(const BuildEntry& entry : entries)
+	{
+		buffer.insert(buffer.end(), entry.oid.id, entry.oid.id+GIT_OID_RAWSZ);
+		write_be32(buffer, offset);
+		write_be32(buffer, entry.pathLength);
+		write_be32(buffer, entry.mode);
+		offset += entry.pathLength;
+	}
+
+	for(const BuildEntry& entry : entries)
+		buffer.insert(buffer.end(), pool.begin()+entry.pathOffset, pool.begin()+entry.pathOffset+entry.pathLength);
+
+	storage->parse(buffer.data(), buffer.size(), "<memory>");
+	return storage;
+}
+
+} // namespace
+
+
+TreeSnapshot::TreeSnapshot()
+{
+}
+
+TreeSnapshot::TreeSnapshot(std::shared_ptr<const Storage> storage):
+_storage(storage)
+{
+}
+
+TreeSnapshot TreeSnapshot::build(const Repository& repo, const Tree& tree)
+{
+	std::vector<BuildEntry> entries;
+	std::vector<char> pool;
+	TreeWalker(repo).walk(tree, collect(entries, pool));
+	return TreeSnapshot(layout(tree, entries, pool));
+}
+
+TreeSnapshot TreeSnapshot::build(const Repository& repo, const Tree& tree, ThreadPool& pool)
+{
+	std::vector<BuildEntry> entries;
+	std::vector<char> paths;
+	TreeWalker(repo).walk(tree, pool, collect(entries, paths));
+	return TreeSnapshot(layout(tree, entries, paths));
+}
+
+TreeSnapshot TreeSnapshot::open(const std::string& path)
+{
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if(fd<0)
+		throw_snapshot_error("cannot open tree snapshot '" + path + "'", GIT_ENOTFOUND);
+
+	struct stat st;
+	if(::fstat(fd, &st)!=0)
+	{
+		::close(fd);
+		throw_snapshot_error("cannot stat tree snapshot '" + path + "'");
+	}
+
+	void* map = st.st_size>0 ? ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	::close(fd);
+	if(map==MAP_FAILED)
+		throw_snapshot_error("cannot map tree snapshot '" + path + "'");
+
+	std::shared_ptr<Storage> storage = std::make_shared<Storage>();
+	storage->map = map;
+	storage->mapSize = st.st_size;
+	storage->parse(static_cast<const unsigned char*>(map), st.st_size, path);
+	return TreeSnapshot(storage);
+}
+
+TreeSnapshot TreeSnapshot::cached(const std::string& directory, const Repository& repo, const Tree& tree)
+{
+	const OId root(git_tree_id(tree.data()));
+	const std::string path = directory + "/" + root.format() + ".snapshot";
+	try
+	{
+		TreeSnapshot snapshot = open(path);
+		if(snapshot.rootId()==root)
+			return snapshot;
+	}
+	catch(const Exception&)
+	{
+		giterr_clear();
+	}
+
+	TreeSnapshot snapshot = build(repo, tree);
+	try
+	{
+		snapshot.save(path);
+	}
+	catch(const Exception&)
+	{
+		giterr_clear();
+	}
+	return snapshot;
+}
+
+void TreeSnapshot::save(const std::string& path) const
+{
+	if(!_storage)
+		throw_snapshot_error("cannot save an empty tree snapshot");
+
+	std::string tmp = path + ".XXXXXX";
+	int fd = ::mkstemp(&tmp[0]);
+	if(fd<0)
+		throw_snapshot_error("cannot create tree snapshot '" + tmp + "'");
+
+	const unsigned char* data = _storage->data;
+	size_t remaining = _storage->size;
+	bool failed = ::fchmod(fd, 0644)!=0;
+	while(!failed && remaining>0)
+	{
+		ssize_t written = ::write(fd, data, remaining);
+		if(written<0 && errno==EINTR)
+			continue;
+		failed = written<=0;
+		if(!failed)
+		{
+			data += written;
+			remaining -= written;
+		}
+	}
+	failed = failed || ::fsync(fd)!=0;
+	failed = ::close(fd)!=0 || failed;
+
+	if(failed || ::rename(tmp.c_str(), path.c_str())!=0)
+	{
+		::unlink(tmp.c_str());
+		throw_snapshot_error("cannot write tree snapshot '" + path + "'");
+	}
+}
+
+OId TreeSnapshot::rootId() const
+{
+	return _storage ? OId(_storage->root()) : OId();
+}
+
+size_t TreeSnapshot::size() const
+{
+	return _storage ? _storage->count : 0;
+}
+
+StringView TreeSnapshot::path(size_t idx) const
+{
+	return _storage->path(idx);
+}
+
+git_filemode_t TreeSnapshot::mode(size_t idx) const
+{
+	return static_cast<git_filemode_t>(_storage->mode(idx));
+}
+
+OId TreeSnapshot::oid(size_t idx) const
+{
+	return OId(_storage->oid(idx));
+}
+
+size_t TreeSnapshot::find(const StringView& path) const
+{
+	if(!_storage)
+		return npos;
+	size_t pos = _storage->lowerBound(path);
+	return pos<_storage->count && _storage->path(pos)==path ? pos : npos;
+}
+
+std::pair<size_t, size_t> TreeSnapshot::range(const StringView& prefix) const
+{
+	if(!_storage)
+		return std::make_pair(0, 0);
+
+	// The paths starting with the prefix follow the prefix itself.
+	size_t first = _storage->lowerBound(prefix), last = _storage->count;
+	size_t begin = first;
+	while(first<last)
+	{
+		size_t middle = first + (last-first)/2;
+		if(_storage->path(middle).startsWith(prefix))
+			first = middle+1;
+		else
+			last = middle;
+	}
+	return std::make_pair(begin, first);
+}
+
+} // namespace git2
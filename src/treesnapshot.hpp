@@ -0,0 +1,167 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#ifndef _GIT2PP_TREESNAPSHOT_HPP_
+#define _GIT2PP_TREESNAPSHOT_HPP_
+
+#include <git2.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "oid.hpp"
+#include "repository.hpp"
+#include "stringview.hpp"
+
+namespace git2
+{
+
+class ThreadPool;
+class Tree;
+
+/**
+ * Flat copy of a tree and all of its subtrees, to look paths up many
+ * times without loading trees.
+ *
+ * Every entry, subtrees included, is stored with its full path, like
+ * "src/main.cpp", its mode and its id, in one array sorted by path in
+ * byte order. A path is found by binary search, and the entries below a
+ * directory are a contiguous range of the array.
+ *
+ * A snapshot can be saved to a file and opened again, from another
+ * process too, with the file memory-mapped. cached() keeps such files in
+ * a directory, named after the id of the root tree.
+ *
+ * A TreeSnapshot is immutable and can be used from several threads at
+ * once. Copies share the same data.
+ */
+class TreeSnapshot
+{
+public:
+	/**
+	 * Position returned when no entry is found.
+	 */
+	static const size_t npos = static_cast<size_t>(-1);
+
+	/**
+	 * Create an empty snapshot.
+	 */
+	TreeSnapshot();
+
+	/**
+	 * Read a tree and all of its subtrees.
+	 *
+	 * @throws Exception
+	 */
+	static TreeSnapshot build(const Repository& repo, const Tree& tree);
+
+	/**
+	 * Read a tree and all of its subtrees, loading the subtrees on a pool
+	 * of threads like TreeWalker::walk(tree, pool, callback).
+	 *
+	 * @throws Exception
+	 */
+	static TreeSnapshot build(const Repository& repo, const Tree& tree, ThreadPool& pool);
+
+	/**
+	 * Open a snapshot file written by save().
+	 *
+	 * @throws Exception GIT_ENOTFOUND if the file does not exist, or an
+	 * other error if it cannot be read or is invalid.
+	 */
+	static TreeSnapshot open(const std::string& path);
+
+	/**
+	 * Open the snapshot of a tree from a cache directory, or build it and
+	 * save it there if it is not cached yet.
+	 *
+	 * The file is "<directory>/<tree id>.snapshot". A file which cannot be
+	 * read is rebuilt, and a failure to save the snapshot is ignored.
+	 *
+	 * @param directory Existing directory to keep the snapshots in.
+	 * @throws Exception
+	 */
+	static TreeSnapshot cached(const std::string& directory, const Repository& repo, const Tree& tree);
+
+	/**
+	 * Save the snapshot to a file.
+	 *
+	 * The file is written next to path first and then renamed, so readers
+	 * never see a partial file.
+	 *
+	 * @throws Exception
+	 */
+	void save(const std::string& path) const;
+
+	/**
+	 * Id of the tree the snapshot was built from.
+	 */
+	OId rootId() const;
+
+	/**
+	 * Number of entries, subtrees included.
+	 */
+	size_t size() const;
+
+	/**
+	 * Full path of an entry, without leading nor trailing slash.
+	 *
+	 * The view stays valid as long as a copy of the snapshot exists.
+	 */
+	StringView path(size_t idx) const;
+
+	/**
+	 * Mode of an entry.
+	 */
+	git_filemode_t mode(size_t idx) const;
+
+	/**
+	 * Id of an entry.
+	 */
+	OId oid(size_t idx) const;
+
+	/**
+	 * Find an entry by its full path, like "src/main.cpp".
+	 *
+	 * @return The position of the entry, or npos.
+	 */
+	size_t find(const StringView& path) const;
+
+	/**
+	 * Find the entries whose path starts with a prefix.
+	 *
+	 * Use "src/" for all the entries below the src directory, at any
+	 * depth, and "" for all the entries.
+	 *
+	 * @return The positions [first, last) of the entries.
+	 */
+	std::pair<size_t, size_t> range(const StringView& prefix) const;
+
+	struct Storage;
+
+private:
+	explicit TreeSnapshot(std::shared_ptr<const Storage> storage);
+
+	std::shared_ptr<const Storage> _storage;
+};
+
+} // namespace git2
+#endif // _GIT2PP_TREESNAPSHOT_HPP_
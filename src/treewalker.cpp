@@ -0,0 +1,249 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#include "treewalker.hpp"
+
+#include "exception.hpp"
+#include "threadpool.hpp"
+#include "tree.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace git2
+{
+
+namespace
+{
+
+/**
+ * Whether the entries of a tree can match a path prefix.
+ *
+ * @param root Path of the tree, with a trailing slash.
+ */
+bool may_match(const std::string& root, const std::string& prefix)
+{
+	const size_t size = std::min(root.size(), prefix.size());
+	return root.compare(0, size, prefix, 0, size)==0;
+}
+
+/**
+ * Tree loaded ahead of a walk, with its loaded subtrees.
+ */
+struct TreeNode
+{
+	explicit TreeNode(const Tree& tree):tree(tree){}
+
+	Tree tree;
+	std::vector<const TreeNode*> subtrees;  // By entry, null if not loaded.
+};
+
+/**
+ * Depth first walk of a tree, calling the callback of the walker.
+ */
+class TreeVisitor
+{
+public:
+	TreeVisitor(const Repository& repo, TreeWalker::Mode mode, const std::string& prefix,
+		const TreeWalkCallbackFunction& callback):
+	_repo(repo), _mode(mode), _prefix(prefix), _callback(callback)
+	{
+	}
+
+	/**
+	 * Visit a tree, taking its subtrees from its node when loaded ahead.
+	 *
+	 * @return false if the callback stopped the walk.
+	 */
+	bool visit(const Tree& tree, const TreeNode* node)
+	{
+		const size_t rootSize = _root.size();
+		const size_t count = git_tree_entrycount(tree.data());
+		for(size_t idx = 0; idx < count; ++idx)
+		{
+			const git_tree_entry *entry = git_tree_entry_byindex(tree.data(), idx);
+			const char* name = git_tree_entry_name(entry);
+
+			_root.append(name);
+			const bool reported = _root.size() >= _prefix.size()
+				&& _root.compare(0, _prefix.size(), _prefix)==0;
+			_root.push_back('/');
+			bool descend = git_tree_entry_type(entry)==GIT_OBJ_TREE && may_match(_root, _prefix);
+			_root.resize(rootSize);
+
+			if(reported && _mode==TreeWalker::PreOrder)
+			{
+				const int res = _callback(_root, TreeEntry(entry));
+				if(res < 0)
+					return false;
+				if(res > 0)
+					descend = false;
+			}
+
+			if(descend)
+			{
+				_root.append(name);
+				_root.push_back('/');
+				bool more;
+				const TreeNode* subtree = node!=NULL ? node->subtrees[idx] : NULL;
+				if(subtree!=NULL)
+					more = visit(subtree->tree, subtree);
+				else
+					more = visit(_repo.lookupTree(OId(git_tree_entry_id(entry))), NULL);
+				_root.resize(rootSize);
+				if(!more)
+					return false;
+			}
+
+			if(reported && _mode==TreeWalker::PostOrder && _callback(_root, TreeEntry(entry)) < 0)
+				return false;
+		}
+		return true;
+	}
+
+private:
+	const Repository& _repo;
+	TreeWalker::Mode _mode;
+	const std::string& _prefix;
+	const TreeWalkCallbackFunction& _callback;
+	std::string _root;
+};
+
+/**
+ * Subtree to load ahead of a walk.
+ */
+struct TreeTask
+{
+	TreeNode* parent;
+	size_t entry;
+	std::string root;  // Path of the subtree, with a trailing slash.
+};
+
+} // namespace
+
+TreeWalker::TreeWalker(const Repository& repo, Mode mode):
+_repo(repo),
+_mode(mode)
+{
+}
+
+void TreeWalker::setMode(Mode mode)
+{
+	_mode = mode;
+}
+
+void TreeWalker::setPathPrefix(const std::string& prefix)
+{
+	_prefix = prefix;
+}
+
+bool TreeWalker::walk(const Tree& tree, TreeWalkCallbackFunction callback)const
+{
+	TreeVisitor visitor(_repo, _mode, _prefix, callback);
+	return visitor.visit(tree, NULL);
+}
+
+bool TreeWalker::walk(const Tree& tree, ThreadPool& pool, TreeWalkCallbackFunction callback)const
+{
+	// Trees are freed before the handles they were loaded with.
+	std::vector<Repository> handles(pool.size());
+	std::deque<TreeNode> nodes;
+	std::vector<TreeTask> tasks;  // Used as a stack, to load depth first.
+	std::mutex mutex;
+	std::condition_variable progress;
+	size_t busy = 0;
+	bool stop = false;
+
+	// Subtrees of a node to load, which must be accessed by one worker only.
+	auto expand = [this](TreeNode& node, const std::string& root, std::vector<TreeTask>& children)
+	{
+		const size_t count = git_tree_entrycount(node.tree.data());
+		node.subtrees.assign(count, NULL);
+		for(size_t idx = count; idx-- > 0; )
+		{
+			const git_tree_entry *entry = git_tree_entry_byindex(node.tree.data(), idx);
+			if(git_tree_entry_type(entry)!=GIT_OBJ_TREE)
+				continue;
+			std::string path = root + git_tree_entry_name(entry) + '/';
+			if(may_match(path, _prefix))
+				children.push_back(TreeTask{&node, idx, std::move(path)});
+		}
+	};
+
+	nodes.emplace_back(tree);
+	expand(nodes.back(), std::string(), tasks);
+
+	const char* path = git_repository_path(_repo.data());
+	pool.run([&](unsigned int worker)
+	{
+		if(worker != 0 && path == NULL)
+			return;
+		handles[worker] = worker == 0 ? _repo : Repository::open(path);
+		const Repository& handle = handles[worker];
+		std::vector<TreeTask> children;
+		std::unique_lock<std::mutex> lock(mutex);
+		try
+		{
+			for(;;)
+			{
+				progress.wait(lock, [&]{ return stop || !tasks.empty() || busy == 0; });
+				if(stop || tasks.empty())
+					break;
+				TreeTask task = std::move(tasks.back());
+				tasks.pop_back();
+				++busy;
+				lock.unlock();
+
+				const git_tree_entry *entry = git_tree_entry_byindex(task.parent->tree.data(), task.entry);
+				Tree subtree = handle.lookupTree(OId(git_tree_entry_id(entry)));
+
+				lock.lock();
+				nodes.emplace_back(subtree);
+				TreeNode& node = nodes.back();
+				task.parent->subtrees[task.entry] = &node;
+				lock.unlock();
+
+				children.clear();
+				expand(node, task.root, children);
+
+				lock.lock();
+				tasks.insert(tasks.end(), std::make_move_iterator(children.begin()),
+					std::make_move_iterator(children.end()));
+				--busy;
+				progress.notify_all();
+			}
+		}
+		catch(...)
+		{
+			if(!lock.owns_lock())
+				lock.lock();
+			stop = true;
+			progress.notify_all();
+			throw;
+		}
+	});
+
+	TreeVisitor visitor(_repo, _mode, _prefix, callback);
+	return visitor.visit(tree, &nodes.front());
+}
+
+} // namespace git2
@@ -0,0 +1,127 @@
+/* -*- Mode: C++; indent-tabs-mode: t; c-basic-offset: 4; tab-width: 4 -*-  */
+/*
+ * libgit2pp
+ * Copyright (C) 2013-2014 Émilien Kia <emilien.kia@gmail.com>
+ * 
+ * libgit2pp is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * libgit2pp is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU Lesser General Public License for more details.
+ * 
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.";
+ */
+
+#ifndef _GIT2PP_TREEWALKER_HPP_
+#define _GIT2PP_TREEWALKER_HPP_
+
+#include <git2.h>
+
+#include <functional>
+#include <string>
+
+#include "repository.hpp"
+
+namespace git2
+{
+
+class ThreadPool;
+class Tree;
+class TreeEntry;
+
+/**
+ * Callback of a tree walk, called for each entry.
+ *
+ * When walking in pre-order, the callback:
+ * - returns < 0 to stop the walk,
+ * - returns > 0 to skip the subtree of the entry,
+ * - returns 0 to continue.
+ *
+ * When walking in post-order, a positive result is ignored.
+ *
+ * @param root Path of the tree holding the entry, with a trailing slash,
+ * empty for the walked tree itself
+ * @param entry Entry, only valid during the call
+ */
+typedef std::function<int(const std::string& root, const TreeEntry& entry)> TreeWalkCallbackFunction;
+
+/**
+ * Recursive walk of the entries of a tree and of its subtrees.
+ *
+ * Entries are visited in the order of their tree, depth first.
+ */
+class TreeWalker
+{
+public:
+	/**
+	 * Order of the entries of a tree and of its subtree.
+	 */
+	enum Mode
+	{
+		PreOrder = GIT_TREEWALK_PRE,   //!< Tree entries before their subtree.
+		PostOrder = GIT_TREEWALK_POST  //!< Tree entries after their subtree.
+	};
+
+	/**
+	 * Create a walker.
+	 *
+	 * @param repo Repository to load the subtrees from.
+	 * @param mode Order of the walk.
+	 */
+	explicit TreeWalker(const Repository& repo, Mode mode = PreOrder);
+
+	Mode mode()const{return _mode;}
+	void setMode(Mode mode);
+
+	/**
+	 * Only visit the entries whose path starts with a prefix, like
+	 * "src/" for the content of the src directory.
+	 *
+	 * Subtrees which cannot contain such entries are not loaded.
+	 */
+	const std::string& pathPrefix()const{return _prefix;}
+	void setPathPrefix(const std::string& prefix);
+
+	/**
+	 * Walk a tree, loading its subtrees one at a time.
+	 *
+	 * @param tree Tree to walk.
+	 * @param callback Callback called for each entry.
+	 * @return true if completly terminated and false if user terminated.
+	 * @throws Exception
+	 */
+	bool walk(const Tree& tree, TreeWalkCallbackFunction callback)const;
+
+	/**
+	 * Walk a tree, loading its subtrees on a pool of threads first.
+	 *
+	 * Each worker opens its own handle of the repository and the workers
+	 * load all the subtrees matching the path prefix, a tree at a time.
+	 * The callback is then called from the calling thread, in the same
+	 * order as walk(tree, callback) does, whatever the order the subtrees
+	 * were loaded in.
+	 *
+	 * All the subtrees are kept in memory during the walk, and the
+	 * subtrees the callback skips are loaded anyway.
+	 *
+	 * @param tree Tree to walk.
+	 * @param pool Workers to load the subtrees with.
+	 * @param callback Callback called for each entry.
+	 * @return true if completly terminated and false if user terminated.
+	 * @throws Exception
+	 */
+	bool walk(const Tree& tree, ThreadPool& pool, TreeWalkCallbackFunction callback)const;
+
+private:
+	Repository _repo;
+	Mode _mode;
+	std::string _prefix;
+};
+
+} // namespace git2
+#endif // _GIT2PP_TREEWALKER_HPP_